@@ -0,0 +1,104 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef CMAES_H_
+#define CMAES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Covariance matrix adaptation evolution strategy, for minimizing noisy costs
+ * over a handful of continuous parameters. Each generation draws lambda
+ * candidates from a Gaussian around the mean; tell() then moves the mean
+ * toward the cheapest half and adapts the step size and covariance from the
+ * path the mean has taken.
+ *
+ * Candidates are sampled through the Cholesky factor of the covariance rather
+ * than its symmetric square root, which avoids an eigendecomposition and
+ * behaves the same for the few dimensions used here.
+ */
+class Cmaes {
+public:
+    static constexpr size_t MAX_DIM = 8;
+    static constexpr size_t MAX_LAMBDA = 64;
+
+    Cmaes(size_t dim, const double *mean, double sigma, size_t lambda, uint32_t seed);
+
+    void ask(size_t k, double *x) const;
+    void tell(const double *costs);
+
+    size_t getLambda() const {
+        return lambda;
+    }
+
+    const double *getMean() const {
+        return mean;
+    }
+
+    double getSigma() const {
+        return sigma;
+    }
+
+    size_t getGeneration() const {
+        return generation;
+    }
+
+    static size_t defaultLambda(size_t dim);
+
+protected:
+    const size_t dim;
+    const size_t lambda;
+    const size_t mu;
+    double weights[MAX_LAMBDA];
+    double muEff;
+    double cSigma;
+    double dSigma;
+    double cc;
+    double c1;
+    double cMu;
+    double chiN;
+
+    double mean[MAX_DIM];
+    double sigma;
+    double pSigma[MAX_DIM];
+    double pc[MAX_DIM];
+    double cov[MAX_DIM][MAX_DIM];
+    // lower triangular, cov = chol * chol^T
+    double chol[MAX_DIM][MAX_DIM];
+    size_t generation;
+    uint32_t rng;
+
+    // standard normal draws of this generation, and the same mapped by chol
+    double z[MAX_LAMBDA][MAX_DIM];
+    double y[MAX_LAMBDA][MAX_DIM];
+
+    void sample();
+    void factor();
+    double gaussian();
+};
+
+#endif /* CMAES_H_ */
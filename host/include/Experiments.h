@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef EXPERIMENTS_H_
+#define EXPERIMENTS_H_
+
+#include "Harness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Closed-loop measurements of the yaw controller on a Harness. Each expects
+ * an initialized harness with the receiver on and the sticks centered, and
+ * leaves it that way. Times are in ms, rates in deg/s.
+ */
+class Experiments {
+public:
+    struct StepResponse {
+        float target;           // commanded yaw rate
+        float commandLatency;   // stick change to first change in drive output
+        float latency;          // stick change to 10% of the target rate
+        float riseTime;         // 10% to 90% of the target rate
+        float overshoot;        // peak beyond the target, in percent of it
+        float settleTime;       // stick change to staying within SETTLE_BAND
+        float steadyError;      // mean error over the last fifth, in percent
+        float rmsError;         // over the whole response
+        float effort;           // mean drive duty cycle magnitude, 0 to 1
+    };
+
+    struct Disturbance {
+        float peakRate;         // largest yaw rate magnitude
+        float heading;          // heading change over the run, in degrees
+        float recoveryTime;     // until the rate stays within RECOVERED_RATE
+    };
+
+    static constexpr float SETTLE_BAND = 0.05f;
+    static constexpr float RECOVERED_RATE = 20.f;
+
+    static StepResponse yawStep(Harness &harness, bool right, uint32_t ms, FILE *trace = NULL);
+    static Disturbance weaponSpinUp(Harness &harness, uint32_t ms);
+    static Disturbance hit(Harness &harness, float torque, uint32_t hitMs, uint32_t ms);
+
+protected:
+    static float yawRate(Harness &harness);
+    static void recenter(Harness &harness);
+};
+
+#endif /* EXPERIMENTS_H_ */
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef HARNESS_H_
+#define HARNESS_H_
+
+#include "Hw.h"
+#include "HFCS.h"
+#include "A4960.h"
+#include "VNH5050A.h"
+#include "L3GD20.h"
+#include "Blackbox.h"
+#include "ConfigStore.h"
+#include "Params.h"
+#include "MockDevices.h"
+#include "RobotModel.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The firmware's control objects wired to the mock peripherals and a
+ * RobotModel, run on the virtual clock the way main() runs them on the robot:
+ * the control loop every LOOP_DELAY_US, the failsafe every FAILSAFE_DELAY_MS,
+ * and a receiver frame every PPM_FRAME_MS. The model is integrated from the
+ * clock's sleep hook, so it keeps moving while HFCS::init() sleeps.
+ *
+ * Mock peripherals and HFCS callbacks are global, so only one Harness may
+ * exist at a time. It is large; allocate it statically or on the heap.
+ */
+class Harness {
+public:
+    static constexpr size_t NUM_CHANNELS = 5;
+    static constexpr uint32_t PPM_FRAME_MS = 20;
+    // same as the robot's timers
+    static constexpr uint32_t TIMER_CLOCK = 84000000;
+    // stick positions in us, matching Params::defaults
+    static constexpr int32_t STICK_LOW = 1200;
+    static constexpr int32_t STICK_CENTER = 1500;
+    static constexpr int32_t STICK_HIGH = 1800;
+
+    explicit Harness(const Config &config = Params::defaults,
+            const RobotModel::Parameters &parameters = RobotModel::defaults, uint32_t seed = 1);
+    ~Harness();
+
+    void init();
+    void run(uint32_t ms);
+    void runToFrame();
+
+    void setChannel(size_t channel, int32_t width) {
+        channels[channel] = width;
+    }
+
+    void setReceiver(bool on) {
+        receiverOn = on;
+    }
+
+    RobotModel &getModel() {
+        return model;
+    }
+
+    HFCS &getHfcs() {
+        return hfcs;
+    }
+
+    Params &getParams() {
+        return params;
+    }
+
+    Blackbox &getBlackbox() {
+        return blackbox;
+    }
+
+protected:
+    static constexpr size_t BLACKBOX_SIZE = 16 * 1024;
+    static constexpr size_t CONFIG_PAGE_SIZE = 16 * 1024;
+
+    hw::Pwm dcPwm;
+    hw::Pwm m1Pwm;
+    hw::Spi m1Spi;
+    hw::I2c gyroI2c;
+    hw::Icu ppmIcu;
+    MockA4960 m1Driver;
+    RobotModel model;
+
+    A4960 m1;
+    VNH5050A left;
+    VNH5050A right;
+    L3GD20 gyro;
+    uint8_t blackboxMemory[BLACKBOX_SIZE];
+    Blackbox blackbox;
+    uint32_t configFlash[2][CONFIG_PAGE_SIZE / sizeof(uint32_t)];
+    ConfigStore store;
+    Params params;
+    HFCS hfcs;
+
+    int32_t channels[NUM_CHANNELS];
+    bool receiverOn;
+    size_t steps;
+    hw::Time next;
+
+    static constexpr size_t FRAME_STEPS = PPM_FRAME_MS * 1000 / HFCS::LOOP_DELAY_US;
+    static constexpr size_t FAILSAFE_STEPS = HFCS::FAILSAFE_DELAY_MS * 1000 / HFCS::LOOP_DELAY_US;
+    static constexpr size_t SPECTRUM_STEPS = HFCS::SPECTRUM_DELAY_MS * 1000 / HFCS::LOOP_DELAY_US;
+
+    void runStep();
+    void sendFrame();
+
+    static Harness *instance;
+    static void sleepHook(hw::Time from, hw::Time to);
+};
+
+#endif /* HARNESS_H_ */
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef HWPORT_H_
+#define HWPORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Host backend of the hardware interface described in Hw.h, using the mock
+ * peripherals of HwMock.h. Time is a virtual clock that only advances when
+ * the code under test sleeps, so runs are deterministic and take no longer
+ * than the computation itself.
+ *
+ * The host build is single-threaded: critical sections and mutexes do
+ * nothing, and interrupt callbacks run from hw::mock::icuCapture().
+ */
+struct BaseChannel {
+    FILE *file;
+};
+
+namespace hw {
+
+typedef uint32_t Time;
+typedef int32_t Status;
+
+static constexpr Status OK = 0;
+static constexpr Status TIMEOUT = -1;
+
+}
+
+#include "HwMock.h"
+
+namespace hw {
+
+// same as CH_FREQUENCY on the target
+static constexpr uint32_t TICK_HZ = 1000;
+
+// round up, like MS2ST and US2ST
+constexpr Time msToTicks(uint32_t ms) {
+    return (uint64_t(ms) * TICK_HZ + 999) / 1000;
+}
+
+constexpr Time usToTicks(uint32_t us) {
+    return (uint64_t(us) * TICK_HZ + 999999) / 1000000;
+}
+
+struct Mutex {
+    bool locked;
+};
+
+namespace host {
+
+extern Time time;
+// called before the clock advances for a sleep, to let a model catch up
+extern void (*sleepHook)(Time from, Time to);
+extern uint32_t resetFlags;
+// added to timestamps, for a replay to reproduce recorded step periods
+extern uint32_t timestampOffset;
+
+void advance(Time to);
+
+}
+
+inline Time now() {
+    return host::time;
+}
+
+inline void sleepUntil(Time time) {
+    host::advance(time);
+}
+
+inline void sleepMs(uint32_t ms) {
+    host::advance(host::time + msToTicks(ms));
+}
+
+// timestamps follow the virtual clock, so that runs don't depend on the host
+static constexpr uint32_t TIMESTAMP_HZ = 1000000;
+
+inline uint32_t timestamp() {
+    return now() * (TIMESTAMP_HZ / TICK_HZ) + host::timestampOffset;
+}
+
+inline uint32_t irqSave() {
+    return 0;
+}
+
+inline void irqRestore(uint32_t state) {
+    (void) state;
+}
+
+inline void mutexInit(Mutex *mutex) {
+    mutex->locked = false;
+}
+
+inline void mutexLock(Mutex *mutex) {
+    mutex->locked = true;
+}
+
+inline void mutexUnlock(Mutex *mutex) {
+    mutex->locked = false;
+}
+
+inline void channelWrite(BaseChannel *chp, const uint8_t *data, size_t length) {
+    fwrite(data, 1, length, chp->file);
+}
+
+void *backupRam();
+void enableBackupRam();
+uint32_t takeResetFlags();
+
+}
+
+#endif /* HWPORT_H_ */
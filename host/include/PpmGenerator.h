@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef PPMGENERATOR_H_
+#define PPMGENERATOR_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Synthetic PPM receiver output, as the input captures the decoder sees.
+ *
+ * The signal alternates levels at each edge, and each level's duration is one
+ * channel: the frame starts with a long low sync gap, then the first channel
+ * high, the second low, and so on. A capture reports a low time and the
+ * period up to the next falling edge, so it carries two segments. Levels that
+ * run into each other, such as an even channel count ending low into the
+ * sync gap, merge into one segment as they would on the wire.
+ *
+ * Frames carry sticks that wander like a driver's, and can be degraded with
+ * edge jitter, missed edges, noise spikes, and sync gap variation. Frames
+ * with a missed edge or spike are marked corrupted; the rest should decode.
+ */
+class PpmGenerator {
+public:
+    static constexpr size_t MAX_CHANNELS = 16;
+
+    struct Parameters {
+        size_t channels;        // channels per frame
+        float frameMs;          // frame period, sync gap included
+        int32_t minWidth;       // channel width range, in us
+        int32_t maxWidth;
+        int32_t jitter;         // largest error of an edge, in us
+        float dropRate;         // chance per channel of losing both its edges
+        float spikeRate;        // chance per segment of a noise spike in it
+        int32_t maxSpike;       // longest spike, in us
+        int32_t syncJitter;     // largest change of the sync gap, in us
+    };
+
+    struct Capture {
+        hw::IcuCount width;     // low time
+        hw::IcuCount period;    // low time plus the following high time
+        uint32_t frame;         // index of the frame the capture ends in, from 0
+    };
+
+    struct Frame {
+        int32_t channels[MAX_CHANNELS]; // sticks
+        int32_t widths[MAX_CHANNELS];   // as sent, with jitter
+        bool corrupted;
+    };
+
+    static const Parameters defaults;
+
+    PpmGenerator(const Parameters &parameters, uint32_t seed);
+
+    void generate(size_t numFrames, std::vector<Frame> *frames, std::vector<Capture> *captures);
+
+protected:
+    const Parameters parameters;
+    uint32_t rng;
+    int32_t sticks[MAX_CHANNELS];
+    uint32_t frameCount;
+
+    // segment being built, not yet ended by an edge
+    bool pendingHigh;
+    int32_t pendingLength;
+    uint32_t pendingFrame;
+    // low segment waiting for its high half to make a capture
+    int32_t lowLength;
+    bool haveLow;
+
+    uint32_t next();
+    int32_t uniform(int32_t low, int32_t high);
+    bool chance(float p);
+
+    void segment(bool high, int32_t length, uint32_t frame, std::vector<Capture> *captures);
+    void edge(std::vector<Capture> *captures);
+};
+
+#endif /* PPMGENERATOR_H_ */
@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "Hw.h"
+#include "HFCS.h"
+#include "A4960.h"
+#include "VNH5050A.h"
+#include "L3GD20.h"
+#include "Blackbox.h"
+#include "ConfigStore.h"
+#include "Params.h"
+#include "MockDevices.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+ * Runs recorded blackbox samples back through HFCS::step() on the mock
+ * peripherals. Each sample's channels arrive as a receiver frame and its gyro
+ * rates are read through the L3GD20 driver, so everything from pulse decoding
+ * to the motor drivers runs as on the robot. The virtual clock follows the
+ * recorded times and nothing else runs, so a replay is bit-for-bit
+ * repeatable.
+ *
+ * Recorded rates are already bias-corrected, so the replay calibrates its
+ * gyro to zero bias; a recalibration in the log shifts it by the residual.
+ * Controller state such as the PID integrator starts from zero, so outputs
+ * only match a recording taken from boot exactly.
+ *
+ * Mock peripherals and HFCS callbacks are global, so only one Replay or
+ * Harness may exist at a time.
+ */
+class Replay {
+public:
+    typedef Blackbox::Sample Sample;
+
+    // fields computed by the control step rather than copied from its inputs
+    static const Blackbox::Field OUTPUTS[];
+    static const size_t NUM_OUTPUTS;
+    static const char * const FIELD_NAMES[Blackbox::NUM_FIELDS];
+
+    explicit Replay(const Config &config = Params::defaults);
+    ~Replay();
+
+    void init(const Sample &first);
+    Sample step(const Sample &in);
+
+    static bool read(FILE *file, std::vector<Sample> *samples);
+    static bool readDump(FILE *file, std::vector<Sample> *samples);
+    static bool readCsv(FILE *file, std::vector<Sample> *samples);
+    static void writeCsvHeader(FILE *file);
+    static void writeCsv(FILE *file, const Sample &sample);
+
+protected:
+    static constexpr uint32_t TIMER_CLOCK = 84000000;
+    static constexpr size_t BLACKBOX_SIZE = 4 * 1024;
+    static constexpr size_t CONFIG_PAGE_SIZE = 16 * 1024;
+
+    hw::Pwm dcPwm;
+    hw::Pwm m1Pwm;
+    hw::Spi m1Spi;
+    hw::I2c gyroI2c;
+    hw::Icu ppmIcu;
+    MockA4960 m1Driver;
+    MockL3GD20 gyroDevice;
+
+    A4960 m1;
+    VNH5050A left;
+    VNH5050A right;
+    L3GD20 gyro;
+    uint8_t blackboxMemory[BLACKBOX_SIZE];
+    Blackbox blackbox;
+    uint32_t configFlash[2][CONFIG_PAGE_SIZE / sizeof(uint32_t)];
+    ConfigStore store;
+    Params params;
+    HFCS hfcs;
+
+    // replay clock minus recorded time
+    hw::Time offset;
+
+    void sendFrame(const Sample &in);
+};
+
+#endif /* REPLAY_H_ */
@@ -0,0 +1,134 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef ROBOTMODEL_H_
+#define ROBOTMODEL_H_
+
+#include "Hw.h"
+#include "MockDevices.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Planar rigid-body model of the robot for closed-loop runs on the host. It
+ * reads the motor outputs straight off the mock PWM and direction pins, and
+ * drives a mock L3GD20 with what the real sensor would report.
+ *
+ * - Two wheels, each a linear DC motor (stall torque, free speed) through a
+ *   tire whose traction saturates at friction * weight / 2 beyond slipSpeed
+ *   of slip. Shorted windings at zero command brake, as on the VNH5050A.
+ * - Chassis with mass and yaw inertia; the wheel forces give thrust and
+ *   yaw torque about the center of the track.
+ * - Weapon on a vertical axis, driven by the A4960 with no regeneration.
+ *   The motor's torque reacts on the chassis in yaw. (With the spin axis
+ *   along yaw, gyroscopic precession only acts in pitch and roll, which a
+ *   planar model leaves out.)
+ * - Gyro with a one-pole bandwidth filter, sampling at its output data
+ *   rate, constant bias, white noise, and vibration at the weapon's rotation
+ *   frequency growing with the square of its speed.
+ *
+ * Positive yaw is the direction the left wheel driving forward turns the
+ * robot, which the sensor reads as a positive Z rate as mounted on the
+ * robot. Integration uses a fixed step small enough for the tire stiffness.
+ */
+class RobotModel {
+public:
+    struct Parameters {
+        float mass;             // kg
+        float yawInertia;       // kg m^2
+        float trackWidth;       // m
+        float wheelRadius;      // m
+        float wheelInertia;     // kg m^2, reflected through the gearbox
+        float driveStallTorque; // N m at the wheel
+        float driveFreeSpeed;   // rad/s at the wheel
+        float friction;         // tire friction coefficient
+        float slipSpeed;        // m/s of slip for full traction
+        float weaponInertia;    // kg m^2
+        float weaponStallTorque; // N m
+        float weaponFreeSpeed;  // rad/s
+        float weaponDrag;       // N m s
+        float gyroBias[3];      // counts
+        float gyroNoise;        // counts rms, per sample
+        float gyroVibration;    // counts at weapon free speed
+        float gyroBandwidth;    // Hz
+        float gyroDataRate;     // Hz
+        int8_t temperature;     // deg C
+    };
+
+    struct State {
+        float speed;            // m/s forward
+        float yawRate;          // rad/s
+        float heading;          // rad
+        float wheelSpeed[2];    // rad/s, left then right
+        float weaponSpeed;      // rad/s
+        float weaponAngle;      // rad
+    };
+
+    static const Parameters defaults;
+    static constexpr float TIME_STEP = 50e-6f;
+    // L3GD20 sensitivity at 2000 deg/s full scale
+    static constexpr float DPS_PER_COUNT = 0.07f;
+
+    RobotModel(const Parameters &params, hw::Pwm *drivePwm, hw::Pwm *weaponPwm, uint32_t seed);
+
+    void reset();
+    void advance(float seconds);
+    void attach(hw::I2c *i2cp);
+
+    float driveCommand(size_t side) const;
+    float weaponCommand() const;
+
+    const State &getState() const {
+        return state;
+    }
+
+    const Parameters &getParameters() const {
+        return params;
+    }
+
+    // external yaw torque in N m, e.g. a hit
+    float disturbance;
+
+protected:
+    const Parameters params;
+    hw::Pwm * const drivePwm;
+    hw::Pwm * const weaponPwm;
+    MockL3GD20 gyro;
+
+    State state;
+    float filteredRate;     // deg/s, through the gyro bandwidth
+    float untilSample;      // s
+    float pending;          // s not yet integrated
+    const uint32_t seed;
+    uint32_t random;
+
+    void step(float dt);
+    void sample();
+    float noise();
+};
+
+#endif /* ROBOTMODEL_H_ */
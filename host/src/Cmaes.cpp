@@ -0,0 +1,217 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Cmaes.h"
+
+#include <math.h>
+#include <string.h>
+
+/**
+ * Population size suggested by Hansen for a problem of the given dimension.
+ */
+size_t Cmaes::defaultLambda(size_t dim) {
+    return 4 + size_t(3 * log(double(dim)));
+}
+
+/**
+ * @param dim number of parameters, at most MAX_DIM
+ * @param mean starting point
+ * @param sigma initial step size, about a quarter of the search range
+ * @param lambda candidates per generation, at least 2 and at most MAX_LAMBDA
+ * @param seed seed for the candidate sampler
+ */
+Cmaes::Cmaes(size_t dim, const double *mean, double sigma, size_t lambda, uint32_t seed) :
+        dim(dim),
+        lambda(lambda),
+        mu(lambda / 2),
+        weights(),
+        sigma(sigma),
+        pSigma(),
+        pc(),
+        cov(),
+        chol(),
+        generation(0),
+        rng(seed != 0 ? seed : 1) {
+    memcpy(this->mean, mean, dim * sizeof(double));
+
+    double sum = 0;
+    for (size_t i = 0; i < mu; i++) {
+        weights[i] = log(mu + 0.5) - log(i + 1.0);
+        sum += weights[i];
+    }
+    double sumSquares = 0;
+    for (size_t i = 0; i < mu; i++) {
+        weights[i] /= sum;
+        sumSquares += weights[i] * weights[i];
+    }
+    muEff = 1 / sumSquares;
+
+    const double n = dim;
+    cSigma = (muEff + 2) / (n + muEff + 5);
+    dSigma = 1 + 2 * fmax(0, sqrt((muEff - 1) / (n + 1)) - 1) + cSigma;
+    cc = (4 + muEff / n) / (n + 4 + 2 * muEff / n);
+    c1 = 2 / ((n + 1.3) * (n + 1.3) + muEff);
+    cMu = fmin(1 - c1, 2 * (muEff - 2 + 1 / muEff) / ((n + 2) * (n + 2) + muEff));
+    chiN = sqrt(n) * (1 - 1 / (4 * n) + 1 / (21 * n * n));
+
+    for (size_t i = 0; i < dim; i++) {
+        cov[i][i] = 1;
+        chol[i][i] = 1;
+    }
+    sample();
+}
+
+/**
+ * Gets a candidate of the current generation.
+ *
+ * @param k index of the candidate, less than getLambda()
+ * @param x gets the candidate's dim coordinates
+ */
+void Cmaes::ask(size_t k, double *x) const {
+    for (size_t i = 0; i < dim; i++) {
+        x[i] = mean[i] + sigma * y[k][i];
+    }
+}
+
+/**
+ * Updates the distribution from the costs of the current generation's
+ * candidates and draws the next generation.
+ *
+ * @param costs cost of each candidate, lower is better
+ */
+void Cmaes::tell(const double *costs) {
+    // rank candidates by cost; lambda is small, so insertion sort will do
+    size_t order[MAX_LAMBDA];
+    for (size_t k = 0; k < lambda; k++) {
+        size_t j = k;
+        while (j > 0 && costs[order[j - 1]] > costs[k]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = k;
+    }
+
+    double yMean[MAX_DIM] = { };
+    double zMean[MAX_DIM] = { };
+    for (size_t r = 0; r < mu; r++) {
+        for (size_t i = 0; i < dim; i++) {
+            yMean[i] += weights[r] * y[order[r]][i];
+            zMean[i] += weights[r] * z[order[r]][i];
+        }
+    }
+
+    double norm = 0;
+    for (size_t i = 0; i < dim; i++) {
+        mean[i] += sigma * yMean[i];
+        pSigma[i] = (1 - cSigma) * pSigma[i] + sqrt(cSigma * (2 - cSigma) * muEff) * zMean[i];
+        norm += pSigma[i] * pSigma[i];
+    }
+    norm = sqrt(norm);
+
+    generation++;
+    // stall the covariance path while the step size is growing fast
+    const double expected = sqrt(1 - pow(1 - cSigma, 2.0 * generation)) * chiN;
+    const bool hSigma = norm / expected < 1.4 + 2 / (dim + 1.0);
+    for (size_t i = 0; i < dim; i++) {
+        pc[i] = (1 - cc) * pc[i] + (hSigma ? sqrt(cc * (2 - cc) * muEff) : 0) * yMean[i];
+    }
+
+    const double keep = 1 - c1 - cMu + (hSigma ? 0 : c1 * cc * (2 - cc));
+    for (size_t i = 0; i < dim; i++) {
+        for (size_t j = 0; j <= i; j++) {
+            double rankMu = 0;
+            for (size_t r = 0; r < mu; r++) {
+                rankMu += weights[r] * y[order[r]][i] * y[order[r]][j];
+            }
+            cov[i][j] = keep * cov[i][j] + c1 * pc[i] * pc[j] + cMu * rankMu;
+            cov[j][i] = cov[i][j];
+        }
+    }
+
+    sigma *= exp(cSigma / dSigma * (norm / chiN - 1));
+    factor();
+    sample();
+}
+
+/**
+ * Recomputes chol from cov. Rounding can leave cov slightly indefinite after
+ * it collapses along some direction, so the diagonal is nudged until it
+ * factors.
+ */
+void Cmaes::factor() {
+    for (double jitter = 0; ; jitter = jitter == 0 ? 1e-12 : jitter * 10) {
+        bool ok = true;
+        for (size_t j = 0; j < dim; j++) {
+            double d = cov[j][j] + jitter;
+            for (size_t k = 0; k < j; k++) {
+                d -= chol[j][k] * chol[j][k];
+            }
+            if (!(d > 0)) {
+                ok = false;
+                break;
+            }
+            chol[j][j] = sqrt(d);
+            for (size_t i = j + 1; i < dim; i++) {
+                double s = cov[i][j];
+                for (size_t k = 0; k < j; k++) {
+                    s -= chol[i][k] * chol[j][k];
+                }
+                chol[i][j] = s / chol[j][j];
+            }
+        }
+        if (ok) {
+            return;
+        }
+    }
+}
+
+void Cmaes::sample() {
+    for (size_t k = 0; k < lambda; k++) {
+        for (size_t i = 0; i < dim; i++) {
+            z[k][i] = gaussian();
+        }
+        for (size_t i = 0; i < dim; i++) {
+            y[k][i] = 0;
+            for (size_t j = 0; j <= i; j++) {
+                y[k][i] += chol[i][j] * z[k][j];
+            }
+        }
+    }
+}
+
+/**
+ * Standard normal draw from xorshift32 by the Box-Muller transform.
+ */
+double Cmaes::gaussian() {
+    double u[2];
+    for (size_t i = 0; i < 2; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        u[i] = (rng + 0.5) / 4294967296.0;
+    }
+    return sqrt(-2 * log(u[0])) * cos(2 * M_PI * u[1]);
+}
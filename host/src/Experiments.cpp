@@ -0,0 +1,185 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Experiments.h"
+
+#include <math.h>
+#include <vector>
+
+static constexpr float PI = 3.14159265f;
+static constexpr uint32_t STEP_MS = HFCS::LOOP_DELAY_US / 1000;
+static_assert(HFCS::LOOP_DELAY_US % 1000 == 0, "Control step is not a whole number of ms");
+static constexpr uint32_t RECENTER_MS = 1000;
+
+float Experiments::yawRate(Harness &harness) {
+    return harness.getModel().getState().yawRate * (180.f / PI);
+}
+
+void Experiments::recenter(Harness &harness) {
+    harness.setChannel(0, Harness::STICK_CENTER);
+    harness.setChannel(2, Harness::STICK_LOW);
+    harness.getModel().disturbance = 0.f;
+    harness.run(RECENTER_MS);
+}
+
+/**
+ * Time at which a sampled signal first crosses a level, interpolated between
+ * samples.
+ *
+ * @return crossing time in ms, or the end of the samples if never crossed
+ */
+static float crossing(const std::vector<float> &samples, float level) {
+    for (size_t i = 1; i < samples.size(); i++) {
+        if (samples[i] >= level) {
+            const float fraction = (level - samples[i - 1]) / (samples[i] - samples[i - 1]);
+            return (i - 1 + fraction) * STEP_MS;
+        }
+    }
+    return samples.size() * STEP_MS;
+}
+
+/**
+ * Steps the aileron stick to full deflection and records the yaw rate at
+ * every control step.
+ *
+ * @param harness harness to run
+ * @param right step to full right instead of full left
+ * @param ms time to record for
+ * @param trace if not NULL, gets the response as CSV
+ */
+Experiments::StepResponse Experiments::yawStep(Harness &harness, bool right, uint32_t ms, FILE *trace) {
+    RobotModel &model = harness.getModel();
+    StepResponse result = { };
+    // full stick commands the full yaw rate, opposite to the stick
+    result.target = (right ? -1.f : 1.f) * harness.getParams().active().yawRate;
+    const float sign = result.target < 0 ? -1.f : 1.f;
+    const float magnitude = sign * result.target;
+
+    harness.runToFrame();
+    const float before[2] = { model.driveCommand(0), model.driveCommand(1) };
+    harness.setChannel(0, right ? Harness::STICK_HIGH : Harness::STICK_LOW);
+
+    // rates normalized so that the target is +1
+    std::vector<float> response;
+    float effort = 0.f;
+    result.commandLatency = -1.f;
+    if (trace != NULL) {
+        fprintf(trace, "time_ms,rate_dps,left,right\n");
+    }
+    for (uint32_t t = 0; t < ms; t += STEP_MS) {
+        harness.run(STEP_MS);
+        const float left = model.driveCommand(0);
+        const float rightDuty = model.driveCommand(1);
+        if (result.commandLatency < 0 && (left != before[0] || rightDuty != before[1])) {
+            result.commandLatency = t + STEP_MS;
+        }
+        effort += (fabsf(left) + fabsf(rightDuty)) / 2;
+        response.push_back(sign * yawRate(harness) / magnitude);
+        if (trace != NULL) {
+            fprintf(trace, "%u,%.2f,%.4f,%.4f\n", unsigned(t + STEP_MS), yawRate(harness), left, rightDuty);
+        }
+    }
+    // samples are taken at the end of each step
+    response.insert(response.begin(), 0.f);
+
+    result.latency = crossing(response, 0.1f);
+    result.riseTime = crossing(response, 0.9f) - result.latency;
+    float peak = 0.f;
+    float squares = 0.f;
+    size_t lastOutside = 0;
+    for (size_t i = 0; i < response.size(); i++) {
+        peak = fmaxf(peak, response[i]);
+        squares += (response[i] - 1) * (response[i] - 1);
+        if (fabsf(response[i] - 1) > SETTLE_BAND) {
+            lastOutside = i;
+        }
+    }
+    const size_t tail = response.size() - response.size() / 5;
+    float tailError = 0.f;
+    for (size_t i = tail; i < response.size(); i++) {
+        tailError += response[i] - 1;
+    }
+    result.overshoot = fmaxf(peak - 1, 0.f) * 100;
+    result.settleTime = (lastOutside + 1) * STEP_MS;
+    result.steadyError = tailError / (response.size() - tail) * 100;
+    result.rmsError = sqrtf(squares / response.size()) * magnitude;
+    result.effort = effort / (response.size() - 1);
+
+    recenter(harness);
+    return result;
+}
+
+/**
+ * Spins the weapon up from rest at full throttle with the sticks centered.
+ * The motor's reaction torque turns the robot unless the yaw loop holds it.
+ * The weapon takes minutes to coast down afterwards, so this leaves it
+ * spinning; run it last.
+ */
+Experiments::Disturbance Experiments::weaponSpinUp(Harness &harness, uint32_t ms) {
+    harness.runToFrame();
+    harness.setChannel(2, Harness::STICK_HIGH);
+    Disturbance result = { };
+    const float heading = harness.getModel().getState().heading;
+    for (uint32_t t = 0; t < ms; t += STEP_MS) {
+        harness.run(STEP_MS);
+        const float rate = fabsf(yawRate(harness));
+        result.peakRate = fmaxf(result.peakRate, rate);
+        if (rate > RECOVERED_RATE) {
+            result.recoveryTime = t + STEP_MS;
+        }
+    }
+    result.heading = (harness.getModel().getState().heading - heading) * (180.f / PI);
+
+    recenter(harness);
+    return result;
+}
+
+/**
+ * Applies a yaw torque pulse, as from a hit, with the sticks centered.
+ *
+ * @param harness harness to run
+ * @param torque torque in N m
+ * @param hitMs length of the pulse
+ * @param ms time to record for, from the start of the pulse
+ */
+Experiments::Disturbance Experiments::hit(Harness &harness, float torque, uint32_t hitMs, uint32_t ms) {
+    RobotModel &model = harness.getModel();
+    Disturbance result = { };
+    const float heading = model.getState().heading;
+    for (uint32_t t = 0; t < ms; t += STEP_MS) {
+        model.disturbance = t < hitMs ? torque : 0.f;
+        harness.run(STEP_MS);
+        const float rate = fabsf(yawRate(harness));
+        result.peakRate = fmaxf(result.peakRate, rate);
+        if (rate > RECOVERED_RATE) {
+            result.recoveryTime = t + STEP_MS;
+        }
+    }
+    result.heading = (model.getState().heading - heading) * (180.f / PI);
+
+    recenter(harness);
+    return result;
+}
@@ -0,0 +1,137 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Harness.h"
+#include "EventLog.h"
+
+Harness *Harness::instance = NULL;
+
+Harness::Harness(const Config &config, const RobotModel::Parameters &parameters, uint32_t seed) :
+        dcPwm { TIMER_CLOCK / DC_PWM_FREQ, { } },
+        m1Pwm { TIMER_CLOCK / M1_PWM_FREQ, { } },
+        m1Spi { NULL, NULL },
+        gyroI2c { NULL, NULL },
+        ppmIcu { HFCS::icuWidthCb, HFCS::icuPeriodCb, false, 0, 0 },
+        m1Driver(&m1Spi),
+        model(parameters, &dcPwm, &m1Pwm, seed),
+        m1(&m1Spi, &m1Pwm, M1_PWM_CHAN),
+        left(&dcPwm, DC_PWM_AB_CHAN, GPIOC, GPIOC_MTR_A, GPIOA, GPIOA_MTR_B),
+        right(&dcPwm, DC_PWM_XY_CHAN, GPIOA, GPIOA_MTR_X, GPIOA, GPIOA_MTR_Y),
+        gyro(&gyroI2c),
+        blackboxMemory(),
+        blackbox(blackboxMemory, BLACKBOX_SIZE),
+        configFlash(),
+        store( { reinterpret_cast<uint8_t *>(configFlash[0]), CONFIG_PAGE_SIZE, 0 },
+                { reinterpret_cast<uint8_t *>(configFlash[1]), CONFIG_PAGE_SIZE, 1 }),
+        params(config),
+        hfcs(m1, left, right, &ppmIcu, gyro, blackbox, params, store),
+        channels { STICK_CENTER, STICK_CENTER, STICK_LOW, STICK_CENTER, STICK_CENTER },
+        receiverOn(false),
+        steps(0),
+        next(0) {
+    model.attach(&gyroI2c);
+    instance = this;
+    hw::host::sleepHook = sleepHook;
+}
+
+Harness::~Harness() {
+    if (instance == this) {
+        hw::host::sleepHook = NULL;
+        instance = NULL;
+    }
+}
+
+/**
+ * Does main()'s setup: mounts the config store, configures the gyro, and
+ * calibrates it while the model sits still.
+ */
+void Harness::init() {
+    EventLog::init();
+    store.mount();
+
+    gyro.setSlaveAddrLSB(1);
+    gyro.enableDefault();
+    gyro.setFullScaleRange(2); // 2000 dps
+    gyro.setOutputDataRate(2); // 380 Hz
+    gyro.setBandwidth(2); // 100 Hz cut-off
+
+    hfcs.init();
+    hfcs.start();
+    next = hw::now();
+}
+
+/**
+ * Runs the control and failsafe loops for a while, sending receiver frames
+ * with the current channels if the receiver is on.
+ *
+ * @param ms time to run for, rounded up to whole control steps
+ */
+void Harness::run(uint32_t ms) {
+    for (uint32_t elapsed = 0; elapsed < ms * 1000; elapsed += HFCS::LOOP_DELAY_US) {
+        runStep();
+    }
+}
+
+/**
+ * Runs until the next control step is one that sends a receiver frame, so
+ * that channel changes made next take effect without frame phase delay.
+ */
+void Harness::runToFrame() {
+    while (steps % FRAME_STEPS != 0) {
+        runStep();
+    }
+}
+
+void Harness::runStep() {
+    if (receiverOn && steps % FRAME_STEPS == 0) {
+        sendFrame();
+    }
+    hfcs.step();
+    if (steps % FAILSAFE_STEPS == 0) {
+        hfcs.failsafeStep();
+    }
+    if (steps % SPECTRUM_STEPS == 0) {
+        hfcs.spectrumStep();
+    }
+    steps++;
+    next += hw::usToTicks(HFCS::LOOP_DELAY_US);
+    hw::sleepUntil(next);
+}
+
+/**
+ * Sends one PPM frame as input captures, in the order HFCS::newPulse()
+ * decodes them: the sync gap with the first channel, then the rest in pairs.
+ */
+void Harness::sendFrame() {
+    static constexpr hw::IcuCount SYNC_US = 6000;
+    hw::mock::icuCapture(&ppmIcu, SYNC_US, SYNC_US + channels[0]);
+    hw::mock::icuCapture(&ppmIcu, channels[1], channels[1] + channels[2]);
+    hw::mock::icuCapture(&ppmIcu, channels[3], channels[3] + channels[4]);
+}
+
+void Harness::sleepHook(hw::Time from, hw::Time to) {
+    instance->model.advance(float(to - from) / hw::TICK_HZ);
+}
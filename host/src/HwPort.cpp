@@ -0,0 +1,83 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Hw.h"
+#include "HFCS.h"
+#include "chprintf.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+namespace hw {
+
+namespace host {
+
+Time time = 0;
+void (*sleepHook)(Time from, Time to) = NULL;
+uint32_t resetFlags = 0;
+uint32_t timestampOffset = 0;
+
+static uint32_t backup[BKP_SRAM_SIZE / sizeof(uint32_t)];
+
+/**
+ * Moves the virtual clock forward. Times in the past are ignored, as with
+ * chThdSleepUntil() on the target.
+ *
+ * @param to time to advance to
+ */
+void advance(Time to) {
+    if (int32_t(to - time) <= 0) {
+        return;
+    }
+    if (sleepHook != NULL) {
+        sleepHook(time, to);
+    }
+    time = to;
+}
+
+}
+
+void *backupRam() {
+    return host::backup;
+}
+
+void enableBackupRam() {
+}
+
+uint32_t takeResetFlags() {
+    const uint32_t flags = host::resetFlags;
+    host::resetFlags = 0;
+    return flags;
+}
+
+}
+
+void chprintf(BaseChannel *chp, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(chp->file, fmt, args);
+    va_end(args);
+}
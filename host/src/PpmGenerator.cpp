@@ -0,0 +1,166 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "PpmGenerator.h"
+
+const PpmGenerator::Parameters PpmGenerator::defaults = {
+        5,      // channels
+        20.f,   // frameMs
+        1000,   // minWidth
+        2000,   // maxWidth
+        4,      // jitter
+        0.f,    // dropRate
+        0.f,    // spikeRate
+        50,     // maxSpike
+        0,      // syncJitter
+};
+
+/**
+ * @param parameters signal to generate; channels at most MAX_CHANNELS, and
+ *      the frame long enough to hold them all at full width
+ * @param seed seed for the sticks and impairments
+ */
+PpmGenerator::PpmGenerator(const Parameters &parameters, uint32_t seed) :
+        parameters(parameters),
+        rng(seed != 0 ? seed : 1),
+        sticks(),
+        frameCount(0),
+        pendingHigh(false),
+        pendingLength(0),
+        pendingFrame(0),
+        lowLength(0),
+        haveLow(false) {
+    for (size_t i = 0; i < MAX_CHANNELS; i++) {
+        sticks[i] = (parameters.minWidth + parameters.maxWidth) / 2;
+    }
+}
+
+uint32_t PpmGenerator::next() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+int32_t PpmGenerator::uniform(int32_t low, int32_t high) {
+    return low + int32_t(next() % uint32_t(high - low + 1));
+}
+
+bool PpmGenerator::chance(float p) {
+    return p > 0.f && next() < p * 4294967296.f;
+}
+
+/**
+ * Appends frames and the captures they produce. The last frame's final
+ * capture only ends at the next frame's sync gap, so it arrives with the
+ * next call.
+ *
+ * @param numFrames frames to generate
+ * @param frames gets the sent stick values of each frame
+ * @param captures gets the captures
+ */
+void PpmGenerator::generate(size_t numFrames, std::vector<Frame> *frames, std::vector<Capture> *captures) {
+    const int32_t framePeriod = parameters.frameMs * 1000.f;
+
+    for (size_t f = 0; f < numFrames; f++) {
+        const uint32_t index = frameCount++;
+        Frame frame;
+        frame.corrupted = false;
+
+        int32_t * const widths = frame.widths;
+        int32_t total = 0;
+        for (size_t i = 0; i < parameters.channels; i++) {
+            // sticks mostly drift, sometimes slam to a new position
+            if (chance(0.01f)) {
+                sticks[i] = uniform(parameters.minWidth, parameters.maxWidth);
+            } else {
+                sticks[i] += uniform(-20, 20);
+                sticks[i] = sticks[i] < parameters.minWidth ? parameters.minWidth : sticks[i];
+                sticks[i] = sticks[i] > parameters.maxWidth ? parameters.maxWidth : sticks[i];
+            }
+            frame.channels[i] = sticks[i];
+            widths[i] = sticks[i] + uniform(-parameters.jitter, parameters.jitter);
+            total += widths[i];
+        }
+        const int32_t sync = framePeriod - total + uniform(-parameters.syncJitter, parameters.syncJitter);
+
+        // a missed edge pair hides one channel inside its neighbors
+        bool dropped[MAX_CHANNELS] = { };
+        for (size_t i = 0; i < parameters.channels; i++) {
+            dropped[i] = chance(parameters.dropRate);
+            frame.corrupted = frame.corrupted || dropped[i];
+        }
+
+        for (size_t i = 0; i <= parameters.channels; i++) {
+            // segment 0 is the sync gap, which is low
+            const bool high = i % 2 != 0;
+            const int32_t length = i == 0 ? sync : widths[i - 1];
+            const bool level = i > 0 && dropped[i - 1] ? !high : high;
+
+            if (length > 2 * parameters.maxSpike && chance(parameters.spikeRate)) {
+                const int32_t spike = uniform(1, parameters.maxSpike);
+                const int32_t before = uniform(1, length - spike - 1);
+                segment(level, before, index, captures);
+                segment(!level, spike, index, captures);
+                segment(level, length - spike - before, index, captures);
+                frame.corrupted = true;
+            } else {
+                segment(level, length, index, captures);
+            }
+        }
+        frames->push_back(frame);
+    }
+}
+
+void PpmGenerator::segment(bool high, int32_t length, uint32_t frame, std::vector<Capture> *captures) {
+    if (pendingLength > 0 && high != pendingHigh) {
+        edge(captures);
+    }
+    if (pendingLength == 0) {
+        pendingFrame = frame;
+    }
+    pendingHigh = high;
+    pendingLength += length;
+}
+
+/**
+ * Ends the pending segment. A falling edge completes a capture, with counts
+ * truncated to 16 bits like the robot's capture registers.
+ */
+void PpmGenerator::edge(std::vector<Capture> *captures) {
+    if (!pendingHigh) {
+        lowLength = pendingLength;
+        haveLow = true;
+    } else if (haveLow) {
+        Capture capture;
+        capture.width = hw::IcuCount(lowLength & 0xffff);
+        capture.period = hw::IcuCount((lowLength + pendingLength) & 0xffff);
+        capture.frame = pendingFrame;
+        captures->push_back(capture);
+        haveLow = false;
+    }
+    pendingLength = 0;
+}
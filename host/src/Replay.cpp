@@ -0,0 +1,288 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Replay.h"
+#include "EventLog.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const Blackbox::Field Replay::OUTPUTS[] = {
+        Blackbox::SET_POINT,
+        Blackbox::PID_INTEGRAL,
+        Blackbox::PID_OUTPUT,
+        Blackbox::LEFT,
+        Blackbox::RIGHT,
+        Blackbox::THROTTLE,
+        Blackbox::FLAGS,
+};
+
+const size_t Replay::NUM_OUTPUTS = sizeof(OUTPUTS) / sizeof(OUTPUTS[0]);
+
+const char * const Replay::FIELD_NAMES[Blackbox::NUM_FIELDS] = {
+        "time",
+        "channel_0",
+        "channel_1",
+        "channel_2",
+        "channel_3",
+        "channel_4",
+        "rate_x",
+        "rate_y",
+        "rate_z",
+        "set_point",
+        "pid_integral",
+        "pid_output",
+        "left",
+        "right",
+        "throttle",
+        "flags",
+        "period",
+};
+
+Replay::Replay(const Config &config) :
+        dcPwm { TIMER_CLOCK / DC_PWM_FREQ, { } },
+        m1Pwm { TIMER_CLOCK / M1_PWM_FREQ, { } },
+        m1Spi { NULL, NULL },
+        gyroI2c { NULL, NULL },
+        ppmIcu { HFCS::icuWidthCb, HFCS::icuPeriodCb, false, 0, 0 },
+        m1Driver(&m1Spi),
+        gyroDevice(),
+        m1(&m1Spi, &m1Pwm, M1_PWM_CHAN),
+        left(&dcPwm, DC_PWM_AB_CHAN, GPIOC, GPIOC_MTR_A, GPIOA, GPIOA_MTR_B),
+        right(&dcPwm, DC_PWM_XY_CHAN, GPIOA, GPIOA_MTR_X, GPIOA, GPIOA_MTR_Y),
+        gyro(&gyroI2c),
+        blackboxMemory(),
+        blackbox(blackboxMemory, BLACKBOX_SIZE),
+        configFlash(),
+        store( { reinterpret_cast<uint8_t *>(configFlash[0]), CONFIG_PAGE_SIZE, 0 },
+                { reinterpret_cast<uint8_t *>(configFlash[1]), CONFIG_PAGE_SIZE, 1 }),
+        params(config),
+        hfcs(m1, left, right, &ppmIcu, gyro, blackbox, params, store),
+        offset(0) {
+    gyroDevice.attach(&gyroI2c);
+    GPIOC->in |= 1u << GPIOC_M1_DIAG;
+}
+
+Replay::~Replay() {
+    GPIOC->in |= 1u << GPIOC_M1_DIAG;
+}
+
+/**
+ * Does main()'s setup with the gyro at rest, so it calibrates to zero bias.
+ *
+ * @param first first sample to be replayed; if the gyro was already disabled
+ *      then, it fails here as well
+ */
+void Replay::init(const Sample &first) {
+    const int32_t flags = first.field[Blackbox::FLAGS];
+    gyroDevice.failed = !(flags & Blackbox::FLAG_GYRO_ENABLE) && !(flags & Blackbox::FLAG_GYRO_ERROR);
+
+    EventLog::init();
+    store.mount();
+
+    gyro.setSlaveAddrLSB(1);
+    gyro.enableDefault();
+    gyro.setFullScaleRange(2); // 2000 dps
+    gyro.setOutputDataRate(2); // 380 Hz
+    gyro.setBandwidth(2); // 100 Hz cut-off
+
+    hfcs.init();
+    hfcs.start();
+    offset = hw::now() + hw::usToTicks(HFCS::LOOP_DELAY_US) - first.field[Blackbox::TIME];
+}
+
+/**
+ * Runs one control step on a recorded sample's inputs.
+ *
+ * @param in recorded sample
+ * @return the replayed sample, with the recorded time
+ */
+Replay::Sample Replay::step(const Sample &in) {
+    const int32_t flags = in.field[Blackbox::FLAGS];
+    hw::Time time = in.field[Blackbox::TIME] + offset;
+    if (int32_t(time - hw::now()) <= 0) {
+        // recording restarted or skipped back; carry on from here
+        offset += hw::now() + 1 - time;
+        time = hw::now() + 1;
+    }
+
+    for (size_t i = 0; i < 3; i++) {
+        gyroDevice.rate[i] = in.field[Blackbox::RATE_X + i];
+    }
+    if (flags & Blackbox::FLAG_GYRO_ERROR) {
+        gyroDevice.failed = true;
+    }
+    if (flags & Blackbox::FLAG_M1_FAULT) {
+        GPIOC->in &= ~(1u << GPIOC_M1_DIAG);
+    } else {
+        GPIOC->in |= 1u << GPIOC_M1_DIAG;
+    }
+
+    const bool valid = flags & Blackbox::FLAG_CHANNELS_VALID;
+    const bool lost = !valid && hfcs.isArmed();
+    if (lost) {
+        // jump past the failsafe timeout so that it trips as it did then
+        const hw::Time timeout = hw::msToTicks(HFCS::FAILSAFE_TIMEOUT_MS) + 1;
+        offset += timeout;
+        time += timeout;
+    }
+    hw::host::advance(time);
+    // the recorded period stands in for the virtual clock's, which only counts
+    // whole ticks; logs from before periods were recorded have none
+    const uint32_t periodUs = in.field[Blackbox::PERIOD];
+    if (periodUs != 0) {
+        hw::host::timestampOffset += hfcs.getLastTimestamp() + periodUs - hw::timestamp();
+    }
+    if (valid) {
+        sendFrame(in);
+    } else if (lost) {
+        hfcs.failsafeStep();
+    }
+
+    hfcs.step();
+    // on the robot analysis runs every few steps, so tracked notches may land
+    // a step or two off from the recording
+    hfcs.spectrumStep();
+
+    Sample out = hfcs.getFrame();
+    out.field[Blackbox::TIME] = in.field[Blackbox::TIME];
+    return out;
+}
+
+/**
+ * Sends a sample's channels as one PPM frame, as Harness does.
+ */
+void Replay::sendFrame(const Sample &in) {
+    static constexpr hw::IcuCount SYNC_US = 6000;
+    const int32_t * const channels = &in.field[Blackbox::CHANNEL_0];
+    hw::mock::icuCapture(&ppmIcu, SYNC_US, SYNC_US + channels[0]);
+    hw::mock::icuCapture(&ppmIcu, channels[1], channels[1] + channels[2]);
+    hw::mock::icuCapture(&ppmIcu, channels[3], channels[3] + channels[4]);
+}
+
+/**
+ * Reads a log as either a blackbox dump or CSV, by its first bytes.
+ *
+ * @param file log to read
+ * @param samples gets the samples appended
+ * @return false if the log could not be parsed
+ */
+bool Replay::read(FILE *file, std::vector<Sample> *samples) {
+    uint32_t magic = 0;
+    const size_t got = fread(&magic, 1, sizeof(magic), file);
+    rewind(file);
+    if (got == sizeof(magic) && magic == Blackbox::DUMP_MAGIC) {
+        return readDump(file, samples);
+    }
+    return readCsv(file, samples);
+}
+
+/**
+ * Reads the output of the "bb dump" shell command. Dumps from firmware that
+ * recorded fewer fields decode with the newer fields zero.
+ */
+bool Replay::readDump(FILE *file, std::vector<Sample> *samples) {
+    Blackbox::DumpHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != Blackbox::DUMP_MAGIC
+            || header.version != Blackbox::DUMP_VERSION || header.numFields > Blackbox::NUM_FIELDS
+            || header.blockSize != Blackbox::BLOCK_SIZE) {
+        return false;
+    }
+
+    static constexpr size_t MAX_BLOCK_SAMPLES = Blackbox::BLOCK_SIZE;
+    uint8_t block[Blackbox::BLOCK_SIZE];
+    Sample decoded[MAX_BLOCK_SAMPLES];
+    for (size_t i = 0; i < header.numBlocks; i++) {
+        if (fread(block, sizeof(block), 1, file) != 1) {
+            return false;
+        }
+        const Blackbox::BlockHeader * const blockHeader = reinterpret_cast<const Blackbox::BlockHeader *>(block);
+        if (blockHeader->length > Blackbox::BLOCK_SIZE - sizeof(Blackbox::BlockHeader)) {
+            return false;
+        }
+        const size_t count = Blackbox::decodeBlock(block, decoded, MAX_BLOCK_SAMPLES);
+        samples->insert(samples->end(), decoded, decoded + count);
+    }
+    return true;
+}
+
+/**
+ * Reads samples as comma-separated integers, with a header line naming the
+ * columns as in FIELD_NAMES. Columns may be in any order; unknown ones are
+ * ignored and missing ones read as zero.
+ */
+bool Replay::readCsv(FILE *file, std::vector<Sample> *samples) {
+    static constexpr size_t MAX_COLUMNS = 64;
+    int columns[MAX_COLUMNS];
+    size_t numColumns = 0;
+    char line[1024];
+
+    if (fgets(line, sizeof(line), file) == NULL) {
+        return false;
+    }
+    for (char *name = strtok(line, ",\r\n"); name != NULL && numColumns < MAX_COLUMNS;
+            name = strtok(NULL, ",\r\n")) {
+        columns[numColumns] = -1;
+        for (size_t i = 0; i < Blackbox::NUM_FIELDS; i++) {
+            if (strcmp(name, FIELD_NAMES[i]) == 0) {
+                columns[numColumns] = i;
+            }
+        }
+        numColumns++;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        Sample sample = { };
+        const char *p = line;
+        for (size_t c = 0; c < numColumns; c++) {
+            char *end;
+            const long value = strtol(p, &end, 0);
+            if (end == p) {
+                return false;
+            }
+            if (columns[c] >= 0) {
+                sample.field[columns[c]] = value;
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+        samples->push_back(sample);
+    }
+    return true;
+}
+
+void Replay::writeCsvHeader(FILE *file) {
+    for (size_t i = 0; i < Blackbox::NUM_FIELDS; i++) {
+        fprintf(file, i == 0 ? "%s" : ",%s", FIELD_NAMES[i]);
+    }
+    fputc('\n', file);
+}
+
+void Replay::writeCsv(FILE *file, const Sample &sample) {
+    for (size_t i = 0; i < Blackbox::NUM_FIELDS; i++) {
+        fprintf(file, i == 0 ? "%d" : ",%d", int(sample.field[i]));
+    }
+    fputc('\n', file);
+}
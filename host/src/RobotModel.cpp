@@ -0,0 +1,183 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "RobotModel.h"
+#include "HFCS.h"
+
+#include <algorithm>
+#include <math.h>
+
+static constexpr float GRAVITY = 9.81f;
+static constexpr float PI = 3.14159265f;
+
+// roughly a 1.4 kg (3 lb) two-wheeled spinner
+const RobotModel::Parameters RobotModel::defaults = {
+        1.36f,      // mass
+        0.004f,     // yawInertia
+        0.12f,      // trackWidth
+        0.025f,     // wheelRadius
+        2e-5f,      // wheelInertia
+        0.35f,      // driveStallTorque
+        120.f,      // driveFreeSpeed, 3 m/s
+        0.9f,       // friction
+        0.05f,      // slipSpeed
+        0.0012f,    // weaponInertia
+        0.4f,       // weaponStallTorque
+        900.f,      // weaponFreeSpeed, 8600 rpm
+        5e-5f,      // weaponDrag
+        { 12.f, -7.f, 9.f }, // gyroBias
+        4.f,        // gyroNoise, 0.3 deg/s
+        60.f,       // gyroVibration
+        100.f,      // gyroBandwidth
+        380.f,      // gyroDataRate
+        25,         // temperature
+};
+
+RobotModel::RobotModel(const Parameters &params, hw::Pwm *drivePwm, hw::Pwm *weaponPwm, uint32_t seed) :
+        disturbance(0.f), params(params), drivePwm(drivePwm), weaponPwm(weaponPwm), state(), filteredRate(0.f),
+        untilSample(0.f), pending(0.f), seed(seed != 0 ? seed : 1), random(this->seed) {
+    reset();
+}
+
+/**
+ * Puts the robot back at rest, with the noise sequence restarted.
+ */
+void RobotModel::reset() {
+    state = State();
+    filteredRate = 0.f;
+    untilSample = 0.f;
+    pending = 0.f;
+    random = seed;
+    disturbance = 0.f;
+    gyro.temperature = params.temperature;
+    sample();
+}
+
+void RobotModel::attach(hw::I2c *i2cp) {
+    gyro.attach(i2cp);
+}
+
+/**
+ * Integrates the model forward. Time not amounting to a whole step is carried
+ * over to the next call.
+ *
+ * @param seconds time to advance by
+ */
+void RobotModel::advance(float seconds) {
+    pending += seconds;
+    while (pending >= TIME_STEP) {
+        step(TIME_STEP);
+        pending -= TIME_STEP;
+        untilSample -= TIME_STEP;
+        if (untilSample <= 0.f) {
+            sample();
+            untilSample += 1.f / params.gyroDataRate;
+        }
+    }
+}
+
+/**
+ * Reads a drive motor command back from the PWM and the VNH5050A direction
+ * pins; VNH5050A::setSpeed() clears the first pin to reverse.
+ *
+ * @param side 0 for left, 1 for right
+ * @return duty cycle in [-1, 1]
+ */
+float RobotModel::driveCommand(size_t side) const {
+    const hw::PwmChannel channel = side == 0 ? DC_PWM_AB_CHAN : DC_PWM_XY_CHAN;
+    const bool reverse = side == 0 ? !(GPIOC->out & (1u << GPIOC_MTR_A)) : !(GPIOA->out & (1u << GPIOA_MTR_X));
+    const float duty = std::min(float(drivePwm->widths[channel]) / drivePwm->period, 1.f);
+    return reverse ? -duty : duty;
+}
+
+float RobotModel::weaponCommand() const {
+    return std::min(float(weaponPwm->widths[M1_PWM_CHAN]) / weaponPwm->period, 1.f);
+}
+
+void RobotModel::step(float dt) {
+    const Parameters &p = params;
+    const float maxForce = p.friction * p.mass * GRAVITY / 2;
+
+    float force[2];
+    for (size_t side = 0; side < 2; side++) {
+        float &wheelSpeed = state.wheelSpeed[side];
+        const float torque = p.driveStallTorque * (driveCommand(side) - wheelSpeed / p.driveFreeSpeed);
+        // the left wheel's contact patch moves faster in positive yaw
+        const float contactSpeed = state.speed + (side == 0 ? 1 : -1) * state.yawRate * p.trackWidth / 2;
+        const float slip = wheelSpeed * p.wheelRadius - contactSpeed;
+        force[side] = maxForce * std::min(std::max(slip / p.slipSpeed, -1.f), 1.f);
+        wheelSpeed += (torque - force[side] * p.wheelRadius) / p.wheelInertia * dt;
+    }
+
+    // the A4960 only drives the weapon forward and coasts otherwise
+    const float weaponTorque = std::max(p.weaponStallTorque * (weaponCommand() - state.weaponSpeed / p.weaponFreeSpeed),
+            0.f);
+    state.weaponSpeed += (weaponTorque - p.weaponDrag * state.weaponSpeed) / p.weaponInertia * dt;
+    state.weaponAngle += state.weaponSpeed * dt;
+    if (state.weaponAngle >= 2 * PI) {
+        state.weaponAngle -= 2 * PI;
+    }
+
+    const float yawTorque = (force[0] - force[1]) * p.trackWidth / 2 - weaponTorque + disturbance;
+    state.speed += (force[0] + force[1]) / p.mass * dt;
+    state.yawRate += yawTorque / p.yawInertia * dt;
+    state.heading += state.yawRate * dt;
+
+    // one-pole low-pass, by backward Euler
+    const float wc = 2 * PI * p.gyroBandwidth * dt;
+    filteredRate += (state.yawRate * (180.f / PI) - filteredRate) * wc / (1 + wc);
+}
+
+/**
+ * Latches a new gyro sample into the sensor's output registers.
+ */
+void RobotModel::sample() {
+    const float spin = state.weaponSpeed / params.weaponFreeSpeed;
+    const float vibration = params.gyroVibration * spin * spin;
+    const float counts[3] = {
+            params.gyroBias[0] + params.gyroNoise * noise() + vibration * cosf(state.weaponAngle),
+            params.gyroBias[1] + params.gyroNoise * noise() + vibration * sinf(state.weaponAngle),
+            params.gyroBias[2] + params.gyroNoise * noise() + filteredRate / DPS_PER_COUNT
+                    + 0.1f * vibration * sinf(state.weaponAngle) };
+    for (size_t i = 0; i < 3; i++) {
+        gyro.rate[i] = int16_t(std::min(std::max(lrintf(counts[i]), -32768L), 32767L));
+    }
+}
+
+/**
+ * Unit-variance noise, as a sum of uniform samples from a xorshift generator
+ * so runs are reproducible from the seed on any host.
+ */
+float RobotModel::noise() {
+    float sum = 0.f;
+    for (size_t i = 0; i < 12; i++) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        sum += random * (1.f / 4294967296.f);
+    }
+    return sum - 6.f;
+}
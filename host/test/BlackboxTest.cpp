@@ -0,0 +1,159 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "Blackbox.h"
+#include "Replay.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+typedef Blackbox::Sample Sample;
+
+static constexpr size_t NUM_BLOCKS = 4;
+
+static bool equal(const Sample &a, const Sample &b) {
+    return memcmp(&a, &b, sizeof(Sample)) == 0;
+}
+
+// fields that mostly hold still or move a little, like a control loop's
+static Sample makeSample(size_t i, uint32_t *random) {
+    Sample sample = { };
+    for (size_t f = 0; f < Blackbox::NUM_FIELDS; f++) {
+        *random = *random * 1664525u + 1013904223u;
+        const int32_t r = int32_t(*random >> 16);
+        sample.field[f] = (f % 3 == 0) ? int32_t(i) : (r % 3 == 0 ? r : 1500);
+    }
+    return sample;
+}
+
+TEST(blackboxBlockRoundTrip) {
+    static uint8_t storage[NUM_BLOCKS * Blackbox::BLOCK_SIZE];
+    Blackbox blackbox(storage, sizeof(storage));
+
+    // extremes need full five-byte varints and wrap around in the deltas
+    const int32_t values[] = { 0, INT32_MAX, INT32_MIN, -1, 1, INT32_MIN, INT32_MAX, 0 };
+    const size_t count = sizeof(values) / sizeof(values[0]);
+    Sample recorded[count];
+    for (size_t i = 0; i < count; i++) {
+        for (size_t f = 0; f < Blackbox::NUM_FIELDS; f++) {
+            recorded[i].field[f] = (f & 1) ? values[i] : -values[i] - 1;
+        }
+        blackbox.record(recorded[i]);
+    }
+
+    Sample decoded[count + 1];
+    CHECK(Blackbox::decodeBlock(storage, decoded, count + 1) == count);
+    for (size_t i = 0; i < count; i++) {
+        CHECK(equal(decoded[i], recorded[i]));
+    }
+}
+
+TEST(blackboxDumpRoundTrip) {
+    static uint8_t storage[NUM_BLOCKS * Blackbox::BLOCK_SIZE];
+    Blackbox blackbox(storage, sizeof(storage));
+
+    // enough to wrap the ring a few times
+    std::vector<Sample> recorded;
+    uint32_t random = 1;
+    for (size_t i = 0; i < 2000; i++) {
+        recorded.push_back(makeSample(i, &random));
+        blackbox.record(recorded.back());
+    }
+    blackbox.trigger(Blackbox::TRIGGER_COMMAND);
+    for (size_t i = 0; i <= Blackbox::POST_TRIGGER_SAMPLES; i++) {
+        recorded.push_back(makeSample(recorded.size(), &random));
+        blackbox.record(recorded.back());
+    }
+    CHECK(blackbox.isFrozen());
+    // the sample that froze the recording isn't in it
+    recorded.pop_back();
+
+    FILE * const file = tmpfile();
+    BaseChannel channel = { file };
+    blackbox.dump(&channel);
+    rewind(file);
+    std::vector<Sample> decoded;
+    CHECK(Replay::readDump(file, &decoded));
+    fclose(file);
+
+    // oldest blocks are overwritten; what is left is the newest run of samples
+    CHECK(decoded.size() > (NUM_BLOCKS - 1) * Blackbox::BLOCK_SIZE / (5 * Blackbox::NUM_FIELDS));
+    CHECK(decoded.size() <= recorded.size());
+    const size_t offset = recorded.size() - decoded.size();
+    for (size_t i = 0; i < decoded.size(); i++) {
+        CHECK(equal(decoded[i], recorded[offset + i]));
+    }
+}
+
+TEST(blackboxRearm) {
+    static uint8_t storage[NUM_BLOCKS * Blackbox::BLOCK_SIZE];
+    Blackbox blackbox(storage, sizeof(storage));
+    uint32_t random = 7;
+    for (size_t i = 0; i < 500; i++) {
+        blackbox.record(makeSample(i, &random));
+    }
+    blackbox.rearm();
+    const Sample sample = makeSample(0, &random);
+    blackbox.record(sample);
+
+    Sample decoded[2];
+    CHECK(Blackbox::decodeBlock(storage, decoded, 2) == 1);
+    CHECK(equal(decoded[0], sample));
+    CHECK(!blackbox.isFrozen());
+    CHECK(blackbox.getTrigger() == Blackbox::TRIGGER_NONE);
+}
+
+TEST(blackboxCorruptBlockStaysInBounds) {
+    static uint8_t storage[NUM_BLOCKS * Blackbox::BLOCK_SIZE];
+    Blackbox blackbox(storage, sizeof(storage));
+    uint32_t random = 3;
+    Sample recorded[4];
+    for (size_t i = 0; i < 4; i++) {
+        recorded[i] = makeSample(i, &random);
+        blackbox.record(recorded[i]);
+    }
+
+    // a length that cuts the last sample short drops just that sample
+    Blackbox::BlockHeader * const header = reinterpret_cast<Blackbox::BlockHeader *>(storage);
+    const uint16_t length = header->length;
+    header->length = length - 1;
+    Sample decoded[8];
+    CHECK(Blackbox::decodeBlock(storage, decoded, 8) == 3);
+    CHECK(equal(decoded[2], recorded[2]));
+
+    // garbage with an oversized length and count decodes only as many
+    // full-width samples as fit in the block
+    static uint8_t block[Blackbox::BLOCK_SIZE];
+    memset(block, 0xff, sizeof(block));
+    Blackbox::BlockHeader * const bad = reinterpret_cast<Blackbox::BlockHeader *>(block);
+    bad->count = 0xffff;
+    bad->length = 0xffff;
+    static Sample garbage[Blackbox::BLOCK_SIZE];
+    CHECK(Blackbox::decodeBlock(block, garbage, Blackbox::BLOCK_SIZE)
+            == (Blackbox::BLOCK_SIZE - sizeof(Blackbox::BlockHeader)) / (5 * (Blackbox::NUM_FIELDS + 1)));
+}
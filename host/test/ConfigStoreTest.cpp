@@ -0,0 +1,296 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "ConfigStore.h"
+
+#include <string.h>
+
+/*
+ * ConfigStore against the NOR flash mock, with power cuts from the mock's
+ * word budget. A cut store is dropped and the image mounted again, as after a
+ * reset.
+ */
+
+static constexpr size_t PAGE_SIZE = 512;
+static constexpr uint8_t VERSION = 3;
+
+struct Image {
+    uint32_t a[PAGE_SIZE / sizeof(uint32_t)];
+    uint32_t b[PAGE_SIZE / sizeof(uint32_t)];
+
+    Image() {
+        memset(a, 0xff, sizeof(a));
+        memset(b, 0xff, sizeof(b));
+    }
+
+    ConfigStore::Page pageA() {
+        const ConfigStore::Page page = { reinterpret_cast<uint8_t *>(a), sizeof(a), 10 };
+        return page;
+    }
+
+    ConfigStore::Page pageB() {
+        const ConfigStore::Page page = { reinterpret_cast<uint8_t *>(b), sizeof(b), 11 };
+        return page;
+    }
+};
+
+struct Value {
+    uint32_t words[6];
+};
+
+static Value makeValue(uint32_t seed) {
+    Value value;
+    for (size_t i = 0; i < 6; i++) {
+        value.words[i] = seed * 2654435761u + i;
+    }
+    return value;
+}
+
+static bool holds(const ConfigStore &store, uint8_t key, const Value &expected) {
+    Value value;
+    return store.read(key, VERSION, &value, sizeof(value)) && memcmp(&value, &expected, sizeof(value)) == 0;
+}
+
+// words the flash mock programs for an operation
+template<typename Operation>
+static int32_t flashWordsFor(Operation operation) {
+    static constexpr int32_t BUDGET = 1000000;
+    hw::mock::flashWordsLeft = BUDGET;
+    operation();
+    const int32_t used = BUDGET - hw::mock::flashWordsLeft;
+    hw::mock::flashWordsLeft = -1;
+    return used;
+}
+
+TEST(configStoreAppendAndRead) {
+    Image image;
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+
+    Value value;
+    CHECK(!store.read(ConfigStore::KEY_CONFIG, VERSION, &value, sizeof(value)));
+
+    const Value first = makeValue(1);
+    const Value second = makeValue(2);
+    const Value cal = makeValue(3);
+    CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &first, sizeof(first)));
+    CHECK(store.write(ConfigStore::KEY_GYRO_CAL, VERSION, &cal, sizeof(cal)));
+    CHECK(holds(store, ConfigStore::KEY_CONFIG, first));
+    CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &second, sizeof(second)));
+    CHECK(holds(store, ConfigStore::KEY_CONFIG, second));
+
+    // and the same after a reset
+    ConfigStore remounted(image.pageA(), image.pageB());
+    CHECK(remounted.mount());
+    CHECK(holds(remounted, ConfigStore::KEY_CONFIG, second));
+    CHECK(holds(remounted, ConfigStore::KEY_GYRO_CAL, cal));
+}
+
+TEST(configStoreSameValueNotRewritten) {
+    Image image;
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+    const Value value = makeValue(4);
+    CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &value, sizeof(value)));
+    const size_t used = store.getUsed();
+    CHECK(flashWordsFor([&] {
+        CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &value, sizeof(value)));
+    }) == 0);
+    CHECK(store.getUsed() == used);
+}
+
+TEST(configStoreVersionAndLengthMismatch) {
+    Image image;
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+    const Value value = makeValue(5);
+    CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &value, sizeof(value)));
+
+    Value read;
+    CHECK(!store.read(ConfigStore::KEY_CONFIG, VERSION + 1, &read, sizeof(read)));
+    CHECK(!store.read(ConfigStore::KEY_CONFIG, VERSION, &read, sizeof(read) - 4));
+    CHECK(!store.read(ConfigStore::KEY_GYRO_CAL, VERSION, &read, sizeof(read)));
+    CHECK(!store.read(ConfigStore::MAX_KEYS, VERSION, &read, sizeof(read)));
+    CHECK(!store.write(ConfigStore::MAX_KEYS, VERSION, &value, sizeof(value)));
+    CHECK(!store.write(ConfigStore::KEY_CONFIG, VERSION, &value, ConfigStore::MAX_RECORD_LENGTH + 1));
+}
+
+TEST(configStoreTornRecord) {
+    Image image;
+    const Value first = makeValue(6);
+    const Value second = makeValue(7);
+    {
+        ConfigStore store(image.pageA(), image.pageB());
+        CHECK(store.mount());
+        CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &first, sizeof(first)));
+        // header and payload are programmed, but power goes before the CRC
+        hw::mock::flashWordsLeft = 1 + sizeof(Value) / sizeof(uint32_t);
+        CHECK(!store.write(ConfigStore::KEY_CONFIG, VERSION, &second, sizeof(second)));
+        hw::mock::flashWordsLeft = -1;
+    }
+
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+    CHECK(holds(store, ConfigStore::KEY_CONFIG, first));
+    // the torn record is skipped over, not written into
+    CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &second, sizeof(second)));
+    CHECK(holds(store, ConfigStore::KEY_CONFIG, second));
+    ConfigStore remounted(image.pageA(), image.pageB());
+    CHECK(remounted.mount());
+    CHECK(holds(remounted, ConfigStore::KEY_CONFIG, second));
+}
+
+TEST(configStoreTornFormat) {
+    Image image;
+    {
+        // erase and the first header words, but not the header CRC
+        ConfigStore store(image.pageA(), image.pageB());
+        hw::mock::flashWordsLeft = 1 + 3;
+        CHECK(!store.mount());
+        hw::mock::flashWordsLeft = -1;
+    }
+
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+    const Value value = makeValue(8);
+    CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &value, sizeof(value)));
+    CHECK(holds(store, ConfigStore::KEY_CONFIG, value));
+}
+
+/*
+ * Cuts power after every possible number of words of a compaction. Up to the
+ * last word, the header CRC, the old page must stay active with all values.
+ */
+TEST(configStoreCompactionPowerCut) {
+    const Value config = makeValue(9);
+    const Value cal = makeValue(10);
+    Image before;
+    {
+        ConfigStore store(before.pageA(), before.pageB());
+        CHECK(store.mount());
+        const Value old = makeValue(11);
+        CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &old, sizeof(old)));
+        CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &config, sizeof(config)));
+        CHECK(store.write(ConfigStore::KEY_GYRO_CAL, VERSION, &cal, sizeof(cal)));
+    }
+
+    Image image = before;
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+    const uint32_t sequence = store.getSequence();
+    const int32_t words = flashWordsFor([&] {
+        CHECK(store.compact());
+    });
+    CHECK(store.getSequence() == sequence + 1);
+    CHECK(words > 4);
+
+    for (int32_t budget = 0; budget < words; budget++) {
+        Image cut = before;
+        {
+            ConfigStore cutStore(cut.pageA(), cut.pageB());
+            CHECK(cutStore.mount());
+            hw::mock::flashWordsLeft = budget;
+            CHECK(!cutStore.compact());
+            hw::mock::flashWordsLeft = -1;
+        }
+
+        ConfigStore remounted(cut.pageA(), cut.pageB());
+        CHECK(remounted.mount());
+        CHECK(remounted.getSequence() == sequence);
+        CHECK(holds(remounted, ConfigStore::KEY_CONFIG, config));
+        CHECK(holds(remounted, ConfigStore::KEY_GYRO_CAL, cal));
+
+        // and the store keeps working, compacting over the half-written page
+        const Value next = makeValue(budget);
+        CHECK(remounted.write(ConfigStore::KEY_CONFIG, VERSION, &next, sizeof(next)));
+        CHECK(remounted.compact());
+        CHECK(holds(remounted, ConfigStore::KEY_CONFIG, next));
+        CHECK(holds(remounted, ConfigStore::KEY_GYRO_CAL, cal));
+    }
+}
+
+static const ConfigStore::PageHeader &header(const uint32_t *page) {
+    return *reinterpret_cast<const ConfigStore::PageHeader *>(page);
+}
+
+TEST(configStoreWraparound) {
+    Image image;
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+    const Value cal = makeValue(12);
+    CHECK(store.write(ConfigStore::KEY_GYRO_CAL, VERSION, &cal, sizeof(cal)));
+
+    // fills and compacts each page several times over
+    const uint32_t sequence = store.getSequence();
+    const size_t writes = 8 * PAGE_SIZE / sizeof(Value);
+    for (size_t i = 0; i < writes; i++) {
+        const Value value = makeValue(100 + i);
+        CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &value, sizeof(value)));
+        CHECK(holds(store, ConfigStore::KEY_CONFIG, value));
+    }
+    CHECK(store.getSequence() - sequence >= 4);
+    // both pages were active in turn, the newer one last
+    const uint32_t sequenceA = header(image.a).sequence;
+    const uint32_t sequenceB = header(image.b).sequence;
+    CHECK(sequenceA == store.getSequence() || sequenceB == store.getSequence());
+    CHECK(sequenceA + 1 == sequenceB || sequenceB + 1 == sequenceA);
+
+    ConfigStore remounted(image.pageA(), image.pageB());
+    CHECK(remounted.mount());
+    CHECK(remounted.getSequence() == store.getSequence());
+    CHECK(holds(remounted, ConfigStore::KEY_CONFIG, makeValue(100 + writes - 1)));
+    CHECK(holds(remounted, ConfigStore::KEY_GYRO_CAL, cal));
+}
+
+TEST(configStoreSequenceWraparound) {
+    Image image;
+    const Value value = makeValue(13);
+    {
+        ConfigStore store(image.pageA(), image.pageB());
+        CHECK(store.mount());
+        CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &value, sizeof(value)));
+    }
+    // age the active page A to just short of the sequence counter wrapping
+    ConfigStore::PageHeader &aged = *reinterpret_cast<ConfigStore::PageHeader *>(image.a);
+    aged.sequence = 0xfffffffe;
+    aged.crc = ConfigStore::crc32(0, &aged, offsetof(ConfigStore::PageHeader, crc));
+
+    ConfigStore store(image.pageA(), image.pageB());
+    CHECK(store.mount());
+    CHECK(store.getSequence() == 0xfffffffe);
+    CHECK(store.compact());
+    CHECK(store.compact());
+    const Value next = makeValue(14);
+    CHECK(store.write(ConfigStore::KEY_CONFIG, VERSION, &next, sizeof(next)));
+    CHECK(store.getSequence() == 0);
+
+    // sequence 0 on page A is newer than 0xffffffff on page B
+    ConfigStore remounted(image.pageA(), image.pageB());
+    CHECK(remounted.mount());
+    CHECK(remounted.getSequence() == 0);
+    CHECK(holds(remounted, ConfigStore::KEY_CONFIG, next));
+}
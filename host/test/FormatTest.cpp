@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "Format.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// output of printFixed
+static void format(float value, size_t places, char *output, size_t size) {
+    FILE * const file = tmpfile();
+    BaseChannel channel = { file };
+    printFixed(&channel, value, places);
+    rewind(file);
+    const size_t length = fread(output, 1, size - 1, file);
+    output[length] = '\0';
+    fclose(file);
+}
+
+TEST(formatFixedCarries) {
+    char output[32];
+    format(2.9999995f, 6, output, sizeof(output));
+    CHECK(strcmp(output, "3.000000") == 0);
+    format(0.996f, 2, output, sizeof(output));
+    CHECK(strcmp(output, "1.00") == 0);
+    format(-1.9999995f, 6, output, sizeof(output));
+    CHECK(strcmp(output, "-2.000000") == 0);
+}
+
+TEST(formatFixedPlaces) {
+    char output[32];
+    format(12.345f, 2, output, sizeof(output));
+    CHECK(strcmp(output, "12.35") == 0);
+    format(0.05f, 6, output, sizeof(output));
+    CHECK(strcmp(output, "0.050000") == 0);
+    format(7.5f, 0, output, sizeof(output));
+    CHECK(strcmp(output, "8") == 0);
+    format(-0.25f, 2, output, sizeof(output));
+    CHECK(strcmp(output, "-0.25") == 0);
+}
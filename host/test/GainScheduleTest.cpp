@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "GainSchedule.h"
+
+static const GainSchedule::Gains BASE = { 1.f, 2.f, 0.01f };
+static const float SCALES[GainSchedule::NUM_POINTS - 1] = { 1.f, 1.5f, 2.f, 3.f };
+static constexpr int32_t RANGE = 1000;
+
+TEST(gainScheduleInterpolates) {
+    GainSchedule schedule;
+    schedule.configure(BASE, SCALES, RANGE);
+    CHECK(schedule.getScale() == 1.f);
+    CHECK(!schedule.update(0));
+
+    CHECK(schedule.update(RANGE / 2));
+    CHECK(schedule.getScale() == 1.5f);
+    CHECK(schedule.getGains().kp == 1.5f);
+    CHECK(schedule.getGains().ki == 3.f);
+    // a command between breakpoints lands between their scales
+    CHECK(schedule.update(RANGE * 5 / 8));
+    CHECK_NEAR(schedule.getScale(), 1.75f, 1e-6f);
+    // commands past full clamp
+    CHECK(schedule.update(RANGE * 2));
+    CHECK(schedule.getScale() == 3.f);
+    CHECK(!schedule.update(RANGE));
+}
+
+TEST(gainScheduleKeptRetuneKeepsGains) {
+    GainSchedule schedule;
+    schedule.configure(BASE, SCALES, RANGE);
+    schedule.update(RANGE * 3 / 4);
+    const float foundScale = schedule.getScale();
+
+    // an autotune result found at this command, kept the way "autotune keep"
+    // stores it
+    const GainSchedule::Gains found = { 4.f, 7.f, 0.03f };
+    schedule.retune(found, foundScale);
+    const GainSchedule::Gains live = schedule.getGains();
+    const GainSchedule::Gains kept = { found.kp / foundScale, found.ki / foundScale, found.kd / foundScale };
+    CHECK(schedule.getBase().kp == kept.kp);
+    CHECK(schedule.getBase().ki == kept.ki);
+    CHECK(schedule.getBase().kd == kept.kd);
+
+    // reapplying the config with the kept gains changes nothing
+    schedule.configure(kept, SCALES, RANGE);
+    CHECK(schedule.getGains().kp == live.kp);
+    CHECK(schedule.getGains().ki == live.ki);
+    CHECK(schedule.getGains().kd == live.kd);
+    CHECK_NEAR(schedule.getGains().kp, found.kp, 1e-5f);
+}
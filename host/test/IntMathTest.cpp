@@ -0,0 +1,83 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "IntMath.h"
+#include "HFCS.h"
+
+TEST(nabsValues) {
+    CHECK(nabs(0) == 0);
+    CHECK(nabs(5) == -5);
+    CHECK(nabs(-5) == -5);
+    CHECK(nabs(INT32_MAX) == -INT32_MAX);
+    // defined where abs() isn't
+    CHECK(nabs(INT32_MIN) == INT32_MIN);
+}
+
+TEST(avgRoundsTowardZero) {
+    CHECK(avg(2, 4) == 3);
+    CHECK(avg(3, 4) == 3);
+    CHECK(avg(-3, -4) == -3);
+    CHECK(avg(-3, 4) == 0);
+    CHECK(avg(3, -4) == 0);
+    CHECK(avg(-5, 0) == -2);
+}
+
+TEST(avgDoesNotOverflow) {
+    CHECK(avg(INT32_MAX, INT32_MAX) == INT32_MAX);
+    CHECK(avg(INT32_MIN, INT32_MIN) == INT32_MIN);
+    CHECK(avg(INT32_MAX, INT32_MIN) == 0);
+    CHECK(avg(INT32_MAX, INT32_MAX - 2) == INT32_MAX - 1);
+}
+
+TEST(signumValues) {
+    CHECK(signum(0) == 0);
+    CHECK(signum(42) == 1);
+    CHECK(signum(-42) == -1);
+    CHECK(signum(INT32_MIN) == -1);
+}
+
+TEST(mapRangesEnds) {
+    CHECK(HFCS::mapRanges(1000, 2000, 1000, -500, 500, 0) == -500);
+    CHECK(HFCS::mapRanges(1000, 2000, 1500, -500, 500, 0) == 0);
+    CHECK(HFCS::mapRanges(1000, 2000, 2000, -500, 500, 0) == 500);
+    CHECK(HFCS::mapRanges(1000, 2000, 1250, 0, 100, 0) == 25);
+}
+
+TEST(mapRangesClamps) {
+    CHECK(HFCS::mapRanges(1000, 2000, 500, -500, 500, 0) == -500);
+    CHECK(HFCS::mapRanges(1000, 2000, 2600, -500, 500, 0) == 500);
+}
+
+TEST(mapRangesDeadband) {
+    // inputs within the deadband of center map to center
+    CHECK(HFCS::mapRanges(1000, 2000, 1520, -500, 500, 20) == 0);
+    CHECK(HFCS::mapRanges(1000, 2000, 1480, -500, 500, 20) == 0);
+    // and the rest of the range is stretched to still reach the ends
+    CHECK(HFCS::mapRanges(1000, 2000, 1521, -500, 500, 20) == 1);
+    CHECK(HFCS::mapRanges(1000, 2000, 2000, -500, 500, 20) == 500);
+    CHECK(HFCS::mapRanges(1000, 2000, 1000, -500, 500, 20) == -500);
+}
@@ -0,0 +1,185 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "Params.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// output of a parameter shell command
+static void shell(Params *params, const char *command, const char *name, char *output, size_t size) {
+    Params::instance = params;
+    FILE * const file = tmpfile();
+    BaseChannel channel = { file };
+    char *argv[] = { const_cast<char *>(command), const_cast<char *>(name) };
+    Params::shellCommand(&channel, 2, argv);
+    rewind(file);
+    const size_t length = fread(output, 1, size - 1, file);
+    output[length] = '\0';
+    fclose(file);
+}
+
+TEST(paramsDefaultsValid) {
+    CHECK(Params::validate(Params::defaults));
+}
+
+TEST(paramsTableMatchesDefaults) {
+    Params params;
+    for (size_t i = 0; i < Params::NUM_PARAMS; i++) {
+        const Params::Param &param = Params::table[i];
+        const float value = params.get(param);
+        CHECK(value >= param.min && value <= param.max);
+        CHECK(params.find(param.name) == &param);
+    }
+    CHECK(params.find("no_such_param") == NULL);
+}
+
+TEST(paramsValidateRanges) {
+    Config config = Params::defaults;
+    config.kp = -1.f;
+    CHECK(!Params::validate(config));
+
+    config = Params::defaults;
+    config.yawRate = 100000;
+    CHECK(!Params::validate(config));
+}
+
+TEST(paramsValidateConstraints) {
+    // deadband may not swallow the whole input range
+    Config config = Params::defaults;
+    config.inputDeadband = (config.inputHigh - config.inputLow) / 2;
+    CHECK(!Params::validate(config));
+
+    config = Params::defaults;
+    config.dynNotchMinHz = config.dynNotchMaxHz;
+    CHECK(!Params::validate(config));
+}
+
+TEST(paramsSetSwapsOnUpdate) {
+    Params params;
+    const Params::Param * const kp = params.find("kp");
+    const Params::Param * const yawRate = params.find("yaw_rate");
+    CHECK(!params.update());
+
+    CHECK(params.set(*kp, 1.25f));
+    // the control thread keeps seeing the old config until it swaps
+    CHECK(params.active().kp == Params::defaults.kp);
+    CHECK(params.update());
+    CHECK(params.active().kp == 1.25f);
+    CHECK(!params.update());
+
+    // the next edit starts from the new active config, not the stale buffer
+    CHECK(params.set(*yawRate, 360.f));
+    CHECK(params.update());
+    CHECK(params.active().kp == 1.25f);
+    CHECK(params.active().yawRate == 360);
+}
+
+TEST(paramsRejectedSetKeepsConfig) {
+    Params params;
+    const Params::Param * const kp = params.find("kp");
+    const Params::Param * const inputHigh = params.find("input_high");
+
+    CHECK(!params.set(*kp, kp->max * 2.f));
+    CHECK(!params.update());
+    // in range on its own, but leaves no input range
+    CHECK(!params.set(*inputHigh, float(Params::defaults.inputLow)));
+    CHECK(!params.update());
+    CHECK(params.active().kp == Params::defaults.kp);
+    CHECK(params.active().inputHigh == Params::defaults.inputHigh);
+}
+
+TEST(paramsEditSwapsTogether) {
+    Params params;
+    Config &config = params.beginEdit();
+    config.kp = 1.5f;
+    config.ki = 3.f;
+    config.kd = 0.02f;
+    CHECK(params.commitEdit());
+    CHECK(params.active().kp == Params::defaults.kp);
+    CHECK(params.active().ki == Params::defaults.ki);
+    CHECK(params.update());
+    CHECK(params.active().kp == 1.5f);
+    CHECK(params.active().ki == 3.f);
+    CHECK(params.active().kd == 0.02f);
+
+    // one field out of range rejects the whole edit
+    Config &rejected = params.beginEdit();
+    rejected.kp = 2.f;
+    rejected.ki = -1.f;
+    CHECK(!params.commitEdit());
+    CHECK(!params.update());
+    CHECK(params.active().kp == 1.5f);
+}
+
+TEST(paramsLoad) {
+    Params params;
+    Config config = Params::defaults;
+    config.ki = 42.f;
+    config.headingKp = 3.f;
+    CHECK(params.load(config));
+    CHECK(params.update());
+    CHECK(params.active().ki == 42.f);
+    CHECK(params.active().headingKp == 3.f);
+
+    config.inputHigh = config.inputLow;
+    CHECK(!params.load(config));
+    CHECK(!params.update());
+    CHECK(params.active().inputHigh == Params::defaults.inputHigh);
+}
+
+TEST(paramsPrintRounds) {
+    Params params;
+    char output[64];
+    // the fraction rounds up into the whole part
+    CHECK(params.set(*params.find("kp"), 0.99999995f));
+    params.update();
+    shell(&params, "get", "kp", output, sizeof(output));
+    CHECK(strcmp(output, "kp = 1.000000\r\n") == 0);
+
+    CHECK(params.set(*params.find("kp"), 2.5f));
+    params.update();
+    shell(&params, "get", "kp", output, sizeof(output));
+    CHECK(strcmp(output, "kp = 2.500000\r\n") == 0);
+
+    CHECK(params.set(*params.find("kp"), 0.0000004f));
+    params.update();
+    shell(&params, "get", "kp", output, sizeof(output));
+    CHECK(strcmp(output, "kp = 0.000000\r\n") == 0);
+
+    shell(&params, "get", "yaw_rate", output, sizeof(output));
+    CHECK(strcmp(output, "yaw_rate = 720\r\n") == 0);
+}
+
+TEST(paramsIntegerTruncates) {
+    Params params;
+    const Params::Param * const yawRate = params.find("yaw_rate");
+    CHECK(params.set(*yawRate, 400.9f));
+    params.update();
+    CHECK(params.active().yawRate == 400);
+    CHECK(params.get(*yawRate) == 400.f);
+}
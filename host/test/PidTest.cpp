@@ -0,0 +1,198 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "Pid.hpp"
+
+#include <math.h>
+
+typedef PidNs::Pid<float, float> Pid;
+
+static constexpr float PERIOD_MS = 5.f;
+static constexpr float LIMIT = 1000.f;
+
+static void init(Pid *pid, float kp, float ki, float kd) {
+    pid->Init(kp, ki, kd, Pid::PID_DIRECT, Pid::DONT_ACCUMULATE_OUTPUT, PERIOD_MS, -LIMIT, LIMIT, 0.f);
+}
+
+TEST(pidProportional) {
+    Pid pid;
+    init(&pid, 2.f, 0.f, 0.f);
+    pid.setPoint = 10.f;
+    pid.Run(4.f);
+    CHECK(pid.output == 12.f);
+    pid.Run(14.f);
+    CHECK(pid.output == -8.f);
+}
+
+TEST(pidOutputLimits) {
+    Pid pid;
+    init(&pid, 100.f, 0.f, 0.f);
+    pid.setPoint = 100.f;
+    pid.Run(0.f);
+    CHECK(pid.output == LIMIT);
+    pid.setPoint = -100.f;
+    pid.Run(0.f);
+    CHECK(pid.output == -LIMIT);
+}
+
+TEST(pidIntegral) {
+    Pid pid;
+    init(&pid, 0.f, 10.f, 0.f);
+    pid.setPoint = 1.f;
+    // ki times the period per step
+    for (int i = 0; i < 4; i++) {
+        pid.Run(0.f);
+    }
+    CHECK_NEAR(pid.GetITerm(), 0.2f, 1e-6);
+    CHECK_NEAR(pid.output, 0.2f, 1e-6);
+}
+
+TEST(pidIntegralLimited) {
+    Pid pid;
+    init(&pid, 0.f, 1e6f, 0.f);
+    pid.setPoint = 1.f;
+    pid.Run(0.f);
+    CHECK(pid.GetITerm() == LIMIT);
+}
+
+TEST(pidRetuneKeepsIntegral) {
+    Pid pid;
+    init(&pid, 1.f, 10.f, 0.f);
+    pid.setPoint = 1.f;
+    pid.Run(0.f);
+    pid.Run(0.f);
+    const float integral = pid.GetITerm();
+    pid.SetTunings(3.f, 20.f, 0.f);
+    CHECK(pid.GetITerm() == integral);
+    CHECK(pid.GetKp() == 3.f);
+    CHECK(pid.GetKi() == 20.f);
+}
+
+TEST(pidRejectsNegativeGains) {
+    Pid pid;
+    init(&pid, 1.f, 2.f, 3.f);
+    pid.SetTunings(-1.f, 2.f, 3.f);
+    CHECK(pid.GetKp() == 1.f);
+}
+
+TEST(pidDerivativeOnMeasurement) {
+    Pid pid;
+    init(&pid, 0.f, 0.f, 0.01f);
+    // no derivative on the first run, which has no previous input
+    pid.Run(5.f);
+    CHECK(pid.output == 0.f);
+    // kd over the period, against the input change; set point steps don't kick
+    pid.setPoint = 100.f;
+    pid.Run(8.f);
+    CHECK_NEAR(pid.output, -6.f, 1e-4);
+}
+
+TEST(pidDerivativeFilter) {
+    Pid pid;
+    init(&pid, 0.f, 0.f, 0.01f);
+    pid.SetDerivativeFilter(10.f);
+    pid.Run(0.f);
+    pid.Run(3.f);
+    // first-order response to the same step is smaller but of the same sign
+    CHECK(pid.output < 0.f && pid.output > -6.f);
+    const float first = pid.output;
+    pid.Run(3.f);
+    CHECK(pid.output < 0.f && pid.output > first);
+}
+
+TEST(pidFeedForward) {
+    Pid pid;
+    init(&pid, 0.f, 0.f, 0.f);
+    pid.SetFeedForward(0.5f);
+    pid.setPoint = 40.f;
+    pid.Run(40.f);
+    CHECK(pid.output == 20.f);
+}
+
+TEST(pidSetpointWeight) {
+    Pid pid;
+    init(&pid, 2.f, 0.f, 0.f);
+    pid.SetSetpointWeight(0.5f);
+    pid.setPoint = 10.f;
+    pid.Run(0.f);
+    CHECK(pid.output == 10.f);
+    // disturbances still see the full gain
+    pid.setPoint = 0.f;
+    pid.Run(3.f);
+    CHECK(pid.output == -6.f);
+}
+
+TEST(pidReverse) {
+    Pid pid;
+    pid.Init(2.f, 0.f, 0.f, Pid::PID_REVERSE, Pid::DONT_ACCUMULATE_OUTPUT, PERIOD_MS, -LIMIT, LIMIT, 10.f);
+    pid.Run(4.f);
+    CHECK(pid.output == -12.f);
+}
+
+TEST(pidSetDirection) {
+    Pid pid;
+    init(&pid, 2.f, 0.f, 0.f);
+    pid.SetControllerDirection(Pid::PID_REVERSE);
+    pid.setPoint = 10.f;
+    pid.Run(4.f);
+    CHECK(pid.output == -12.f);
+    // setting the same direction again changes nothing
+    pid.SetControllerDirection(Pid::PID_REVERSE);
+    pid.Run(4.f);
+    CHECK(pid.output == -12.f);
+    pid.SetControllerDirection(Pid::PID_DIRECT);
+    pid.Run(4.f);
+    CHECK(pid.output == 12.f);
+}
+
+TEST(pidNominalPeriodMatchesRun) {
+    Pid fixed;
+    Pid measured;
+    init(&fixed, 1.5f, 30.f, 0.02f);
+    init(&measured, 1.5f, 30.f, 0.02f);
+    fixed.setPoint = measured.setPoint = 50.f;
+    for (int i = 0; i < 20; i++) {
+        const float input = i * 3.f;
+        fixed.Run(input);
+        measured.Run(input, PERIOD_MS);
+        CHECK(fixed.output == measured.output);
+    }
+}
+
+TEST(pidMeasuredPeriodScalesIntegral) {
+    Pid pid;
+    init(&pid, 0.f, 10.f, 0.f);
+    pid.setPoint = 1.f;
+    pid.Run(0.f, 2.f * PERIOD_MS);
+    CHECK_NEAR(pid.GetITerm(), 0.1f, 1e-6);
+    // periods are clamped, here to four times nominal
+    pid.Run(0.f, 100.f * PERIOD_MS);
+    CHECK_NEAR(pid.GetITerm(), 0.3f, 1e-6);
+    // a bad timestamp is treated as the shortest period
+    pid.Run(0.f, NAN);
+    CHECK_NEAR(pid.GetITerm(), 0.3125f, 1e-6);
+}
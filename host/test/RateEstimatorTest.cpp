@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+#include "RateEstimator.h"
+
+static const RateEstimator::Model MODEL = { 0.05f, 10.f, 50.f, 100.f };
+static constexpr float DT = 0.005f;
+
+TEST(rateEstimatorTracksReadings) {
+    RateEstimator estimator;
+    estimator.configure(MODEL, DT);
+    estimator.update(0, 0);
+    // drive that the model says turns at the rate read
+    estimator.command(100);
+    for (int i = 0; i < 200; i++) {
+        estimator.update(1000, 1000);
+    }
+    CHECK_NEAR(estimator.getRate(), 1000.f, 10.f);
+    CHECK(!estimator.isSaturated());
+}
+
+TEST(rateEstimatorSaturatesOnRawReading) {
+    RateEstimator estimator;
+    estimator.configure(MODEL, DT);
+    estimator.update(0, 0);
+    estimator.update(0, 0);
+    const float before = estimator.getRate();
+
+    // a clipped reading that the bias and filters brought under the limit, and
+    // even turned around, still coasts on the model
+    estimator.update(-5000, 32767);
+    CHECK(estimator.isSaturated());
+    CHECK(estimator.getRate() == before);
+    estimator.update(31000, -32768);
+    CHECK(estimator.isSaturated());
+
+    // a corrected value past the limit from an unclipped reading is used
+    estimator.update(32500, 31900);
+    CHECK(!estimator.isSaturated());
+}
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Test.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace test {
+
+struct Case {
+    const char *name;
+    Function function;
+};
+
+static constexpr size_t MAX_CASES = 256;
+static Case cases[MAX_CASES];
+static size_t numCases = 0;
+static size_t failedChecks = 0;
+
+Registrar::Registrar(const char *name, Function function) {
+    if (numCases == MAX_CASES) {
+        fprintf(stderr, "too many tests, raise MAX_CASES\n");
+        abort();
+    }
+    cases[numCases].name = name;
+    cases[numCases].function = function;
+    numCases++;
+}
+
+void check(bool passed, const char *expression, const char *file, int line) {
+    if (!passed) {
+        printf("%s:%d: check failed: %s\n", file, line, expression);
+        failedChecks++;
+    }
+}
+
+bool near(double a, double b, double tolerance) {
+    return fabs(a - b) <= tolerance;
+}
+
+}
+
+/*
+ * Runs every registered test, or only those whose names contain the first
+ * argument. Exits with failure if any check failed.
+ */
+int main(int argc, char *argv[]) {
+    const char * const filter = argc > 1 ? argv[1] : NULL;
+    size_t run = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < test::numCases; i++) {
+        const test::Case &c = test::cases[i];
+        if (filter != NULL && strstr(c.name, filter) == NULL) {
+            continue;
+        }
+        const size_t before = test::failedChecks;
+        c.function();
+        run++;
+        if (test::failedChecks != before) {
+            printf("FAIL %s\n", c.name);
+            failed++;
+        }
+    }
+    printf("%u tests, %u failed\n", unsigned(run), unsigned(failed));
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
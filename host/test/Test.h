@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stddef.h>
+
+/**
+ * Minimal unit test registry for the host build. Each TEST() registers
+ * itself before main() runs; a failed CHECK() reports its location and fails
+ * the test without stopping it, so one run shows every broken expectation.
+ */
+namespace test {
+
+typedef void (*Function)();
+
+struct Registrar {
+    Registrar(const char *name, Function function);
+};
+
+void check(bool passed, const char *expression, const char *file, int line);
+bool near(double a, double b, double tolerance);
+
+}
+
+#define TEST(name) \
+    static void name(); \
+    static const test::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(expression) test::check((expression), #expression, __FILE__, __LINE__)
+
+#define CHECK_NEAR(a, b, tolerance) \
+    test::check(test::near((a), (b), (tolerance)), #a " near " #b, __FILE__, __LINE__)
+
+#endif /* TEST_H_ */
@@ -0,0 +1,132 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Harness.h"
+#include "Experiments.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Runs the relay autotune against the robot model the way a driver would:
+ * holds the stick command with the aux switch up, lets go of the sticks, and
+ * waits for the experiment. Then keeps the gains it found with the shell's
+ * "autotune keep" and measures step responses with them. Exits with failure
+ * if the autotune fails, if the kept gains aren't the found ones at idle
+ * weapon, or if the tuned loop is slow or overshoots much. "make check" runs
+ * it.
+ */
+
+static constexpr uint32_t COMMAND_MS = 1200;
+static constexpr uint32_t MAX_WAIT_MS = 8000;
+static constexpr uint32_t STEP_MS = 1000;
+static constexpr float MAX_RISE_MS = 200.f;
+static constexpr float MAX_OVERSHOOT = 40.f;
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-r relay] [-h hysteresis] [-s seed]\n", name);
+    exit(EXIT_FAILURE);
+}
+
+static bool printStep(const char *name, const Experiments::StepResponse &r) {
+    printf("%s step to %.0f deg/s: rise %.1f ms, overshoot %.1f %%, rms error %.1f deg/s\n",
+            name, r.target, r.riseTime, r.overshoot, r.rmsError);
+    return r.riseTime < MAX_RISE_MS && r.overshoot < MAX_OVERSHOOT;
+}
+
+int main(int argc, char *argv[]) {
+    Config config = Params::defaults;
+    uint32_t seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:h:s:")) != -1) {
+        switch (opt) {
+        case 'r':
+            config.autotuneRelay = strtof(optarg, NULL);
+            break;
+        case 'h':
+            config.autotuneHysteresis = strtol(optarg, NULL, 0);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (!Params::validate(config)) {
+        fprintf(stderr, "invalid parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    static Harness harness(config, RobotModel::defaults, seed);
+    harness.init();
+    harness.setReceiver(true);
+    harness.run(500);
+
+    // stick command with the aux switch up, then let go
+    harness.setChannel(4, Harness::STICK_HIGH);
+    harness.setChannel(3, Harness::STICK_HIGH);
+    harness.run(COMMAND_MS);
+    harness.setChannel(3, Harness::STICK_CENTER);
+    harness.setChannel(4, Harness::STICK_CENTER);
+
+    const Autotune &autotune = harness.getHfcs().getAutotune();
+    uint32_t waited = 0;
+    do {
+        harness.run(100);
+        waited += 100;
+    } while (autotune.getState() != Autotune::DONE && autotune.getState() != Autotune::FAILED
+            && waited < MAX_WAIT_MS);
+
+    if (autotune.getState() != Autotune::DONE) {
+        printf("autotune failed after %u ms\n", waited);
+        return EXIT_FAILURE;
+    }
+    const Autotune::Result &result = autotune.getResult();
+    printf("relay %.2f of full drive, hysteresis %d\n", config.autotuneRelay, int(config.autotuneHysteresis));
+    printf("ultimate gain %g, period %.1f ms, amplitude %.0f\n", result.ultimateGain,
+            result.ultimatePeriod * 1000, result.amplitude);
+    printf("kp %g ki %g kd %g, done within %u ms\n", result.kp, result.ki, result.kd, waited);
+
+    BaseChannel console = { stdout };
+    char keep[] = "keep";
+    char *keepArgv[] = { keep };
+    Autotune::shellCommand(&console, 1, keepArgv);
+    harness.run(500);
+    const Config &kept = harness.getParams().active();
+    if (kept.kp != result.kp / result.scale || kept.ki != result.ki / result.scale
+            || kept.kd != result.kd / result.scale) {
+        printf("FAIL: kept kp %g ki %g kd %g, gain scale %g\n", kept.kp, kept.ki, kept.kd, result.scale);
+        return EXIT_FAILURE;
+    }
+
+    const bool right = printStep("right", Experiments::yawStep(harness, true, STEP_MS));
+    const bool left = printStep("left", Experiments::yawStep(harness, false, STEP_MS));
+    printf("%s\n", right && left ? "pass" : "FAIL");
+    return right && left ? EXIT_SUCCESS : EXIT_FAILURE;
+}
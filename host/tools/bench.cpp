@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Runs the control-path microbenchmarks on the host and prints them as CSV,
+ * in the same columns as the robot's "bench" shell command.
+ */
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-n calls] [-r runs] [case...]\ncases:", name);
+    for (size_t i = 0; i < Bench::NUM_CASES; i++) {
+        fprintf(stderr, " %s", Bench::cases[i].name);
+    }
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+static void print(const Bench::Result &result) {
+    printf("bench,%s,%u,%u,%s,%.3f,%.3f,%.3f,%.3f\n", result.name, unsigned(result.calls), unsigned(result.runs),
+            hw::CYCLE_UNIT, result.min, result.median, result.mean, result.stddev);
+}
+
+int main(int argc, char *argv[]) {
+    // long runs keep clock reads out of the per-call figures
+    uint32_t calls = 100000;
+    size_t runs = 31;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+        switch (opt) {
+        case 'n':
+            calls = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            runs = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (calls == 0 || runs == 0 || runs > Bench::MAX_RUNS) {
+        usage(argv[0]);
+    }
+    for (int i = optind; i < argc; i++) {
+        if (Bench::find(argv[i]) == NULL) {
+            usage(argv[0]);
+        }
+    }
+
+    printf("bench,name,calls,runs,unit,min,median,mean,stddev\n");
+    if (optind == argc) {
+        for (size_t i = 0; i < Bench::NUM_CASES; i++) {
+            print(Bench::measure(Bench::cases[i], calls, runs));
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        print(Bench::measure(*Bench::find(argv[i]), calls, runs));
+    }
+    return EXIT_SUCCESS;
+}
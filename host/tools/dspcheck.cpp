@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "DspCheck.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Checks the host emulation of the DSP primitives against their reference
+ * code, as the robot's "dspcheck" shell command does for the instructions.
+ * Exits with failure on any mismatch. "make check" runs a shorter check.
+ */
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-n iterations] [-s seed] [case...]\ncases:", name);
+    for (size_t i = 0; i < DspCheck::NUM_CASES; i++) {
+        fprintf(stderr, " %s", DspCheck::cases[i].name);
+    }
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+static bool check(const DspCheck::Case &checkCase, uint32_t iterations, uint32_t seed) {
+    const DspCheck::Result result = DspCheck::run(checkCase, iterations, seed);
+    printf("dspcheck,%s,%u,%u", result.name, unsigned(result.checked), unsigned(result.failed));
+    if (result.failed != 0) {
+        printf(",%08x,%08x,%08x", unsigned(result.a), unsigned(result.b), unsigned(result.c));
+    }
+    printf("\n");
+    return result.failed == 0;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t iterations = 10000000;
+    uint32_t seed = DspCheck::DEFAULT_SEED;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        if (DspCheck::find(argv[i]) == NULL) {
+            usage(argv[0]);
+        }
+    }
+
+    bool passed = true;
+    printf("dspcheck,name,checked,failed,a,b,c\n");
+    if (optind == argc) {
+        for (size_t i = 0; i < DspCheck::NUM_CASES; i++) {
+            passed &= check(DspCheck::cases[i], iterations, seed);
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        passed &= check(*DspCheck::find(argv[i]), iterations, seed);
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Harness.h"
+#include "Experiments.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Measures the yaw controller against the robot model: step responses both
+ * ways, heading hold while the weapon spins up, and recovery from a hit.
+ * Gains default to Params::defaults.
+ */
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-p kp] [-i ki] [-d kd] [-y yaw_rate] [-s seed] [-t trace.csv]\n", name);
+    exit(EXIT_FAILURE);
+}
+
+static void printStep(const char *name, const Experiments::StepResponse &r) {
+    printf("%s step to %.0f deg/s\n", name, r.target);
+    printf("  command latency  %7.1f ms\n", r.commandLatency);
+    printf("  latency (10%%)    %7.1f ms\n", r.latency);
+    printf("  rise time        %7.1f ms\n", r.riseTime);
+    printf("  overshoot        %7.1f %%\n", r.overshoot);
+    printf("  settle time (%.0f%%) %6.1f ms\n", Experiments::SETTLE_BAND * 100, r.settleTime);
+    printf("  steady error     %7.2f %%\n", r.steadyError);
+    printf("  rms error        %7.1f deg/s\n", r.rmsError);
+    printf("  effort           %7.3f\n", r.effort);
+}
+
+static void printDisturbance(const char *name, const Experiments::Disturbance &d) {
+    printf("%s\n", name);
+    printf("  peak rate        %7.1f deg/s\n", d.peakRate);
+    printf("  heading change   %7.1f deg\n", d.heading);
+    printf("  recovery time    %7.1f ms\n", d.recoveryTime);
+}
+
+int main(int argc, char *argv[]) {
+    Config config = Params::defaults;
+    uint32_t seed = 1;
+    FILE *trace = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:i:d:y:s:t:")) != -1) {
+        switch (opt) {
+        case 'p':
+            config.kp = strtof(optarg, NULL);
+            break;
+        case 'i':
+            config.ki = strtof(optarg, NULL);
+            break;
+        case 'd':
+            config.kd = strtof(optarg, NULL);
+            break;
+        case 'y':
+            config.yawRate = strtol(optarg, NULL, 0);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            trace = fopen(optarg, "w");
+            if (trace == NULL) {
+                perror(optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (!Params::validate(config)) {
+        fprintf(stderr, "invalid parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    const clock_t start = clock();
+    const hw::Time simStart = hw::now();
+
+    static Harness harness(config, RobotModel::defaults, seed);
+    harness.init();
+    harness.setReceiver(true);
+    harness.run(500);
+
+    printf("kp %g ki %g kd %g yaw rate %d deg/s\n", config.kp, config.ki, config.kd, int(config.yawRate));
+    printStep("right", Experiments::yawStep(harness, true, 1000, trace));
+    printStep("left", Experiments::yawStep(harness, false, 1000));
+    printDisturbance("hit, 0.5 N m for 20 ms", Experiments::hit(harness, 0.5f, 20, 1000));
+    printDisturbance("weapon spin-up", Experiments::weaponSpinUp(harness, 3000));
+
+    const float wall = float(clock() - start) / CLOCKS_PER_SEC;
+    const float simulated = float(hw::now() - simStart) / hw::TICK_HZ;
+    printf("simulated %.1f s in %.2f s (%.0fx real time)\n", simulated, wall, simulated / wall);
+
+    if (trace != NULL) {
+        fclose(trace);
+    }
+    return EXIT_SUCCESS;
+}
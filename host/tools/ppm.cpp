@@ -0,0 +1,223 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "PpmGenerator.h"
+#include "PpmDecoder.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Stress bench for the PPM decoder behind HFCS::newPulse(). Captures from a
+ * PpmGenerator are delivered through a mock capture unit, with callbacks that
+ * do what HFCS's do, and every accepted frame is checked against the sticks
+ * that were sent.
+ *
+ * A false accept is a frame whose channels are off from the widths sent by
+ * more than the tolerance, which would drive the robot with garbage. A false
+ * reject is a clean frame that didn't decode, which brings the failsafe
+ * closer. Each frame counts once, by its worst outcome.
+ */
+
+static constexpr size_t BATCH_FRAMES = 65536;
+
+static PpmDecoder decoder;
+static hw::IcuCount negativeWidth;
+static hw::IcuCount positiveWidth;
+static int32_t channels[PpmDecoder::NUM_CHANNELS];
+static bool accepted;
+
+static void widthCb(hw::Icu *icup) {
+    negativeWidth = hw::icuWidthI(icup);
+}
+
+static void periodCb(hw::Icu *icup) {
+    positiveWidth = hw::icuPeriodI(icup) - negativeWidth;
+    accepted = decoder.pulse(negativeWidth, positiveWidth);
+    if (accepted) {
+        std::copy(decoder.getChannels(), decoder.getChannels() + PpmDecoder::NUM_CHANNELS, channels);
+    }
+}
+
+static double wallTime() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-n frames] [-c channels] [-f frame_ms] [-j jitter_us] [-d drop_rate]\n"
+            "          [-k spike_rate] [-K max_spike_us] [-S sync_jitter_us] [-t tolerance_us] [-s seed]\n", name);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    PpmGenerator::Parameters parameters = PpmGenerator::defaults;
+    size_t numFrames = 1000000;
+    int32_t tolerance = 10;
+    uint32_t seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:c:f:j:d:k:K:S:t:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            numFrames = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            parameters.channels = strtoul(optarg, NULL, 0);
+            break;
+        case 'f':
+            parameters.frameMs = strtof(optarg, NULL);
+            break;
+        case 'j':
+            parameters.jitter = strtol(optarg, NULL, 0);
+            break;
+        case 'd':
+            parameters.dropRate = strtof(optarg, NULL);
+            break;
+        case 'k':
+            parameters.spikeRate = strtof(optarg, NULL);
+            break;
+        case 'K':
+            parameters.maxSpike = strtol(optarg, NULL, 0);
+            break;
+        case 'S':
+            parameters.syncJitter = strtol(optarg, NULL, 0);
+            break;
+        case 't':
+            tolerance = strtol(optarg, NULL, 0);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    const int32_t longest = parameters.channels * (parameters.maxWidth + parameters.jitter) + parameters.syncJitter;
+    if (parameters.channels < 1 || parameters.channels > PpmGenerator::MAX_CHANNELS || parameters.jitter < 0
+            || parameters.maxSpike < 1 || parameters.syncJitter < 0 || longest >= parameters.frameMs * 1000.f) {
+        fprintf(stderr, "invalid signal parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu frames of %zu channels every %g ms, jitter %d us, sync jitter %d us\n", numFrames,
+            parameters.channels, parameters.frameMs, int(parameters.jitter), int(parameters.syncJitter));
+    printf("drop rate %g per channel, spike rate %g per segment up to %d us, tolerance %d us\n\n",
+            parameters.dropRate, parameters.spikeRate, int(parameters.maxSpike), int(tolerance));
+
+    PpmGenerator generator(parameters, seed);
+    hw::Icu icu = { widthCb, periodCb, true, 0, 0 };
+    const size_t checked = std::min(parameters.channels, PpmDecoder::NUM_CHANNELS);
+
+    size_t corrupted = 0;
+    size_t sent = 0;
+    size_t edges = 0;
+    size_t accepts = 0;
+    size_t falseAccepts = 0;
+    size_t falseRejects = 0;
+    size_t tolerated = 0;
+    double decodeTime = 0;
+
+    // frames from base on, the first left over from the last batch; one more
+    // than counted is sent, as a frame's last capture ends at the next sync
+    std::vector<PpmGenerator::Frame> frames;
+    std::vector<bool> decoded;
+    std::vector<bool> garbled;
+    std::vector<PpmGenerator::Capture> captures;
+    size_t base = 0;
+    while (sent <= numFrames) {
+        const size_t batch = std::min(BATCH_FRAMES, numFrames + 1 - sent);
+        captures.clear();
+        generator.generate(batch, &frames, &captures);
+        decoded.resize(frames.size(), false);
+        garbled.resize(frames.size(), false);
+        sent += batch;
+
+        const PpmDecoder resume = decoder;
+        const double start = wallTime();
+        for (size_t i = 0; i < captures.size(); i++) {
+            hw::mock::icuCapture(&icu, captures[i].width, captures[i].period);
+        }
+        decodeTime += wallTime() - start;
+        edges += 2 * captures.size();
+
+        // again from the same state, untimed, checking each accepted frame
+        decoder = resume;
+        for (size_t i = 0; i < captures.size(); i++) {
+            hw::mock::icuCapture(&icu, captures[i].width, captures[i].period);
+            const size_t f = captures[i].frame - base;
+            if (!accepted || f >= frames.size()) {
+                continue;
+            }
+            bool match = true;
+            for (size_t c = 0; c < checked && match; c++) {
+                match = labs(long(channels[c]) - frames[f].widths[c]) <= tolerance;
+            }
+            if (match) {
+                decoded[f] = true;
+            } else {
+                garbled[f] = true;
+            }
+        }
+
+        // the last frame may still be completed by the next batch; after the
+        // last batch it is the extra one, which isn't counted
+        const size_t settled = frames.size() - 1;
+        for (size_t f = 0; f < settled; f++) {
+            corrupted += frames[f].corrupted;
+            if (garbled[f]) {
+                accepts++;
+                falseAccepts++;
+            } else if (decoded[f]) {
+                accepts++;
+                tolerated += frames[f].corrupted;
+            } else if (!frames[f].corrupted) {
+                falseRejects++;
+            }
+        }
+        frames.erase(frames.begin(), frames.begin() + settled);
+        decoded.erase(decoded.begin(), decoded.begin() + settled);
+        garbled.erase(garbled.begin(), garbled.begin() + settled);
+        base += settled;
+    }
+
+    const size_t clean = numFrames - corrupted;
+    printf("frames          %10zu\n", numFrames);
+    printf("  clean         %10zu\n", clean);
+    printf("  corrupted     %10zu\n", corrupted);
+    printf("accepted        %10zu\n", accepts);
+    printf("false accepts   %10zu  %8.4f%% of accepted\n", falseAccepts, accepts ? 100.0 * falseAccepts / accepts : 0);
+    printf("false rejects   %10zu  %8.4f%% of clean\n", falseRejects, clean ? 100.0 * falseRejects / clean : 0);
+    printf("corrupted but decoded correctly %zu\n", tolerated);
+    printf("\n%zu edges decoded in %.3f s: %.2f M frames/s, %.2f ns per edge\n", edges, decodeTime,
+            sent / decodeTime / 1e6, decodeTime * 1e9 / edges);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "HFCS.h"
+#include "RangeMap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Checks RangeMap against HFCS::mapRanges(), its reference, for every 16-bit
+ * input capture over sweeps of the ranges the control loop can be configured
+ * with. Inputs for which the reference itself overflows are skipped and
+ * counted. Exits with failure on any mismatch. "make check" runs it.
+ */
+
+struct Output {
+    int32_t low;
+    int32_t high;
+};
+
+// the loop's outputs at default timer clocks, plus the widest allowed
+static const Output OUTPUTS[] = {
+        { 0, 4200 },        // weapon throttle
+        { -4941, 4941 },    // drive
+        { -11796, 11796 },  // yaw rate at 720 deg/s
+        { 0, 100 },         // recalibration command
+        { -100, 100 },
+        { 0, 65535 },
+        { -65535, 65535 },
+};
+static const size_t NUM_OUTPUTS = sizeof(OUTPUTS) / sizeof(OUTPUTS[0]);
+
+static const int32_t DEADBANDS[] = { 0, 17, 200 };
+static const size_t NUM_DEADBANDS = sizeof(DEADBANDS) / sizeof(DEADBANDS[0]);
+
+static const int32_t NUM_INPUTS = 1 << 16;
+static const size_t MAX_REPORTED = 10;
+
+struct Totals {
+    uint64_t configs;
+    uint64_t compared;
+    uint64_t skipped;
+    uint64_t mismatched;
+};
+
+static void check(int32_t inLow, int32_t inHigh, int32_t outLow, int32_t outHigh, int32_t deadband, Totals *totals) {
+    if (inHigh - inLow - 2 * deadband <= 0) {
+        return;
+    }
+    const RangeMap rangeMap(inLow, inHigh, outLow, outHigh, deadband);
+    if (!rangeMap.valid()) {
+        fprintf(stderr, "error: range [%d, %d] -> [%d, %d] deadband %d rejected\n", inLow, inHigh, outLow, outHigh,
+                deadband);
+        exit(EXIT_FAILURE);
+    }
+    totals->configs++;
+
+    const int64_t inCenter = (int64_t(inLow) + inHigh) / 2;
+    for (int32_t in = 0; in < NUM_INPUTS; in++) {
+        // the reference multiplies the centered input by the output range
+        if (llabs(in - inCenter) * (int64_t(outHigh) - outLow) > INT32_MAX) {
+            totals->skipped++;
+            continue;
+        }
+        totals->compared++;
+        const int32_t expected = HFCS::mapRanges(inLow, inHigh, in, outLow, outHigh, deadband);
+        const int32_t actual = rangeMap.map(in);
+        if (actual != expected) {
+            if (totals->mismatched < MAX_REPORTED) {
+                printf("mismatch: [%d, %d] -> [%d, %d] deadband %d: %d maps to %d, expected %d\n", inLow, inHigh,
+                        outLow, outHigh, deadband, in, actual, expected);
+            }
+            totals->mismatched++;
+        }
+    }
+}
+
+static void print(const char *sweep, const Totals &totals) {
+    printf("%-10s %8llu ranges %12llu inputs compared %10llu skipped %llu mismatched\n", sweep,
+            (unsigned long long) totals.configs, (unsigned long long) totals.compared,
+            (unsigned long long) totals.skipped, (unsigned long long) totals.mismatched);
+}
+
+int main() {
+    const Config &defaults = Params::defaults;
+    uint64_t mismatched = 0;
+
+    // every deadband the parameters allow
+    Totals deadband = { };
+    for (int32_t db = 0; db <= 200; db++) {
+        for (size_t o = 0; o < NUM_OUTPUTS; o++) {
+            check(defaults.inputLow, defaults.inputHigh, OUTPUTS[o].low, OUTPUTS[o].high, db, &deadband);
+        }
+    }
+    print("deadband", deadband);
+    mismatched += deadband.mismatched;
+
+    // every yaw rate the parameters allow, scaled as in the loop
+    Totals rate = { };
+    for (int32_t yawRate = 0; yawRate <= 2000; yawRate++) {
+        const int32_t rateRange = yawRate * 32767 / 2000;
+        for (size_t d = 0; d < NUM_DEADBANDS; d++) {
+            check(defaults.inputLow, defaults.inputHigh, -rateRange, rateRange, DEADBANDS[d], &rate);
+        }
+    }
+    print("yaw_rate", rate);
+    mismatched += rate.mismatched;
+
+    // input ranges across the widths the decoder accepts
+    Totals input = { };
+    for (int32_t low = PpmDecoder::MIN_WIDTH; low <= int32_t(PpmDecoder::MAX_WIDTH); low += 50) {
+        for (int32_t high = low; high <= int32_t(PpmDecoder::MAX_WIDTH); high += 50) {
+            for (size_t d = 0; d < NUM_DEADBANDS; d++) {
+                for (size_t o = 0; o < NUM_OUTPUTS; o++) {
+                    check(low, high, OUTPUTS[o].low, OUTPUTS[o].high, DEADBANDS[d], &input);
+                }
+            }
+        }
+    }
+    print("input", input);
+    mismatched += input.mismatched;
+
+    return mismatched == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,238 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Replays blackbox dumps or CSV captures through the control step and checks
+ * the outputs, either against those recorded in the logs or against a golden
+ * CSV written by an earlier run with -o. Several logs are replayed one after
+ * another, each from a fresh boot, and their outputs are concatenated.
+ *
+ * Exits with failure if any output differs by more than the tolerance, so it
+ * can gate changes to the control path.
+ */
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-c params.txt] [-p kp] [-i ki] [-d kd] [-y yaw_rate]\n"
+            "          [-g golden.csv] [-o out.csv] [-t tolerance] log...\n"
+            "params.txt holds \"param list\" output; logs are \"bb dump\" output or CSV\n", name);
+    exit(EXIT_FAILURE);
+}
+
+static bool setParam(Config *config, const char *name, float value) {
+    for (size_t i = 0; i < Params::NUM_PARAMS; i++) {
+        const Params::Param &param = Params::table[i];
+        if (strcmp(param.name, name) != 0) {
+            continue;
+        }
+        uint8_t * const field = reinterpret_cast<uint8_t *>(config) + param.offset;
+        if (param.type == Params::TYPE_FLOAT) {
+            *reinterpret_cast<float *>(field) = value;
+        } else {
+            *reinterpret_cast<int32_t *>(field) = int32_t(value);
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Reads "name = value" lines as printed by the param shell command.
+ */
+static bool readParams(const char *path, Config *config) {
+    FILE * const file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    char line[128];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        char name[64];
+        float value;
+        if (sscanf(line, " %63s = %f", name, &value) == 2) {
+            ok = setParam(config, name, value);
+            if (!ok) {
+                fprintf(stderr, "%s: unknown parameter %s\n", path, name);
+            }
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+struct FieldDiff {
+    size_t mismatches;
+    int32_t maxDiff;
+    size_t first;
+};
+
+int main(int argc, char *argv[]) {
+    Config config = Params::defaults;
+    const char *goldenPath = NULL;
+    FILE *out = NULL;
+    int32_t tolerance = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:p:i:d:y:g:o:t:")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (!readParams(optarg, &config)) {
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'p':
+            config.kp = strtof(optarg, NULL);
+            break;
+        case 'i':
+            config.ki = strtof(optarg, NULL);
+            break;
+        case 'd':
+            config.kd = strtof(optarg, NULL);
+            break;
+        case 'y':
+            config.yawRate = strtol(optarg, NULL, 0);
+            break;
+        case 'g':
+            goldenPath = optarg;
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (out == NULL) {
+                perror(optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 't':
+            tolerance = strtol(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+    }
+    if (!Params::validate(config)) {
+        fprintf(stderr, "invalid parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Replay::Sample> golden;
+    if (goldenPath != NULL) {
+        FILE * const file = fopen(goldenPath, "r");
+        if (file == NULL || !Replay::readCsv(file, &golden)) {
+            fprintf(stderr, "%s: cannot read golden outputs\n", goldenPath);
+            return EXIT_FAILURE;
+        }
+        fclose(file);
+    }
+    if (out != NULL) {
+        Replay::writeCsvHeader(out);
+    }
+
+    FieldDiff diffs[Replay::NUM_OUTPUTS] = { };
+    size_t total = 0;
+    double recorded = 0;
+    const clock_t start = clock();
+
+    for (int arg = optind; arg < argc; arg++) {
+        std::vector<Replay::Sample> samples;
+        FILE * const file = fopen(argv[arg], "rb");
+        if (file == NULL || !Replay::read(file, &samples)) {
+            fprintf(stderr, "%s: cannot read log\n", argv[arg]);
+            return EXIT_FAILURE;
+        }
+        fclose(file);
+        if (samples.empty()) {
+            continue;
+        }
+        recorded += double(uint32_t(samples.back().field[Blackbox::TIME] - samples.front().field[Blackbox::TIME]))
+                / hw::TICK_HZ;
+
+        Replay * const replay = new Replay(config);
+        replay->init(samples.front());
+        for (size_t i = 0; i < samples.size(); i++, total++) {
+            const Replay::Sample result = replay->step(samples[i]);
+            if (out != NULL) {
+                Replay::writeCsv(out, result);
+            }
+
+            const Replay::Sample *expected = &samples[i];
+            if (goldenPath != NULL) {
+                expected = total < golden.size() ? &golden[total] : NULL;
+            }
+            if (expected == NULL) {
+                continue;
+            }
+            for (size_t f = 0; f < Replay::NUM_OUTPUTS; f++) {
+                const Blackbox::Field field = Replay::OUTPUTS[f];
+                const int32_t diff = labs(long(result.field[field]) - expected->field[field]);
+                if (diff > tolerance) {
+                    if (diffs[f].mismatches == 0) {
+                        diffs[f].first = total;
+                    }
+                    diffs[f].mismatches++;
+                }
+                if (diff > diffs[f].maxDiff) {
+                    diffs[f].maxDiff = diff;
+                }
+            }
+        }
+        delete replay;
+    }
+    const float wall = float(clock() - start) / CLOCKS_PER_SEC;
+
+    bool match = goldenPath == NULL || golden.size() == total;
+    if (!match) {
+        printf("golden has %zu samples, replayed %zu\n", golden.size(), total);
+    }
+    printf("%-14s %10s %10s %10s\n", "field", "mismatches", "max diff", "first");
+    for (size_t f = 0; f < Replay::NUM_OUTPUTS; f++) {
+        printf("%-14s %10zu %10d", Replay::FIELD_NAMES[Replay::OUTPUTS[f]], diffs[f].mismatches,
+                int(diffs[f].maxDiff));
+        if (diffs[f].mismatches > 0) {
+            printf(" %10zu", diffs[f].first);
+            match = false;
+        }
+        printf("\n");
+    }
+    printf("%zu samples (%.0f s recorded) replayed in %.2f s, %s %s\n", total, recorded, wall,
+            match ? "matching" : "differing from", goldenPath != NULL ? goldenPath : "the recording");
+
+    if (out != NULL) {
+        fclose(out);
+    }
+    return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
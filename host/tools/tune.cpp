@@ -0,0 +1,504 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Harness.h"
+#include "Experiments.h"
+#include "Cmaes.h"
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Searches for yaw loop gains against the robot model. Each candidate is
+ * scored by a closed-loop episode: steps both ways, a hit, and a weapon
+ * spin-up, all with the same model seed so candidates see the same noise.
+ * A coarse grid over the gain box seeds a CMA-ES refinement.
+ *
+ * The harness runs on the process-wide virtual clock and mocks, so episodes
+ * run in parallel in forked workers rather than threads. Each batch of
+ * candidates is split across one worker per core, and scores come back over
+ * pipes.
+ */
+
+// the first entries of Params::table
+static constexpr size_t NUM_GAINS = 3;
+static constexpr uint32_t STEP_MS = 1000;
+static constexpr uint32_t SPIN_UP_MS = 3000;
+static constexpr float HIT_TORQUE = 0.5f;
+static constexpr uint32_t HIT_MS = 20;
+static constexpr uint32_t HIT_RECOVERY_MS = 1000;
+// cost per unit of squared distance outside the gain box
+static constexpr double BOUND_PENALTY = 10;
+
+struct Weights {
+    double settle;      // per step length of settle time
+    double overshoot;   // per 100% overshoot
+    double error;       // per unit of rms error relative to the target
+    double effort;      // per unit of mean duty cycle
+    double hold;        // per 360 deg of heading lost to disturbances
+};
+
+struct Score {
+    uint32_t index;
+    float gains[NUM_GAINS];
+    double cost;
+    Experiments::StepResponse right;
+    Experiments::StepResponse left;
+    Experiments::Disturbance hit;
+    Experiments::Disturbance spinUp;
+    double simulated;
+};
+
+static double wallTime() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static double stepCost(const Experiments::StepResponse &r, const Weights &weights) {
+    return weights.settle * r.settleTime / STEP_MS
+            + weights.overshoot * r.overshoot / 100
+            + weights.error * r.rmsError / fabs(r.target)
+            + weights.effort * r.effort;
+}
+
+/**
+ * Runs one episode with the given gains.
+ */
+static Score evaluate(uint32_t index, const float *gains, const Config &base, uint32_t seed,
+        const Weights &weights) {
+    Score score = { };
+    score.index = index;
+    memcpy(score.gains, gains, sizeof(score.gains));
+
+    Config config = base;
+    config.kp = gains[0];
+    config.ki = gains[1];
+    config.kd = gains[2];
+
+    const hw::Time start = hw::now();
+    Harness * const harness = new Harness(config, RobotModel::defaults, seed);
+    harness->init();
+    harness->setReceiver(true);
+    harness->run(500);
+    score.right = Experiments::yawStep(*harness, true, STEP_MS);
+    score.left = Experiments::yawStep(*harness, false, STEP_MS);
+    score.hit = Experiments::hit(*harness, HIT_TORQUE, HIT_MS, HIT_RECOVERY_MS);
+    score.spinUp = Experiments::weaponSpinUp(*harness, SPIN_UP_MS);
+    delete harness;
+    score.simulated = double(hw::now() - start) / hw::TICK_HZ;
+
+    score.cost = (stepCost(score.right, weights) + stepCost(score.left, weights)) / 2
+            + weights.hold * (fabs(score.hit.heading) + fabs(score.spinUp.heading)) / 360;
+    return score;
+}
+
+class Evaluator {
+public:
+    Evaluator(const Config &base, uint32_t seed, const Weights &weights, size_t workers, FILE *csv) :
+            base(base),
+            seed(seed),
+            weights(weights),
+            workers(workers),
+            csv(csv),
+            episodes(0),
+            simulated(0),
+            wall(0) {
+        if (csv != NULL) {
+            fprintf(csv, "kp,ki,kd,cost,settle,overshoot,rms_error,effort,hit_heading,spin_up_heading\n");
+        }
+    }
+
+    bool run(const float (*gains)[NUM_GAINS], Score *scores, size_t count);
+
+    size_t getEpisodes() const {
+        return episodes;
+    }
+
+    double getSimulated() const {
+        return simulated;
+    }
+
+    double getWall() const {
+        return wall;
+    }
+
+protected:
+    static constexpr size_t MAX_WORKERS = 256;
+
+    const Config base;
+    const uint32_t seed;
+    const Weights weights;
+    const size_t workers;
+    FILE * const csv;
+    size_t episodes;
+    double simulated;
+    double wall;
+
+    void log(const Score &score);
+};
+
+/**
+ * Scores a batch of candidates, worker w taking candidates w, w + workers,
+ * and so on.
+ *
+ * @return false if a worker failed
+ */
+bool Evaluator::run(const float (*gains)[NUM_GAINS], Score *scores, size_t count) {
+    const double start = wallTime();
+    const size_t n = count < workers ? count : workers;
+    int fds[MAX_WORKERS];
+    pid_t pids[MAX_WORKERS];
+
+    fflush(NULL);
+    for (size_t w = 0; w < n; w++) {
+        int pipeFds[2];
+        if (pipe(pipeFds) != 0) {
+            perror("pipe");
+            return false;
+        }
+        pids[w] = fork();
+        if (pids[w] < 0) {
+            perror("fork");
+            return false;
+        }
+        if (pids[w] == 0) {
+            close(pipeFds[0]);
+            for (size_t i = w; i < count; i += n) {
+                const Score score = evaluate(i, gains[i], base, seed, weights);
+                if (write(pipeFds[1], &score, sizeof(score)) != sizeof(score)) {
+                    _exit(EXIT_FAILURE);
+                }
+            }
+            _exit(EXIT_SUCCESS);
+        }
+        close(pipeFds[1]);
+        fds[w] = pipeFds[0];
+    }
+
+    // take scores from whichever workers have them, so that none blocks on a
+    // full pipe; scores are smaller than PIPE_BUF, so each arrives whole
+    pollfd polls[MAX_WORKERS];
+    for (size_t w = 0; w < n; w++) {
+        polls[w].fd = fds[w];
+        polls[w].events = POLLIN;
+    }
+    size_t received = 0;
+    size_t open = n;
+    while (open > 0) {
+        if (poll(polls, n, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+        for (size_t w = 0; w < n; w++) {
+            if (polls[w].fd < 0 || polls[w].revents == 0) {
+                continue;
+            }
+            Score score;
+            if (read(polls[w].fd, &score, sizeof(score)) == sizeof(score)) {
+                if (score.index < count) {
+                    scores[score.index] = score;
+                    received++;
+                }
+            } else {
+                // end of file once the worker is done
+                close(polls[w].fd);
+                polls[w].fd = -1;
+                open--;
+            }
+        }
+    }
+    for (size_t w = 0; w < n; w++) {
+        if (polls[w].fd >= 0) {
+            close(polls[w].fd);
+        }
+    }
+    bool ok = received == count;
+    for (size_t w = 0; w < n; w++) {
+        int status;
+        ok = waitpid(pids[w], &status, 0) == pids[w] && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+    }
+
+    for (size_t i = 0; i < count && ok; i++) {
+        log(scores[i]);
+    }
+    wall += wallTime() - start;
+    return ok;
+}
+
+void Evaluator::log(const Score &score) {
+    episodes++;
+    simulated += score.simulated;
+    if (csv == NULL) {
+        return;
+    }
+    fprintf(csv, "%g,%g,%g,%.4f,%.1f,%.1f,%.2f,%.3f,%.1f,%.1f\n", score.gains[0], score.gains[1],
+            score.gains[2], score.cost, (score.right.settleTime + score.left.settleTime) / 2,
+            (score.right.overshoot + score.left.overshoot) / 2,
+            (score.right.rmsError + score.left.rmsError) / 2, (score.right.effort + score.left.effort) / 2,
+            score.hit.heading, score.spinUp.heading);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-j workers] [-g grid] [-G generations] [-l lambda] [-s seed]\n"
+            "          [-P kp_max] [-I ki_max] [-D kd_max] [-w name=weight,...] [-c episodes.csv]\n"
+            "weights: settle, overshoot, error, effort, hold\n", name);
+    exit(EXIT_FAILURE);
+}
+
+static bool parseWeights(char *spec, Weights *weights) {
+    for (char *item = strtok(spec, ","); item != NULL; item = strtok(NULL, ",")) {
+        char * const equals = strchr(item, '=');
+        if (equals == NULL) {
+            return false;
+        }
+        *equals = '\0';
+        char *end;
+        const double value = strtod(equals + 1, &end);
+        if (*end != '\0' || !(value >= 0)) {
+            return false;
+        }
+        if (strcmp(item, "settle") == 0) {
+            weights->settle = value;
+        } else if (strcmp(item, "overshoot") == 0) {
+            weights->overshoot = value;
+        } else if (strcmp(item, "error") == 0) {
+            weights->error = value;
+        } else if (strcmp(item, "effort") == 0) {
+            weights->effort = value;
+        } else if (strcmp(item, "hold") == 0) {
+            weights->hold = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void printScore(const Score &s) {
+    printf("%8.4f  %7.4f %7.3f %8.5f  %6.1f %6.1f %6.1f %6.3f %7.1f %7.1f\n", s.cost, s.gains[0], s.gains[1],
+            s.gains[2], (s.right.settleTime + s.left.settleTime) / 2, (s.right.overshoot + s.left.overshoot) / 2,
+            (s.right.rmsError + s.left.rmsError) / 2, (s.right.effort + s.left.effort) / 2, s.hit.heading,
+            s.spinUp.heading);
+}
+
+static void printHeader() {
+    printf("    cost       kp      ki       kd  settle  over    rms effort     hit spin-up\n");
+    printf("                                    (ms)    (%%)  (dps)          (deg)   (deg)\n");
+}
+
+int main(int argc, char *argv[]) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = cores > 0 ? cores : 1;
+    size_t grid = 5;
+    size_t generations = 30;
+    size_t lambda = 0;
+    uint32_t seed = 1;
+    float maxGains[NUM_GAINS] = { 2.f, 10.f, 0.01f };
+    Weights weights = { 1, 1, 1, 0.2, 0.5 };
+    FILE *csv = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:g:G:l:s:P:I:D:w:c:")) != -1) {
+        switch (opt) {
+        case 'j':
+            workers = strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            grid = strtoul(optarg, NULL, 0);
+            break;
+        case 'G':
+            generations = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            lambda = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'P':
+            maxGains[0] = strtof(optarg, NULL);
+            break;
+        case 'I':
+            maxGains[1] = strtof(optarg, NULL);
+            break;
+        case 'D':
+            maxGains[2] = strtof(optarg, NULL);
+            break;
+        case 'w':
+            if (!parseWeights(optarg, &weights)) {
+                usage(argv[0]);
+            }
+            break;
+        case 'c':
+            csv = fopen(optarg, "w");
+            if (csv == NULL) {
+                perror(optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (lambda == 0) {
+        // keep every worker busy, as a generation is a batch
+        lambda = Cmaes::defaultLambda(NUM_GAINS);
+        lambda = workers > lambda ? workers : lambda;
+    }
+    if (workers < 1 || workers > 256 || grid < 2 || lambda < 2 || lambda > Cmaes::MAX_LAMBDA) {
+        usage(argv[0]);
+    }
+    for (size_t i = 0; i < NUM_GAINS; i++) {
+        const Params::Param &param = Params::table[i];
+        if (!(maxGains[i] > 0 && maxGains[i] <= param.max)) {
+            fprintf(stderr, "%s_max must be in (0, %g]\n", param.name, param.max);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%zu workers, %zu^%zu grid, %zu generations of %zu\n", workers, grid, NUM_GAINS, generations, lambda);
+    printf("gain box kp <= %g, ki <= %g, kd <= %g\n", maxGains[0], maxGains[1], maxGains[2]);
+    printf("weights settle %g, overshoot %g, error %g, effort %g, hold %g\n\n", weights.settle,
+            weights.overshoot, weights.error, weights.effort, weights.hold);
+
+    Evaluator evaluator(Params::defaults, seed, weights, workers, csv);
+
+    // grid over the box, gains at the centers of grid cells
+    size_t count = 1;
+    for (size_t i = 0; i < NUM_GAINS; i++) {
+        count *= grid;
+    }
+    float (*gridGains)[NUM_GAINS] = new float[count][NUM_GAINS];
+    Score *gridScores = new Score[count];
+    for (size_t k = 0; k < count; k++) {
+        size_t rest = k;
+        for (size_t i = 0; i < NUM_GAINS; i++) {
+            gridGains[k][i] = maxGains[i] * ((rest % grid) + 0.5f) / grid;
+            rest /= grid;
+        }
+    }
+    if (!evaluator.run(gridGains, gridScores, count)) {
+        fprintf(stderr, "worker failed\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<size_t> order(count);
+    for (size_t k = 0; k < count; k++) {
+        size_t j = k;
+        while (j > 0 && gridScores[order[j - 1]].cost > gridScores[k].cost) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = k;
+    }
+    printf("grid, best %zu of %zu\n", count < 5 ? count : 5, count);
+    printHeader();
+    for (size_t k = 0; k < count && k < 5; k++) {
+        printScore(gridScores[order[k]]);
+    }
+    Score best = gridScores[order[0]];
+
+    // refine in coordinates normalized to the box
+    double mean[NUM_GAINS];
+    for (size_t i = 0; i < NUM_GAINS; i++) {
+        mean[i] = best.gains[i] / maxGains[i];
+    }
+    Cmaes cmaes(NUM_GAINS, mean, 1.0 / grid, lambda, seed);
+    float candidates[Cmaes::MAX_LAMBDA][NUM_GAINS];
+    double penalties[Cmaes::MAX_LAMBDA];
+    double costs[Cmaes::MAX_LAMBDA];
+    Score scores[Cmaes::MAX_LAMBDA];
+
+    printf("\nCMA-ES\n");
+    printf("gen  best cost    sigma       kp      ki       kd\n");
+    for (size_t g = 0; g < generations; g++) {
+        for (size_t k = 0; k < lambda; k++) {
+            double x[NUM_GAINS];
+            cmaes.ask(k, x);
+            penalties[k] = 0;
+            for (size_t i = 0; i < NUM_GAINS; i++) {
+                const double clamped = x[i] < 0 ? 0 : x[i] > 1 ? 1 : x[i];
+                penalties[k] += BOUND_PENALTY * (x[i] - clamped) * (x[i] - clamped);
+                candidates[k][i] = clamped * maxGains[i];
+            }
+        }
+        if (!evaluator.run(candidates, scores, lambda)) {
+            fprintf(stderr, "worker failed\n");
+            return EXIT_FAILURE;
+        }
+        for (size_t k = 0; k < lambda; k++) {
+            costs[k] = scores[k].cost + penalties[k];
+            if (scores[k].cost < best.cost) {
+                best = scores[k];
+            }
+        }
+        cmaes.tell(costs);
+        // the mean may wander out of the box; show the gains it stands for
+        const double * const m = cmaes.getMean();
+        double meanGains[NUM_GAINS];
+        for (size_t i = 0; i < NUM_GAINS; i++) {
+            meanGains[i] = (m[i] < 0 ? 0 : m[i] > 1 ? 1 : m[i]) * maxGains[i];
+        }
+        printf("%3zu %10.4f %8.4f  %7.4f %7.3f %8.5f\n", cmaes.getGeneration(), best.cost, cmaes.getSigma(),
+                meanGains[0], meanGains[1], meanGains[2]);
+    }
+
+    printf("\nbest\n");
+    printHeader();
+    printScore(best);
+    printf("right step to %.0f deg/s: settle %.1f ms, overshoot %.1f %%, steady error %.2f %%\n",
+            best.right.target, best.right.settleTime, best.right.overshoot, best.right.steadyError);
+    printf("left step to %.0f deg/s: settle %.1f ms, overshoot %.1f %%, steady error %.2f %%\n",
+            best.left.target, best.left.settleTime, best.left.overshoot, best.left.steadyError);
+    printf("hit recovery %.1f ms, spin-up peak rate %.1f deg/s\n", best.hit.recoveryTime, best.spinUp.peakRate);
+    for (size_t i = 0; i < NUM_GAINS; i++) {
+        printf("param set %s %.6f\n", Params::table[i].name, best.gains[i]);
+    }
+
+    const double wall = evaluator.getWall();
+    printf("\n%zu episodes, %.0f s simulated in %.2f s: %.1f episodes/s, %.1f per worker, %.0fx real time\n",
+            evaluator.getEpisodes(), evaluator.getSimulated(), wall, evaluator.getEpisodes() / wall,
+            evaluator.getEpisodes() / wall / workers, evaluator.getSimulated() / wall);
+
+    delete[] gridScores;
+    delete[] gridGains;
+    if (csv != NULL) {
+        fclose(csv);
+    }
+    return EXIT_SUCCESS;
+}
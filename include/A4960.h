@@ -26,12 +26,11 @@
 #ifndef A4960_H_
 #define A4960_H_
 
-#include "ch.h"
-#include "hal.h"
+#include "Hw.h"
 
 class A4960 {
 public:
-    A4960(SPIDriver *spip, PWMDriver *pwmp, pwmchannel_t channel);
+    A4960(hw::Spi *spip, hw::Pwm *pwmp, hw::PwmChannel channel);
 
     void setMode(bool enable, bool reverse = false) {
         uint16_t cfg = config[0x7];
@@ -40,21 +39,21 @@ public:
         writeReg(0x7, cfg);
     }
 
-    pwmcnt_t getRange() const {
-        return pwmp->period;
+    hw::PwmCount getRange() const {
+        return hw::pwmPeriod(pwmp);
     }
 
-    void setWidth(pwmcnt_t width) {
-        pwmEnableChannel(pwmp, channel, width);
+    void setWidth(hw::PwmCount width) {
+        hw::pwmSet(pwmp, channel, width);
     }
 
     uint16_t writeReg(const uint8_t addr, const uint16_t data);
     uint16_t readReg(const uint8_t addr);
 
 protected:
-    SPIDriver * const spip;
-    PWMDriver * const pwmp;
-    const pwmchannel_t channel;
+    hw::Spi * const spip;
+    hw::Pwm * const pwmp;
+    const hw::PwmChannel channel;
 
     static const uint16_t config[8];
 };
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef AUTOTUNE_H_
+#define AUTOTUNE_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Relay-feedback tuning of the yaw rate loop (Astrom and Hagglund). In place
+ * of the PID, a relay drives full turn one way whenever the rate is past the
+ * hysteresis the other way, which makes the loop oscillate at its ultimate
+ * period. The ultimate gain follows from the relay and rate amplitudes:
+ *
+ *   Ku = 4 d / (pi sqrt(a^2 - h^2))
+ *
+ * for relay amplitude d, rate amplitude a, and hysteresis h. The PID gains
+ * follow from Ku and Tu by the classic Ziegler-Nichols rules.
+ *
+ * The first cycles are skipped while the oscillation settles. Periods are
+ * whole control steps, only a few per cycle, and the sampled relay tends to
+ * settle into a pattern of unequal cycles, so cycles are averaged over windows
+ * of MEASURE_CYCLES. The oscillation counts as steady once two windows in a
+ * row agree within TOLERANCE in both period and amplitude.
+ *
+ * Runs in the control thread; the shell only requests a run and reads the
+ * result.
+ */
+class Autotune {
+public:
+    enum State {
+        IDLE,
+        RUNNING,
+        DONE,
+        FAILED,
+    };
+
+    struct Result {
+        float ultimateGain;     // drive output per gyro unit
+        float ultimatePeriod;   // s
+        float amplitude;        // gyro units
+        float kp;
+        float ki;
+        float kd;
+        float scale;            // gain schedule scale the gains were found at
+    };
+
+    static constexpr size_t SKIP_CYCLES = 2;
+    static constexpr size_t MEASURE_CYCLES = 8;
+    static constexpr float TOLERANCE = 0.1f;
+
+    Autotune();
+
+    void request() {
+        requested = true;
+    }
+
+    bool takeRequest();
+
+    void start(int32_t relay, int32_t hysteresis, size_t maxSteps, float dt, float scale);
+    void stop();
+    int32_t step(float rate);
+
+    State getState() const {
+        return state;
+    }
+
+    bool isRunning() const {
+        return state == RUNNING;
+    }
+
+    const Result &getResult() const {
+        return result;
+    }
+
+    static Autotune *instance;
+    static void shellCommand(BaseChannel *chp, int argc, char *argv[]);
+
+protected:
+    volatile bool requested;
+    volatile State state;
+    Result result;
+
+    // experiment settings
+    int32_t relay;
+    int32_t hysteresis;
+    size_t maxSteps;
+    float dt;
+    float scale;
+
+    // experiment progress
+    int32_t output;
+    size_t steps;
+    size_t lastRise;
+    size_t cycles;
+    float high;
+    float low;
+    size_t measured;
+    float periodSum;
+    float amplitudeSum;
+    // means of the last complete window, zero if none
+    float lastPeriod;
+    float lastAmplitude;
+
+    void cycle(size_t period, float amplitude);
+    void finish(float period, float amplitude);
+};
+
+#endif /* AUTOTUNE_H_ */
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Microbenchmarks of the control path's primitives, timed with the backend's
+ * cycle counter: core cycles on the robot, nanoseconds on a host. Each case
+ * calls its function a number of times per run, over several runs, and the
+ * per-call time is reported as min, median, mean, and standard deviation.
+ * Interrupts and higher-priority threads land in some runs on the robot, so
+ * min and median are the figures to compare.
+ *
+ * Cases come in pairs where there is an alternative worth weighing, such as
+ * float against fixed point or branches against bit tricks. A "loop" case
+ * measures the cost of the harness itself.
+ *
+ * Results print as CSV lines starting with "bench", so that they can be
+ * picked out of a console capture and tracked over time.
+ */
+class Bench {
+public:
+    // calls the function under test, returning a checksum of its results
+    typedef int32_t (*Function)(uint32_t calls);
+
+    struct Case {
+        const char *name;
+        Function run;
+    };
+
+    struct Result {
+        const char *name;
+        uint32_t calls;
+        uint32_t runs;
+        // per call, in hw::CYCLE_UNIT
+        float min;
+        float median;
+        float mean;
+        float stddev;
+    };
+
+    static constexpr uint32_t DEFAULT_CALLS = 1000;
+    static constexpr size_t DEFAULT_RUNS = 15;
+    static constexpr size_t MAX_RUNS = 64;
+
+    static const Case cases[];
+    static const size_t NUM_CASES;
+
+    static const Case *find(const char *name);
+    static Result measure(const Case &benchCase, uint32_t calls, size_t runs);
+    static void printHeader(BaseChannel *chp);
+    static void print(BaseChannel *chp, const Result &result);
+
+    static void shellCommand(BaseChannel *chp, int argc, char *argv[]);
+};
+
+#endif /* BENCH_H_ */
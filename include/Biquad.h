@@ -0,0 +1,211 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef BIQUAD_H_
+#define BIQUAD_H_
+
+#include "Dsp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Second-order IIR section coefficients, normalized so that a0 is one:
+ *
+ *   y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+ *
+ * Designs follow the bilinear-transform "cookbook" formulas. A frequency of
+ * zero, or one at or above Nyquist, gives a pass-through section, so a
+ * frequency parameter of zero turns a stage off; for the derivative, it gives
+ * a plain first difference.
+ */
+struct Biquad {
+    static constexpr float BUTTERWORTH_Q = 0.7071068f;
+
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+
+    bool isPassThrough() const {
+        return b0 == 1.f && b1 == 0.f && b2 == 0.f && a1 == 0.f && a2 == 0.f;
+    }
+
+    static Biquad passThrough();
+    static Biquad lowPass(float cutoffHz, float sampleHz, float q = BUTTERWORTH_Q);
+    static Biquad notch(float centerHz, float sampleHz, float q);
+    static Biquad derivativeLowPass(float cutoffHz, float sampleHz, float q = BUTTERWORTH_Q);
+};
+
+/**
+ * Cascade of biquad stages run over several axes at once, in float. Uses
+ * transposed direct form II, which needs two state variables per stage.
+ */
+template<size_t AXES, size_t STAGES>
+class BiquadBank {
+public:
+    BiquadBank() :
+            stages { },
+            bypass { },
+            state { } {
+        for (size_t s = 0; s < STAGES; s++) {
+            setStage(s, Biquad::passThrough());
+        }
+    }
+
+    void setStage(size_t stage, const Biquad &coeffs) {
+        stages[stage] = coeffs;
+        bypass[stage] = coeffs.isPassThrough();
+    }
+
+    void reset() {
+        for (size_t s = 0; s < STAGES; s++) {
+            for (size_t a = 0; a < AXES; a++) {
+                state[s][a][0] = 0.f;
+                state[s][a][1] = 0.f;
+            }
+        }
+    }
+
+    /**
+     * @param in one sample per axis
+     * @param out one filtered sample per axis; may be the same as in
+     */
+    void process(const float *in, float *out) {
+        for (size_t a = 0; a < AXES; a++) {
+            out[a] = in[a];
+        }
+        for (size_t s = 0; s < STAGES; s++) {
+            if (bypass[s]) {
+                continue;
+            }
+            const Biquad &c = stages[s];
+            for (size_t a = 0; a < AXES; a++) {
+                float * const z = state[s][a];
+                const float x = out[a];
+                const float y = c.b0 * x + z[0];
+                z[0] = c.b1 * x - c.a1 * y + z[1];
+                z[1] = c.b2 * x - c.a2 * y;
+                out[a] = y;
+            }
+        }
+    }
+
+protected:
+    Biquad stages[STAGES];
+    bool bypass[STAGES];
+    float state[STAGES][AXES][2];
+};
+
+/**
+ * Cascade of biquad stages run over several axes at once, on integer samples
+ * with Q7.24 coefficients. Uses direct form I with a 64-bit accumulator, so
+ * state holds only past inputs and outputs, and coefficients can be changed
+ * while running without a jump. Outputs saturate to 32 bits.
+ */
+template<size_t AXES, size_t STAGES>
+class FixedBiquadBank {
+public:
+    static constexpr uint32_t COEFF_BITS = 24;
+    // coefficients must be within this magnitude
+    static constexpr float MAX_COEFF = float(1 << (31 - COEFF_BITS));
+
+    FixedBiquadBank() :
+            stages { },
+            bypass { },
+            state { } {
+        for (size_t s = 0; s < STAGES; s++) {
+            setStage(s, Biquad::passThrough());
+        }
+    }
+
+    /**
+     * @return false if a coefficient is too large, in which case the stage is
+     *      set to pass through
+     */
+    bool setStage(size_t stage, const Biquad &coeffs) {
+        const float values[5] = { coeffs.b0, coeffs.b1, coeffs.b2, coeffs.a1, coeffs.a2 };
+        for (size_t i = 0; i < 5; i++) {
+            if (!(values[i] > -MAX_COEFF && values[i] < MAX_COEFF)) {
+                bypass[stage] = true;
+                return false;
+            }
+        }
+        for (size_t i = 0; i < 5; i++) {
+            const float scaled = values[i] * (1 << COEFF_BITS);
+            stages[stage][i] = int32_t(scaled + (scaled < 0 ? -0.5f : 0.5f));
+        }
+        bypass[stage] = coeffs.isPassThrough();
+        return true;
+    }
+
+    void reset() {
+        for (size_t s = 0; s < STAGES; s++) {
+            for (size_t a = 0; a < AXES; a++) {
+                for (size_t i = 0; i < 4; i++) {
+                    state[s][a][i] = 0;
+                }
+            }
+        }
+    }
+
+    /**
+     * @param in one sample per axis
+     * @param out one filtered sample per axis; may be the same as in
+     */
+    void process(const int32_t *in, int32_t *out) {
+        for (size_t a = 0; a < AXES; a++) {
+            out[a] = in[a];
+        }
+        for (size_t s = 0; s < STAGES; s++) {
+            if (bypass[s]) {
+                continue;
+            }
+            const int32_t * const c = stages[s];
+            for (size_t a = 0; a < AXES; a++) {
+                // x[n-1], x[n-2], y[n-1], y[n-2]
+                int32_t * const z = state[s][a];
+                const int32_t x = out[a];
+                const int64_t acc = int64_t(c[0]) * x + int64_t(c[1]) * z[0] + int64_t(c[2]) * z[1]
+                        - int64_t(c[3]) * z[2] - int64_t(c[4]) * z[3] + (int64_t(1) << (COEFF_BITS - 1));
+                const int32_t y = dsp::saturate32(acc >> COEFF_BITS);
+                z[1] = z[0];
+                z[0] = x;
+                z[3] = z[2];
+                z[2] = y;
+                out[a] = y;
+            }
+        }
+    }
+
+protected:
+    int32_t stages[STAGES][5];
+    bool bypass[STAGES];
+    int32_t state[STAGES][AXES][4];
+};
+
+#endif /* BIQUAD_H_ */
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#ifndef BLACKBOX_H_
+#define BLACKBOX_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Flight recorder for the control loop. Samples are delta-encoded into
+ * fixed-size blocks of a ring buffer; each block starts from an all-zero
+ * reference so that it decodes on its own after the ring wraps around.
+ *
+ * Each record is a varint bitmask of the fields that changed since the
+ * previous sample, followed by a zigzag varint delta for each changed field.
+ */
+class Blackbox {
+public:
+    enum Field {
+        TIME,
+        CHANNEL_0,
+        CHANNEL_1,
+        CHANNEL_2,
+        CHANNEL_3,
+        CHANNEL_4,
+        RATE_X,
+        RATE_Y,
+        RATE_Z,
+        SET_POINT,
+        PID_INTEGRAL,
+        PID_OUTPUT,
+        LEFT,
+        RIGHT,
+        THROTTLE,
+        FLAGS,
+        PERIOD, // measured time since the previous step, in us
+        NUM_FIELDS
+    };
+
+    enum Flag {
+        FLAG_CHANNELS_VALID = 1 << 0,
+        FLAG_GYRO_ENABLE = 1 << 1,
+        FLAG_GYRO_ERROR = 1 << 2,
+        FLAG_M1_FAULT = 1 << 3,
+        FLAG_RATE_SATURATED = 1 << 4,
+        FLAG_RATE_FAULT = 1 << 5,
+        FLAG_HEADING_HOLD = 1 << 6,
+        FLAG_AUTOTUNE = 1 << 7,
+    };
+
+    enum Trigger {
+        TRIGGER_NONE,
+        TRIGGER_FAILSAFE,
+        TRIGGER_M1_FAULT,
+        TRIGGER_GYRO_FAULT,
+        TRIGGER_BUTTON,
+        TRIGGER_COMMAND,
+    };
+
+    struct Sample {
+        int32_t field[NUM_FIELDS];
+    };
+
+    /**
+     * Header sent before the blocks of a dump, oldest block first.
+     */
+    struct DumpHeader {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t numFields;
+        uint8_t trigger;
+        uint8_t reserved;
+        uint16_t blockSize;
+        uint16_t numBlocks;
+        uint32_t tickFrequency;
+    };
+
+    struct BlockHeader {
+        uint16_t count;
+        uint16_t length;
+    };
+
+    static constexpr uint32_t DUMP_MAGIC = 0x42424648; // "HFBB"
+    static constexpr uint8_t DUMP_VERSION = 1;
+    static constexpr size_t BLOCK_SIZE = 512;
+    // number of samples kept after a trigger before the recording freezes
+    static constexpr size_t POST_TRIGGER_SAMPLES = 200;
+
+    Blackbox(uint8_t *storage, size_t size);
+
+    void record(const Sample &sample);
+    void trigger(Trigger reason);
+    void rearm();
+
+    bool isFrozen() const {
+        return frozen;
+    }
+
+    Trigger getTrigger() const {
+        return reason;
+    }
+
+    void dump(BaseChannel *chp) const;
+
+    static Blackbox *instance;
+    static void shellCommand(BaseChannel *chp, int argc, char *argv[]);
+
+    static size_t decodeBlock(const uint8_t *block, Sample *samples, size_t maxSamples);
+
+protected:
+    // bitmask plus a five-byte varint per field
+    static constexpr size_t MAX_RECORD_SIZE = 5 * (NUM_FIELDS + 1);
+    static_assert(NUM_FIELDS <= 32, "Field mask must fit in 32 bits");
+
+    uint8_t * const storage;
+    const size_t numBlocks;
+
+    size_t block;
+    bool wrapped;
+    Sample prev;
+
+    volatile Trigger reason;
+    volatile size_t postTrigger;
+    volatile bool frozen;
+    volatile bool rearmRequested;
+
+    uint8_t *blockAt(size_t i) const {
+        return storage + i * BLOCK_SIZE;
+    }
+
+    void startBlock(size_t i);
+    void reset();
+};
+
+#endif /* BLACKBOX_H_ */
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#ifndef CONFIGSTORE_H_
+#define CONFIGSTORE_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Versioned, CRC-checked key/value store in two flash sectors.
+ *
+ * Records are only ever appended to the active page, so each value update
+ * costs a few word writes and erases are spread over many updates. When the
+ * active page fills up, the latest record of every key is copied to the other
+ * page, and that page's header is written last. Until the header is written
+ * the old page stays active, so a power loss during compaction loses nothing.
+ *
+ * A record's CRC word is programmed after its payload and serves as its
+ * commit marker; torn records fail the CRC and are skipped.
+ *
+ * Public accessors lock a mutex, so the store may be shared between threads.
+ */
+class ConfigStore {
+public:
+    enum Key {
+        KEY_CONFIG,
+        KEY_GYRO_CAL,
+        MAX_KEYS = 8
+    };
+
+    struct Page {
+        uint8_t *base;
+        size_t size;
+        uint8_t sector;
+    };
+
+    struct PageHeader {
+        uint32_t magic;
+        uint16_t format;
+        uint16_t reserved;
+        uint32_t sequence;
+        uint32_t crc;
+    };
+
+    struct RecordHeader {
+        uint8_t key;
+        uint8_t version;
+        uint16_t length;
+        uint32_t crc;
+    };
+
+    static constexpr uint32_t MAGIC = 0x46434648; // "HFCF"
+    static constexpr uint16_t FORMAT = 1;
+    static constexpr size_t MAX_RECORD_LENGTH = 256;
+
+    ConfigStore(const Page &a, const Page &b);
+
+    bool mount();
+    bool read(uint8_t key, uint8_t version, void *data, size_t length) const;
+    bool write(uint8_t key, uint8_t version, const void *data, size_t length);
+    bool compact();
+
+    size_t getUsed() const {
+        return freeOffset;
+    }
+
+    size_t getSize() const {
+        return pages[active].size;
+    }
+
+    uint32_t getSequence() const {
+        return sequence;
+    }
+
+    static ConfigStore *instance;
+
+    static uint32_t crc32(uint32_t crc, const void *data, size_t length);
+
+protected:
+    static constexpr size_t NO_RECORD = 0;
+
+    const Page pages[2];
+    size_t active;
+    uint32_t sequence;
+    size_t freeOffset;
+    // offset of the last record seen for each key, not yet CRC-checked
+    size_t latest[MAX_KEYS];
+    mutable hw::Mutex mutex;
+
+    bool pageValid(const Page &page, uint32_t *sequence) const;
+    void scan();
+    bool recordValid(const Page &page, size_t offset) const;
+    size_t findValid(uint8_t key) const;
+    bool append(const Page &page, size_t *offset, uint8_t key, uint8_t version, const void *data, size_t length);
+    bool writeLocked(uint8_t key, uint8_t version, const void *data, size_t length);
+    bool compactLocked();
+
+    static size_t padded(size_t length) {
+        return (length + 3) & ~size_t(3);
+    }
+};
+
+#endif /* CONFIGSTORE_H_ */
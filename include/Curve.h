@@ -0,0 +1,150 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef CURVE_H_
+#define CURVE_H_
+
+#include "IntMath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+
+/**
+ * Odd-symmetric stick response curve with expo and super rate, sampled into a
+ * table of output values and linearly interpolated, so that shaping a stick
+ * costs a lookup and a multiply instead of float math.
+ *
+ * For a stick position x in [0, 1] the curve is
+ *
+ *   y = ((1 - expo) x + expo x^3) (1 - superRate) / (1 - superRate x)
+ *
+ * which is zero at center and one at full stick for any setting. Expo flattens
+ * the center for fine aiming; super rate additionally steepens the ends.
+ *
+ * The table is built by a constexpr constructor, so curves with constant
+ * settings are generated at compile time. Curves from runtime parameters are
+ * rebuilt with the same constructor when the parameters change. A curve with
+ * neither expo nor super rate passes values through untouched.
+ */
+class Curve {
+public:
+    static constexpr size_t NUM_SEGMENTS = 64;
+    static constexpr uint32_t FRAC_BITS = 8;
+    // largest output range, so that the position product fits in 32 bits
+    static constexpr int32_t MAX_RANGE = 65535;
+    // past this the ends bend too sharply for the table, which stays within
+    // 0.2% of full scale up to here
+    static constexpr float MAX_SUPER_RATE = 0.8f;
+
+    /**
+     * Straight line.
+     */
+    constexpr Curve() :
+            Curve(0.f, 0.f, 0) {
+    }
+
+    /**
+     * @param expo blend of the cubic into the line, within [0, 1]
+     * @param superRate end steepening, within [0, MAX_SUPER_RATE]
+     * @param range output at full stick, within [0, MAX_RANGE]; inputs are
+     *  expected in [-range, range]
+     */
+    constexpr Curve(float expo, float superRate, int32_t range) :
+            Curve(expo, superRate, range, MakeIndices<NUM_SEGMENTS + 1>::type()) {
+    }
+
+    constexpr bool isLinear() const {
+        return linear;
+    }
+
+    /**
+     * @return output at stick position index / NUM_SEGMENTS
+     */
+    constexpr int32_t at(size_t index) const {
+        return points[index];
+    }
+
+    /**
+     * @param value stick position, within [-range, range]
+     * @return shaped stick position, within [-range, range]
+     */
+    int32_t apply(int32_t value) const {
+        if (linear) {
+            return value;
+        }
+        const uint32_t magnitude = std::min(-nabs(value), range);
+        // step is rounded up, so full stick lands exactly on the last point
+        const uint32_t position = (magnitude * step) >> 16;
+        const uint32_t index = std::min(position >> FRAC_BITS, uint32_t(NUM_SEGMENTS - 1));
+        const int32_t fraction = position - (index << FRAC_BITS);
+        const int32_t shaped = points[index] + (((points[index + 1] - points[index]) * fraction) >> FRAC_BITS);
+        return value < 0 ? -shaped : shaped;
+    }
+
+protected:
+    template<size_t ... I>
+    struct Indices {
+    };
+
+    template<size_t N, size_t ... I>
+    struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {
+    };
+
+    template<size_t ... I>
+    struct MakeIndices<0, I...> {
+        typedef Indices<I...> type;
+    };
+
+    bool linear;
+    int32_t range;
+    uint32_t step;
+    int32_t points[NUM_SEGMENTS + 1];
+
+    template<size_t ... I>
+    constexpr Curve(float expo, float superRate, int32_t range, Indices<I...>) :
+            linear(expo == 0.f && superRate == 0.f),
+            range(range),
+            step(range > 0 ? ((NUM_SEGMENTS << FRAC_BITS << 16) + range - 1) / range : 0),
+            points { point(I, expo, superRate, range)... } {
+    }
+
+    static constexpr float shape(float x, float expo, float superRate) {
+        return ((1.f - expo) * x + expo * x * x * x) * (1.f - superRate) / (1.f - superRate * x);
+    }
+
+    static constexpr int32_t point(size_t index, float expo, float superRate, int32_t range) {
+        return int32_t(shape(float(index) / NUM_SEGMENTS, expo, superRate) * range + 0.5f);
+    }
+};
+
+// full stick must still give full output at the steepest settings
+static_assert(Curve(1.f, Curve::MAX_SUPER_RATE, Curve::MAX_RANGE).at(Curve::NUM_SEGMENTS) == Curve::MAX_RANGE,
+        "Curve misses its end point");
+static_assert(uint64_t(Curve::MAX_RANGE) * ((Curve::NUM_SEGMENTS << Curve::FRAC_BITS << 16) / Curve::MAX_RANGE + 1)
+        <= ~uint32_t(0), "Curve position overflows 32 bits");
+
+#endif /* CURVE_H_ */
@@ -0,0 +1,233 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef DSP_H_
+#define DSP_H_
+
+#include <stdint.h>
+
+// Cortex-M4 DSP instructions when the core has them, C emulation otherwise;
+// define DSP_USE_ASM to 0 to force the emulation on the robot
+#ifndef DSP_USE_ASM
+#if defined(__ARM_FEATURE_DSP)
+#define DSP_USE_ASM 1
+#else
+#define DSP_USE_ASM 0
+#endif
+#endif
+
+/**
+ * Saturating and packed 16-bit integer arithmetic. Each function matches the
+ * Cortex-M4 instruction it is named after, bit for bit, except that the
+ * emulation doesn't set the sticky Q flag. DspCheck verifies both against
+ * straightforward 64-bit reference code.
+ *
+ * Packed words hold two int16_t lanes, the low lane in the low half.
+ */
+namespace dsp {
+
+// limits spelled out, as older C++ libraries hide the stdint.h macros
+static constexpr int32_t MAX32 = 0x7fffffff;
+static constexpr int32_t MIN32 = -MAX32 - 1;
+
+static inline int32_t saturate32(int64_t value) {
+    return value > MAX32 ? MAX32 : value < MIN32 ? MIN32 : int32_t(value);
+}
+
+/**
+ * Saturates to a signed BITS-bit range (SSAT).
+ */
+template<unsigned BITS>
+static inline int32_t ssat(int32_t value) {
+    static_assert(BITS >= 1 && BITS <= 32, "SSAT saturates to 1 to 32 bits");
+#if DSP_USE_ASM
+    int32_t result;
+    asm("ssat %0, %1, %2" : "=r"(result) : "I"(BITS), "r"(value));
+    return result;
+#else
+    const int64_t max = (int64_t(1) << (BITS - 1)) - 1;
+    return value > max ? int32_t(max) : value < -max - 1 ? int32_t(-max - 1) : value;
+#endif
+}
+
+/**
+ * Saturates to an unsigned BITS-bit range (USAT).
+ */
+template<unsigned BITS>
+static inline uint32_t usat(int32_t value) {
+    static_assert(BITS <= 31, "USAT saturates to 0 to 31 bits");
+#if DSP_USE_ASM
+    uint32_t result;
+    asm("usat %0, %1, %2" : "=r"(result) : "I"(BITS), "r"(value));
+    return result;
+#else
+    const int32_t max = int32_t((uint32_t(1) << BITS) - 1);
+    return value > max ? max : value < 0 ? 0 : value;
+#endif
+}
+
+/**
+ * Saturating add (QADD).
+ */
+static inline int32_t qadd(int32_t a, int32_t b) {
+#if DSP_USE_ASM
+    int32_t result;
+    asm("qadd %0, %1, %2" : "=r"(result) : "r"(a), "r"(b));
+    return result;
+#else
+    return saturate32(int64_t(a) + b);
+#endif
+}
+
+/**
+ * Saturating subtract, a - b (QSUB).
+ */
+static inline int32_t qsub(int32_t a, int32_t b) {
+#if DSP_USE_ASM
+    int32_t result;
+    asm("qsub %0, %1, %2" : "=r"(result) : "r"(a), "r"(b));
+    return result;
+#else
+    return saturate32(int64_t(a) - b);
+#endif
+}
+
+/**
+ * Packs two lanes into a word (PKHBT).
+ */
+static inline uint32_t pack16(int32_t low, int32_t high) {
+#if DSP_USE_ASM
+    uint32_t result;
+    asm("pkhbt %0, %1, %2, lsl #16" : "=r"(result) : "r"(low), "r"(high));
+    return result;
+#else
+    return uint16_t(low) | uint32_t(uint16_t(high)) << 16;
+#endif
+}
+
+static inline int32_t low16(uint32_t packed) {
+    return int16_t(packed);
+}
+
+static inline int32_t high16(uint32_t packed) {
+    return int16_t(packed >> 16);
+}
+
+/**
+ * Lane-wise saturating add (QADD16).
+ */
+static inline uint32_t qadd16(uint32_t a, uint32_t b) {
+#if DSP_USE_ASM
+    uint32_t result;
+    asm("qadd16 %0, %1, %2" : "=r"(result) : "r"(a), "r"(b));
+    return result;
+#else
+    return pack16(ssat<16>(low16(a) + low16(b)), ssat<16>(high16(a) + high16(b)));
+#endif
+}
+
+/**
+ * Lane-wise saturating subtract, a - b (QSUB16).
+ */
+static inline uint32_t qsub16(uint32_t a, uint32_t b) {
+#if DSP_USE_ASM
+    uint32_t result;
+    asm("qsub16 %0, %1, %2" : "=r"(result) : "r"(a), "r"(b));
+    return result;
+#else
+    return pack16(ssat<16>(low16(a) - low16(b)), ssat<16>(high16(a) - high16(b)));
+#endif
+}
+
+/**
+ * Sum of the lane-wise products, wrapping on overflow (SMUAD). Only happens
+ * when both products are (-2^15)^2.
+ */
+static inline int32_t smuad(uint32_t a, uint32_t b) {
+#if DSP_USE_ASM
+    int32_t result;
+    asm("smuad %0, %1, %2" : "=r"(result) : "r"(a), "r"(b));
+    return result;
+#else
+    return int32_t(uint32_t(low16(a) * low16(b)) + uint32_t(high16(a) * high16(b)));
+#endif
+}
+
+/**
+ * Accumulates the lane-wise products, wrapping on overflow (SMLAD).
+ */
+static inline int32_t smlad(uint32_t a, uint32_t b, int32_t acc) {
+#if DSP_USE_ASM
+    int32_t result;
+    asm("smlad %0, %1, %2, %3" : "=r"(result) : "r"(a), "r"(b), "r"(acc));
+    return result;
+#else
+    return int32_t(uint32_t(acc) + uint32_t(low16(a) * low16(b)) + uint32_t(high16(a) * high16(b)));
+#endif
+}
+
+/**
+ * High word of the 64-bit product, rounded to nearest (SMMULR). A Q31 by Q31
+ * multiply giving Q30.
+ */
+static inline int32_t mulhr(int32_t a, int32_t b) {
+#if DSP_USE_ASM
+    int32_t result;
+    asm("smmulr %0, %1, %2" : "=r"(result) : "r"(a), "r"(b));
+    return result;
+#else
+    return int32_t(uint64_t(int64_t(a) * b + 0x80000000) >> 32);
+#endif
+}
+
+/**
+ * Saturating multiply (SMULL, then saturation).
+ */
+static inline int32_t qmul(int32_t a, int32_t b) {
+    return saturate32(int64_t(a) * b);
+}
+
+/**
+ * Fixed-point multiply with FRAC fraction bits, rounded to nearest and
+ * saturated.
+ */
+template<unsigned FRAC>
+static inline int32_t mulq(int32_t a, int32_t b) {
+    static_assert(FRAC >= 1 && FRAC <= 31, "Q format needs 1 to 31 fraction bits");
+    return saturate32((int64_t(a) * b + (int64_t(1) << (FRAC - 1))) >> FRAC);
+}
+
+/**
+ * Q15 multiply of two int16_t values, rounded and saturated to Q15. Only
+ * (-1)(-1) saturates.
+ */
+static inline int32_t mulq15(int32_t a, int32_t b) {
+    return ssat<16>((a * b + (1 << 14)) >> 15);
+}
+
+} // namespace dsp
+
+#endif /* DSP_H_ */
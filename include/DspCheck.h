@@ -0,0 +1,76 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef DSPCHECK_H_
+#define DSPCHECK_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Checks the primitives in Dsp.h against plain 64-bit reference code, over
+ * every combination of edge-case operands and then pseudo-random ones. On the
+ * robot this checks the DSP instructions as the compiler emits them; on a
+ * host, the emulation that stands in for them.
+ *
+ * Results print as CSV lines starting with "dspcheck".
+ */
+class DspCheck {
+public:
+    // true if the primitive matches the reference for these operands
+    typedef bool (*Check)(uint32_t a, uint32_t b, uint32_t c);
+
+    struct Case {
+        const char *name;
+        Check check;
+    };
+
+    struct Result {
+        const char *name;
+        uint32_t checked;
+        uint32_t failed;
+        // operands of the first failure
+        uint32_t a;
+        uint32_t b;
+        uint32_t c;
+    };
+
+    static constexpr uint32_t DEFAULT_ITERATIONS = 100000;
+    static constexpr uint32_t DEFAULT_SEED = 1;
+
+    static const Case cases[];
+    static const size_t NUM_CASES;
+
+    static const Case *find(const char *name);
+    static Result run(const Case &checkCase, uint32_t iterations, uint32_t seed);
+    static void print(BaseChannel *chp, const Result &result);
+
+    static void shellCommand(BaseChannel *chp, int argc, char *argv[]);
+};
+
+#endif /* DSPCHECK_H_ */
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Ring of timestamped events kept in backup SRAM, which survives resets. Each
+ * entry is stamped with the boot it was logged in and the system time since
+ * that boot. The last hard fault's registers and a stack snapshot are kept
+ * separately so that a flood of later events can't push them out.
+ */
+class EventLog {
+public:
+    enum Type {
+        EVENT_RESET,
+        EVENT_GYRO_FAIL,
+        EVENT_M1_FAULT,
+        EVENT_FAILSAFE,
+        EVENT_FAILSAFE_CLEAR,
+        EVENT_HARD_FAULT,
+        NUM_EVENT_TYPES
+    };
+
+    struct Entry {
+        uint16_t boot;
+        uint8_t type;
+        uint8_t reserved;
+        uint32_t time;
+        uint32_t arg;
+    };
+
+    static constexpr size_t STACK_WORDS = 32;
+
+    struct FaultRecord {
+        uint32_t valid;
+        uint16_t boot;
+        uint16_t reserved;
+        // exception frame, in stacking order
+        uint32_t r0, r1, r2, r3, r12, lr, pc, psr;
+        // stack pointer of the faulting code, where the snapshot starts
+        uint32_t sp;
+        uint32_t cfsr, hfsr, mmfar, bfar;
+        uint32_t stack[STACK_WORDS];
+    };
+
+    static constexpr size_t NUM_ENTRIES = 256;
+
+    struct Storage {
+        uint32_t magic;
+        uint16_t boot;
+        uint16_t head;
+        uint16_t count;
+        uint16_t reserved;
+        FaultRecord fault;
+        Entry entries[NUM_ENTRIES];
+    };
+
+    static void init();
+    static void log(Type type, uint32_t arg = 0);
+    static void clear();
+
+    static void printSummary(BaseChannel *chp);
+    static void print(BaseChannel *chp);
+    static void shellCommand(BaseChannel *chp, int argc, char *argv[]);
+
+    static void saveFault(const uint32_t *frame, uint32_t excReturn);
+
+protected:
+    static constexpr uint32_t MAGIC = 0x4c475645; // "EVGL"
+    static constexpr uint32_t FAULT_VALID = 0x544c4146; // "FALT"
+
+    static Storage &storage();
+    static void printEntry(BaseChannel *chp, const Entry &entry);
+    static void printFault(BaseChannel *chp, const FaultRecord &fault);
+};
+
+#endif /* EVENTLOG_H_ */
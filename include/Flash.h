@@ -0,0 +1,48 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Minimal internal flash writer. Flash reads are plain memory reads, so only
+ * erasing and programming go through here; a simulated image can stand in by
+ * providing these two functions with NOR semantics (erase sets all bits,
+ * programming can only clear them).
+ *
+ * The CPU stalls on any flash access while an erase or program operation is
+ * in progress, and a sector erase takes on the order of a second, so none of
+ * this may be called with the motors running.
+ */
+class Flash {
+public:
+    static bool eraseSector(uint8_t sector, uint8_t *base, size_t size);
+    static bool program(uint8_t *dst, const uint32_t *src, size_t words);
+};
+
+#endif /* FLASH_H_ */
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef GAINSCHEDULE_H_
+#define GAINSCHEDULE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Yaw PID gains scheduled on the weapon command. A spinning weapon couples
+ * into yaw through its angular momentum, so gains that suit an idle weapon are
+ * off at full speed. The schedule holds a gain scale at evenly spaced weapon
+ * commands, from idle, where it is one, to full, and linearly interpolates the
+ * scale between them. The same scale applies to all three gains, keeping the
+ * ratios that set the loop's shape.
+ *
+ * Gains only change when the scale does, so a flat schedule never retunes.
+ */
+class GainSchedule {
+public:
+    // breakpoints at 0, 25, 50, 75 and 100% weapon command
+    static constexpr size_t NUM_POINTS = 5;
+
+    struct Gains {
+        float kp;
+        float ki;
+        float kd;
+    };
+
+    GainSchedule();
+
+    void configure(const Gains &base, const float *scales, int32_t range);
+    void retune(const Gains &found, float foundScale);
+    bool update(int32_t command);
+
+    const Gains &getGains() const {
+        return gains;
+    }
+
+    const Gains &getBase() const {
+        return base;
+    }
+
+    float getScale() const {
+        return scale;
+    }
+
+protected:
+    Gains base;
+    // scale at each breakpoint past idle
+    float scales[NUM_POINTS];
+    int32_t range;
+    float scale;
+    Gains gains;
+
+    void apply();
+};
+
+#endif /* GAINSCHEDULE_H_ */
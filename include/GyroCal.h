@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef GYROCAL_H_
+#define GYROCAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Gyro zero-rate calibration, as persisted in the config store. All values are
+ * raw sensor units.
+ */
+struct GyroCal {
+    // bump whenever the layout changes, to invalidate stored copies
+    static constexpr uint8_t VERSION = 1;
+
+    int16_t bias[3];
+    int8_t temperature;
+    uint8_t reserved;
+    uint16_t spread; // largest peak-to-peak reading of any axis while averaging
+    uint16_t samples;
+};
+
+/**
+ * Accumulates gyro readings into a zero-rate bias. The peak-to-peak spread of
+ * the readings tells whether the sensor was actually still while averaging.
+ */
+class GyroCalibrator {
+public:
+    GyroCalibrator();
+
+    void reset();
+    void add(const int16_t rates[3]);
+    void getBias(int16_t bias[3]) const;
+    uint16_t getSpread() const;
+    GyroCal result(int8_t temperature) const;
+
+    size_t count() const {
+        return samples;
+    }
+
+protected:
+    int32_t sums[3];
+    int16_t lows[3];
+    int16_t highs[3];
+    size_t samples;
+};
+
+#endif /* GYROCAL_H_ */
@@ -50,66 +50,194 @@
 
 #define DBG_SERIAL (SD6)
 
+// core-coupled memory, not touched by ChibiOS or DMA
+#define CCM_RAM_BASE (0x10000000)
+#define CCM_RAM_SIZE (64 * 1024)
+
+#define MAIN_RAM_END (0x20020000)
+
+// battery-backed SRAM, retained across resets
+#define BKP_SRAM_SIZE (4 * 1024)
+
+// last two 128 KB flash sectors, reserved for the config store
+#define CONFIG_FLASH_SECTOR_SIZE (128 * 1024)
+#define CONFIG_FLASH_A_SECTOR (10)
+#define CONFIG_FLASH_A_BASE (0x080c0000)
+#define CONFIG_FLASH_B_SECTOR (11)
+#define CONFIG_FLASH_B_BASE (0x080e0000)
+
 class A4960;
 class VNH5050A;
-struct ICUDriver;
 class L3GD20;
+class ConfigStore;
 
+#include "Hw.h"
 #include "Pid.hpp"
+#include "Blackbox.h"
+#include "Params.h"
+#include "GyroCal.h"
+#include "PpmDecoder.h"
+#include "RangeMap.h"
+#include "Curve.h"
+#include "Mixer.h"
+#include "Biquad.h"
+#include "NotchTracker.h"
+#include "RateEstimator.h"
+#include "HeadingHold.h"
+#include "Autotune.h"
+#include "GainSchedule.h"
 
 class HFCS {
 public:
-    HFCS(A4960 &m1, VNH5050A &mLeft, VNH5050A &mRight, ICUDriver *icup, L3GD20 &gyro);
+    HFCS(A4960 &m1, VNH5050A &mLeft, VNH5050A &mRight, hw::Icu *icup, L3GD20 &gyro, Blackbox &blackbox, Params &params,
+            ConfigStore &store);
+
+    static constexpr uint32_t LOOP_DELAY_US = 5000;
+    static constexpr uint32_t FAILSAFE_DELAY_MS = 50;
+    static constexpr uint32_t SPECTRUM_DELAY_MS = 20;
+    // time without a valid receiver frame before the motors are cut
+    static constexpr uint32_t FAILSAFE_TIMEOUT_MS = 500;
 
     void init();
     NORETURN void fastLoop();
     NORETURN void failsafeLoop();
+    NORETURN void spectrumLoop();
+
+    void start();
+    void step();
+    void failsafeStep();
+    void spectrumStep();
+
+    bool isArmed() const {
+        return channelsValid;
+    }
+
+    // inputs and outputs of the last step, as recorded to the blackbox
+    const Blackbox::Sample &getFrame() const {
+        return frame;
+    }
+
+    const Autotune &getAutotune() const {
+        return autotune;
+    }
+
+    // timestamp the next step measures its period from
+    uint32_t getLastTimestamp() const {
+        return lastTimestamp;
+    }
 
     static HFCS *instance;
-    static void icuWidthCb(ICUDriver *icup);
-    static void icuPeriodCb(ICUDriver *icup);
+    static void icuWidthCb(hw::Icu *icup);
+    static void icuPeriodCb(hw::Icu *icup);
+
+    static int32_t mapRanges(int32_t inLow, int32_t inHigh, int32_t inValue, int32_t outLow, int32_t outHigh, int32_t deadband);
 
 protected:
     A4960 &m1;
     VNH5050A &mLeft;
     VNH5050A &mRight;
-    ICUDriver * const icup;
+    hw::Icu * const icup;
     L3GD20 &gyro;
+    Blackbox &blackbox;
+    Params &params;
+    ConfigStore &store;
 
-    static constexpr size_t NUM_CHANNELS = 5;
-    icucnt_t pulseWidths[NUM_CHANNELS];
-    size_t currentPulse;
+    static constexpr size_t NUM_CHANNELS = PpmDecoder::NUM_CHANNELS;
+    PpmDecoder ppm;
     const int32_t dcOutRange;
 
+    // stick maps, rebuilt from the config whenever it changes
+    RangeMap throttleMap;
+    RangeMap rateMap;
+    RangeMap driveMap;
+    // response curves on top of the stick maps, in their output units
+    Curve rateCurve;
+    Curve turnCurve;
+    Curve driveCurve;
+
+    enum MixInput {
+        MIX_FORWARD,
+        MIX_TURN,
+        NUM_MIX_INPUTS
+    };
+
+    enum MixOutput {
+        MIX_LEFT,
+        MIX_RIGHT,
+        NUM_MIX_OUTPUTS
+    };
+
+    Mixer mixer;
+
+    enum GyroStage {
+        GYRO_LOW_PASS,
+        GYRO_NOTCH,
+        // one stage per notch the tracker may place
+        GYRO_DYNAMIC_NOTCH,
+        NUM_GYRO_STAGES = GYRO_DYNAMIC_NOTCH + NotchTracker::MAX_NOTCHES
+    };
+
+    FixedBiquadBank<3, NUM_GYRO_STAGES> gyroFilter;
+    NotchTracker notchTracker;
+    // yaw rate for the controller, from the drive model and the gyro
+    RateEstimator rateEstimator;
+    bool rateEstimate;
+    // heading loop around the rate controller, selected by the aux switch
+    HeadingHold headingHold;
+    bool holdingHeading;
+    // relay experiment standing in for the yaw PID while it runs
+    Autotune autotune;
+    // stick positions in percent, for the recalibration command
+    RangeMap throttlePercentMap;
+    RangeMap stickPercentMap;
+    RangeMap rudderPercentMap;
+
     int32_t channels[NUM_CHANNELS];
     bool channelsValid;
-    systime_t lastValidChannels;
+    hw::Time lastValidChannels;
 
     bool gyroEnable;
     PidNs::Pid<float, float> gyroPID;
-    int16_t gyroBias[3];
-
-    static constexpr int32_t INPUT_LOW = 1200;
-    static constexpr int32_t INPUT_HIGH = 1800;
-    static constexpr int32_t INPUT_DEADBAND = 17;
-    static constexpr int32_t DC_DEADBAND = 10;
-    static icucnt_t negativeWidth;
-    static icucnt_t positiveWidth;
+    // gyroPID gains for the weapon speed
+    GainSchedule gainSchedule;
+    // measured step period, for loops that jitter
+    uint32_t lastTimestamp;
+    float periodMs;
+    GyroCal gyroCal;
+    GyroCalibrator calibrator;
+    bool calibrating;
+    size_t commandSteps;
+    // calibration not in flash yet, waiting for the receiver to be off long
+    // enough that a flash erase can't stall a match
+    bool calibrationUnsaved;
+    size_t receiverOffSteps;
+
+    Blackbox::Sample frame;
+    bool buttonPressed;
+    bool m1Fault;
+    // new weapon motor fault, for the control thread to log with its diagnostics
+    volatile bool m1FaultPending;
+    bool failsafeTripped;
+
+    static hw::IcuCount negativeWidth;
+    static hw::IcuCount positiveWidth;
 
     void newPulse();
+    void applyConfig();
+
+    bool collectGyro(size_t ignoreIters, size_t iters);
+    bool calibrationHolds(const GyroCal &stored, int8_t temperature) const;
+    bool stickCommanded();
+    void calibrationStep();
+    void saveCalibration(const GyroCal &cal);
+    void gyroFailed();
 
     void gyroMotorControl();
+    int32_t yawControl(int32_t aileron, float rate);
+    int32_t autotuneControl(float rate);
     void manualMotorControl();
     void disableMotors();
-
-    bool checkPulseWidth(icucnt_t pulseWidth) const {
-        if (pulseWidth > 2200 || pulseWidth < 800) {
-            return false;
-        }
-        return true;
-    }
-
-    static int32_t mapRanges(int32_t inLow, int32_t inHigh, int32_t inValue, int32_t outLow, int32_t outHigh, int32_t deadband);
+    void driveMotors(const int32_t *mix, int32_t throttle);
 };
 
 #endif /* HFCS_H_ */
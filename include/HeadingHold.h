@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef HEADINGHOLD_H_
+#define HEADINGHOLD_H_
+
+/**
+ * Outer heading loop for the yaw rate controller. The stick commands a rate
+ * as usual, which is integrated into a target heading, while the gyro rate is
+ * integrated into a heading estimate. The rate set point is the commanded rate
+ * plus a correction proportional to the heading error, so a hit that knocks
+ * the robot off its line is steered back out instead of only being damped.
+ *
+ * Only the difference of the two integrals, the heading error, is kept, so
+ * nothing grows while the robot spins. The error is limited, moving the target
+ * along with the robot beyond that, so that a long spin isn't unwound after.
+ *
+ * Rates are in gyro units; the heading error is in gyro units times seconds.
+ */
+class HeadingHold {
+public:
+    // gyro units per deg/s, at 2000 deg/s full scale
+    static constexpr float RATE_SCALE = 32767.f / 2000.f;
+
+    HeadingHold();
+
+    void configure(float kp, float maxErrorDeg, float dt);
+    void reset();
+
+    float update(float commandedRate, float measuredRate);
+
+    float getErrorDeg() const {
+        return error / RATE_SCALE;
+    }
+
+protected:
+    float kp;
+    float maxError;
+    float dt;
+    float error;
+};
+
+#endif /* HEADINGHOLD_H_ */
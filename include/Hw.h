@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef HW_H_
+#define HW_H_
+
+/**
+ * Hardware interface used by the control code in place of direct ChibiOS and
+ * HAL calls, so that it also builds on a host machine. Each backend provides
+ * HwPort.h, selected by the include path:
+ *
+ * - port/chibios: ChibiOS/RT and the STM32 HAL, for the robot
+ * - host/include: mock peripherals and a virtual clock, for x86 builds
+ * - sim/include: the ChibiOS/RT POSIX simulator with mock peripherals, for
+ *   running the whole firmware on x86
+ *
+ * The mock peripherals shared by the last two live in port/mock.
+ *
+ * Everything lives in namespace hw and is modeled on the ChibiOS API:
+ *
+ * - types Time, Status, Mutex, Port, Pwm, PwmChannel, PwmCount, Spi, I2c,
+ *   I2cAddr, Icu, IcuCount, and the console type BaseChannel
+ * - Status constants OK and TIMEOUT
+ * - TICK_HZ, constexpr msToTicks(ms), usToTicks(us)
+ * - now(), sleepUntil(time), sleepMs(ms)
+ * - setPad, clearPad, togglePad, readPad(port, pad), with the pin names of
+ *   board/board.h
+ * - pwmSet(pwm, channel, width), pwmPeriod(pwm)
+ * - spiExchangeWord(spi, tx), a complete 16-bit transaction with select
+ * - i2cTransfer(i2c, addr, tx, txBytes, rx, rxBytes, timeout)
+ * - icuStartCapture(icu), and icuWidthI/icuPeriodI(icu) for the callbacks
+ * - irqSave(), irqRestore(state) around short critical sections that must
+ *   also exclude interrupt handlers
+ * - mutexInit, mutexLock, mutexUnlock(mutex)
+ * - channelWrite(chp, data, length), a blocking raw write
+ * - backupRam(), enableBackupRam(), takeResetFlags() for storage that
+ *   survives a reset
+ * - startCycleCounter(), cycleCount(), and the name of its unit CYCLE_UNIT,
+ *   a free-running 32-bit counter for benchmarks
+ * - TIMESTAMP_HZ and timestamp(), a free-running 32-bit counter for measuring
+ *   control loop periods, started by startCycleCounter()
+ *
+ * Formatted output goes through chprintf, which the host backend emulates.
+ */
+#include "HwPort.h"
+
+// keeps the compiler from moving memory accesses across it, for data handed
+// from one thread to another behind a flag or sequence counter
+#define COMPILER_BARRIER() asm volatile("" ::: "memory")
+
+#endif /* HW_H_ */
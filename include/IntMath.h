@@ -0,0 +1,82 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef INTMATH_H_
+#define INTMATH_H_
+
+#include <stdint.h>
+
+/**
+ * Negative absolute value. Used to avoid undefined behavior for most negative
+ * integer (see C99 standard 7.20.6.1.2 and footnote 265 for the description of
+ * abs/labs/llabs behavior).
+ *
+ * @param i input value, as a 32-bit signed integer
+ * @return negative absolute value of i; defined for all values of i
+ */
+static inline int32_t nabs(int32_t i) {
+#if (((int32_t)-1) >> 1) == ((int32_t)-1)
+    // signed right shift sign-extends (arithmetic)
+    const int32_t negSign = ~(i >> 31); // splat sign bit into all 32 and complement
+    // if i is positive (negSign is -1), xor will invert i and sub will add 1
+    // otherwise i is unchanged
+    return (i ^ negSign) - negSign;
+#else
+    return i < 0 ? i : -i;
+#endif
+}
+
+/**
+ * Overflow-safe average of two signed integers. The naive average function is
+ * erroneous when the sum of the inputs overflows integer limits; this average
+ * works by summing the halves of the input values and then correcting the sum
+ * for rounding.
+ *
+ * @param a first value, as a 32-bit signed integer
+ * @param b second value, as a 32-bit signed integer
+ * @return signed average of the two values, rounded towards zero if their
+ * average is not an integer
+ */
+static inline int32_t avg(int32_t a, int32_t b) {
+#if (((int32_t)-1) >> 1) != ((int32_t)-1)
+#error "Arithmetic right shift not available with this compiler/platform."
+#endif
+    // shifts divide by two, rounded towards negative infinity
+    const int32_t sumHalves = (a >> 1) + (b >> 1);
+    // this has error of magnitude one if both are odd
+    const uint32_t bothOdd = (a & b) & 1;
+    // round toward zero; add one if one input is odd and sum is negative
+    const uint32_t roundToZero = (sumHalves < 0) & (a ^ b);
+
+    // result is sum of halves corrected for rounding
+    return sumHalves + bothOdd + roundToZero;
+}
+
+static inline int32_t signum(int32_t i) {
+    return (i > 0) - (i < 0);
+}
+
+#endif /* INTMATH_H_ */
@@ -30,13 +30,12 @@
 #ifndef L3GD20_H_
 #define L3GD20_H_
 
-#include "ch.h"
-#include "hal.h"
+#include "Hw.h"
 
 class L3GD20
 {
 	public:
-		L3GD20(I2CDriver *i2cp);
+		L3GD20(hw::I2c *i2cp);
 
 		void setSlaveAddrLSB(uint8_t lsb);
 		void enableDefault();
@@ -46,12 +45,12 @@ class L3GD20
 		void setBandwidth(uint8_t bandwidth);
 		void setOutputDataRate(uint8_t dataRate);
 
-		msg_t error() const {
+		hw::Status error() const {
             return errFlag;
         }
 
 		void resetError() {
-		    errFlag = RDY_OK;
+		    errFlag = hw::OK;
 		}
 
 	protected:
@@ -59,9 +58,9 @@ class L3GD20
 		uint8_t readReg(uint8_t reg);
 
 	protected:
-		I2CDriver * const i2cp;
-		i2caddr_t i2cAddr;
-		msg_t errFlag;
+		hw::I2c * const i2cp;
+		hw::I2cAddr i2cAddr;
+		hw::Status errFlag;
 };
 
 #endif /* L3GD20_H_ */
@@ -0,0 +1,130 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// calls below this level compile to nothing; override with -DLOG_LEVEL=...
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log::write(Log::ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::write(Log::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::write(Log::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void) 0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::write(Log::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void) 0)
+#endif
+
+/**
+ * Deferred-formatting logger. Call sites only copy the address of the format
+ * string, which lives in flash and doubles as its ID, and up to four raw
+ * integer arguments into a ring buffer. Formatting happens later in a
+ * low-priority thread, or on a host that maps the addresses back to strings
+ * using the firmware ELF.
+ *
+ * Writing is safe from both thread and ISR context. Records are dropped, and
+ * counted, when the ring is full.
+ */
+class Log {
+public:
+    enum Level {
+        ERROR = LOG_LEVEL_ERROR,
+        WARN = LOG_LEVEL_WARN,
+        INFO = LOG_LEVEL_INFO,
+        DEBUG = LOG_LEVEL_DEBUG,
+    };
+
+    static constexpr size_t MAX_ARGS = 4;
+    static constexpr size_t NUM_RECORDS = 64;
+
+    struct Record {
+        const char *fmt;
+        hw::Time time;
+        uint8_t level;
+        uint8_t numArgs;
+        uint32_t args[MAX_ARGS];
+    };
+
+    template<typename ... Args>
+    static void write(Level level, const char *fmt, Args ... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "Too many log arguments");
+        const uint32_t packed[MAX_ARGS + 1] = { toArg(args)... };
+        push(level, fmt, packed, sizeof...(Args));
+    }
+
+    static size_t drain(BaseChannel *chp);
+
+protected:
+    template<typename T>
+    static uint32_t toArg(T value) {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                "Log arguments must be integers, enums, or pointers");
+        return uint32_t(value);
+    }
+
+    template<typename T>
+    static uint32_t toArg(T *value) {
+        return uint32_t(uintptr_t(value));
+    }
+
+    static void push(Level level, const char *fmt, const uint32_t *args, size_t numArgs);
+
+    static Record records[NUM_RECORDS];
+    static volatile size_t head;
+    static volatile size_t tail;
+    static volatile uint32_t dropped;
+};
+
+#endif /* LOG_H_ */
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef MIXER_H_
+#define MIXER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Fixed-point mixing matrix from control inputs, such as forward and turn
+ * commands, to motor outputs. Each output is a weighted sum of the inputs,
+ * clamped to its range, cut to zero within its deadband, and optionally
+ * inverted for motors wired backwards.
+ *
+ * Weights are Q12 and inputs saturate to 16 bits, so that they pack in pairs
+ * for the Cortex-M4 dual multiply-accumulate. Weights within MAX_WEIGHT keep
+ * the 32-bit sum from overflowing for any inputs.
+ */
+class Mixer {
+public:
+    static constexpr size_t MAX_INPUTS = 4;
+    static constexpr size_t MAX_OUTPUTS = 4;
+    static constexpr uint32_t WEIGHT_BITS = 12;
+    static constexpr int32_t ONE = 1 << WEIGHT_BITS;
+    static constexpr float MAX_WEIGHT = 4.f;
+
+    struct Output {
+        float weights[MAX_INPUTS];
+        int32_t range;      // clamped to [-range, range]
+        int32_t deadband;   // magnitudes up to this are cut to zero
+        bool inverted;
+    };
+
+    Mixer();
+
+    bool configure(size_t numInputs, const Output *outputs, size_t numOutputs);
+    void mix(const int32_t *inputs, int32_t *outputs) const;
+
+protected:
+    static constexpr size_t NUM_PAIRS = MAX_INPUTS / 2;
+
+    size_t numInputs;
+    size_t numOutputs;
+    // two Q12 weights per word, low half first, zero-padded
+    uint32_t weights[MAX_OUTPUTS][NUM_PAIRS];
+    int32_t ranges[MAX_OUTPUTS];
+    int32_t deadbands[MAX_OUTPUTS];
+    bool inverted[MAX_OUTPUTS];
+};
+
+static_assert(Mixer::MAX_INPUTS % 2 == 0, "Mixer inputs must pack in pairs");
+// worst case sum, plus the rounding half
+static_assert(int64_t(32767) * Mixer::MAX_INPUTS * int32_t(Mixer::MAX_WEIGHT * Mixer::ONE) + Mixer::ONE / 2
+        <= 0x7fffffff, "Mixer sum overflows 32 bits");
+static_assert(int32_t(Mixer::MAX_WEIGHT * Mixer::ONE) <= 32767, "Mixer weights overflow 16 bits");
+
+#endif /* MIXER_H_ */
@@ -0,0 +1,125 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef NOTCHTRACKER_H_
+#define NOTCHTRACKER_H_
+
+#include "Hw.h"
+#include "Biquad.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Finds the strongest vibration peaks in a stream of gyro samples and designs
+ * notch filters to follow them, for vibration whose frequency moves with
+ * weapon speed.
+ *
+ * The control thread pushes one sample per step into a pair of blocks. A
+ * low-priority thread analyzes each full block with a bank of Goertzel
+ * filters over a Hann window, picks the largest local maxima that stand out
+ * from the noise floor, refines them by parabolic interpolation, smooths them
+ * over time, and publishes a notch per peak. The control thread picks the notches up between
+ * steps. Neither side ever waits for the other: blocks the analysis hasn't
+ * caught up with are dropped, and settings and notches cross over through
+ * sequence counters, with torn reads retried on the next call.
+ *
+ * The sample rate is the control loop's, so anything above its Nyquist
+ * frequency shows up aliased, which is also where a notch has to go.
+ */
+class NotchTracker {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t NUM_BINS = 32;
+    static constexpr size_t MAX_NOTCHES = 2;
+    // a peak must exceed the median bin power, i.e. the noise floor, by this
+    // factor; the mean would let one strong peak hide the others
+    static constexpr float PEAK_RATIO = 10.f;
+    // weight of each new peak frequency against the tracked one
+    static constexpr float SMOOTHING = 0.3f;
+
+    struct Settings {
+        float sampleHz;
+        float minHz;
+        float maxHz;
+        float q;
+        size_t count; // number of notches, zero to turn off
+    };
+
+    NotchTracker();
+
+    void configure(const Settings &settings);
+    bool isEnabled() const {
+        return enabled;
+    }
+
+    void push(int32_t sample);
+    bool takeNotches(Biquad *notches);
+
+    bool analyze();
+
+    static NotchTracker *instance;
+    static void shellCommand(BaseChannel *chp, int argc, char *argv[]);
+
+protected:
+    // control thread side
+    bool enabled;
+    int16_t blocks[2][BLOCK_SIZE];
+    size_t writeBlock;
+    size_t fill;
+    uint32_t takenSequence;
+
+    // handed over between threads
+    volatile size_t readyBlock;
+    volatile bool blockReady;
+    Settings requested;
+    volatile uint32_t settingsSequence;
+    Biquad published[MAX_NOTCHES];
+    volatile uint32_t notchSequence;
+
+    // analysis thread side
+    uint32_t appliedSequence;
+    Settings settings;
+    float window[BLOCK_SIZE];
+    float windowSum;
+    float binHz[NUM_BINS];
+    float coeffs[NUM_BINS];
+    float centers[MAX_NOTCHES];
+
+    // latest spectrum, for the shell
+    hw::Mutex mutex;
+    float amplitudes[NUM_BINS];
+    float snapshotHz[NUM_BINS];
+    float snapshotCenters[MAX_NOTCHES];
+    size_t snapshotCount;
+
+    bool applySettings();
+    void spectrum(const int16_t *samples, float *power) const;
+    size_t findPeaks(const float *power, float *peaks) const;
+    void publish();
+};
+
+#endif /* NOTCHTRACKER_H_ */
@@ -0,0 +1,147 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#ifndef PARAMS_H_
+#define PARAMS_H_
+
+#include "Hw.h"
+#include "GainSchedule.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Tunable control parameters. Plain data so that it can be copied whole and
+ * persisted as-is.
+ */
+struct Config {
+    float kp;
+    float ki;
+    float kd;
+    float kff;              // feedforward from the rate set point
+    float setpointWeight;   // weight of the set point in the P term
+    float dFilterHz;        // derivative low-pass cut-off, zero to turn off
+    int32_t pidMeasuredPeriod; // scale I and D by the measured step period
+    int32_t inputLow;
+    int32_t inputHigh;
+    int32_t inputDeadband;
+    int32_t dcDeadband;
+    int32_t yawRate; // max commanded yaw rate in deg/s
+    // stick response curves, see Curve
+    float aileronExpo;
+    float aileronSuperRate;
+    float elevatorExpo;
+    float elevatorSuperRate;
+    // drive mixer weights from forward and turn commands, see Mixer
+    float mixLeftForward;
+    float mixLeftTurn;
+    float mixRightForward;
+    float mixRightTurn;
+    int32_t leftInvert;
+    int32_t rightInvert;
+    // gyro filters ahead of the controller, zero to turn off
+    float gyroLowPassHz;
+    float gyroNotchHz;
+    float gyroNotchQ;
+    // notches that follow the strongest gyro vibration peaks, see NotchTracker
+    int32_t dynNotchCount;
+    float dynNotchMinHz;
+    float dynNotchMaxHz;
+    float dynNotchQ;
+    // yaw rate estimate from a drive model and the gyro, see RateEstimator
+    int32_t rateEstimate;
+    float rateModelTau;
+    float rateModelGain;
+    float rateProcessSd;
+    float rateNoiseSd;
+    // heading hold on the aux switch, zero gain to turn off, see HeadingHold
+    float headingKp;
+    float headingMaxError;
+    // relay experiment of the yaw autotune, see Autotune
+    float autotuneRelay;        // fraction of full drive
+    int32_t autotuneHysteresis; // gyro units
+    // yaw gain scale at 25, 50, 75 and 100% weapon throttle, see GainSchedule
+    float gainScale[GainSchedule::NUM_POINTS - 1];
+};
+
+/**
+ * Typed table of named parameters backed by a double-buffered Config. The
+ * shell thread edits the inactive copy and marks it pending; the control
+ * thread swaps it in between steps, so a step never sees a half-written
+ * config.
+ */
+class Params {
+public:
+    enum Type {
+        TYPE_FLOAT,
+        TYPE_INT32,
+    };
+
+    struct Param {
+        const char *name;
+        Type type;
+        size_t offset;
+        float min;
+        float max;
+    };
+
+    // bump whenever the layout of Config changes, to invalidate stored copies
+    static constexpr uint8_t VERSION = 11;
+
+    static const Config defaults;
+    static const Param table[];
+    static const size_t NUM_PARAMS;
+
+    explicit Params(const Config &initial = defaults);
+
+    const Config &active() const {
+        return buffers[activeIndex];
+    }
+
+    bool update();
+
+    // for changes to several parameters that only make sense together
+    Config &beginEdit();
+    bool commitEdit();
+
+    const Param *find(const char *name) const;
+    float get(const Param &param) const;
+    bool set(const Param &param, float value);
+    bool load(const Config &config);
+
+    static bool validate(const Config &config);
+
+    static Params *instance;
+    static void shellCommand(BaseChannel *chp, int argc, char *argv[]);
+
+protected:
+    Config buffers[2];
+    volatile size_t activeIndex;
+    volatile bool pending;
+
+    static void print(BaseChannel *chp, const Param &param, float value);
+};
+
+#endif /* PARAMS_H_ */
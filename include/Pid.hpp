@@ -34,6 +34,12 @@
 //!				pidPRINT_DEBUG is set to 1).
 #define pidDEBUG_BUFF_SIZE		200
 
+//! @brief		Shortest and longest measured periods Run() accepts, relative to the
+//!				sample period. Periods outside are clamped, so that a stall doesn't dump
+//!				into the integral and back-to-back calls don't blow up the derivative.
+#define pidMIN_PERIOD_RATIO		0.25
+#define pidMAX_PERIOD_RATIO		4.0
+
 //===============================================================================================//
 //======================================== NAMESPACE ============================================//
 //===============================================================================================//
@@ -46,6 +52,8 @@
 #include <stdio.h>		// snprintf
 #endif
 
+#include <stdint.h>		// uint32_t
+
 namespace PidNs
 {
 	
@@ -99,6 +107,11 @@ namespace PidNs
 			//! @brief 		Computes new PID values
 			//! @details 	Call once per sampleTimeMs. Output is stored in the pidData structure.
 			void Run(dataType input);
+
+			//! @brief 		Computes new PID values, over a measured period
+			//! @details 	For loops with jitter or a variable rate. The I and D contributions
+			//!				are scaled to the time elapsed since the previous call.
+			void Run(dataType input, floatType periodMs);
 			
 			void SetOutputLimits(dataType min, dataType max);
 		
@@ -114,6 +127,21 @@ namespace PidNs
 			//! 			be adjusted on the fly during normal operation
 			void SetTunings(dataType kp, dataType ki, dataType kd);
 
+			//! @brief		Sets the feedforward gain, applied to the set-point directly.
+			//! @details	Lets the output respond to set-point changes without waiting for an
+			//!				error to build up. Zero (the default) disables it.
+			void SetFeedForward(dataType kff);
+
+			//! @brief		Sets the weight of the set-point in the proportional term.
+			//! @details	Below one, set-point steps kick the output less, leaving the response
+			//!				to the feedforward term; disturbances are rejected as before. One (the
+			//!				default) gives the plain error.
+			void SetSetpointWeight(dataType weight);
+
+			//! @brief		Low-pass filters the derivative term, which acts on the measurement.
+			//! @details	Zero or negative cut-off frequency (the default) disables filtering.
+			void SetDerivativeFilter(floatType cutoffHz);
+
 			dataType GetKp();
 
 			dataType GetKi();
@@ -126,6 +154,9 @@ namespace PidNs
 
 			dataType GetZd();
 
+			//! @brief		Returns the accumulated integral term
+			dataType GetITerm();
+
 			//! @brief		Prints debug information to the desired output
 			void PrintDebug(const char* msg);
 
@@ -137,6 +168,8 @@ namespace PidNs
 			dataType output;				
 		
 		private:
+			void Step(dataType input, dataType periodRatio);
+
 			//#if(pidPRINT_DEBUG == 1)
 				char debugBuff[pidDEBUG_BUFF_SIZE];
 			//#endif
@@ -158,6 +191,21 @@ namespace PidNs
 			
 			//! Actual (non-scaled) derivative constant
 			dataType actualKd;			
+
+			//! Actual (non-scaled) feedforward constant
+			dataType actualKff;
+
+			//! Feedforward constant, with the controller direction applied
+			dataType Zff;
+
+			//! Weight of the set-point in the proportional term
+			dataType setpointWeight;
+
+			//! Weight of the previous derivative term in the filtered one
+			dataType dFilter;
+
+			//! Time constant of the derivative filter, in milliseconds
+			floatType dFilterTauMs;
 			
 			//! Actual (non-scaled) proportional constant
 			dataType prevInput;			
@@ -179,6 +227,7 @@ namespace PidNs
 			dataType pTerm;				//!< The proportional term that is summed as part of the output (calculated in Pid_Run())
 			dataType iTerm;				//!< The integral term that is summed as part of the output (calculated in Pid_Run())
 			dataType dTerm;				//!< The derivative term that is summed as part of the output (calculated in Pid_Run())
+			dataType ffTerm;			//!< The feedforward term that is summed as part of the output (calculated in Pid_Run())
 			dataType outMin;				//!< The minimum output value. Anything lower will be limited to this floor.
 			dataType outMax;				//!< The maximum output value. Anything higher will be limited to this ceiling.	
 
@@ -212,23 +261,47 @@ namespace PidNs
 		this->setPoint = setPoint;
 		prevInput = 0;
 		prevOutput = 0;
+		numTimesRan = 0;
+
+		actualKff = 0;
+		Zff = 0;
+		setpointWeight = 1;
+		dFilter = 0;
+		dFilterTauMs = 0;
 
 		pTerm = floatType(0.0);
 		iTerm = floatType(0.0);
 		dTerm = floatType(0.0);
+		ffTerm = floatType(0.0);
 			
 	}
 
 	template <class dataType, class floatType> void Pid<dataType, floatType>::Run(dataType input)
+	{
+		Step(input, 1);
+	}
+
+	template <class dataType, class floatType> void Pid<dataType, floatType>::Run(dataType input, floatType periodMs)
+	{
+		floatType ratio = periodMs / samplePeriodMs;
+		// Written to also catch NaN
+		if(!(ratio >= floatType(pidMIN_PERIOD_RATIO)))
+			ratio = floatType(pidMIN_PERIOD_RATIO);
+		else if(ratio > floatType(pidMAX_PERIOD_RATIO))
+			ratio = floatType(pidMAX_PERIOD_RATIO);
+		Step(input, (dataType)ratio);
+	}
+
+	template <class dataType, class floatType> void Pid<dataType, floatType>::Step(dataType input, dataType periodRatio)
 	{
 		// Compute all the working error variables
 		//dataType input = *_input;
 		
 		error = setPoint - input;
 		
-		// Integral calcs
+		// Integral calcs, scaled by the period (exact for the nominal one)
 		
-		iTerm += (Zi * error);
+		iTerm += (Zi * periodRatio) * error;
 		// Perform min/max bound checking on integral term
 		if(iTerm > outMax) 
 			iTerm = outMax;
@@ -241,17 +314,32 @@ namespace PidNs
 		if(numTimesRan > 0)
 		{
 			inputChange = (input - prevInput);
-			dTerm = -Zd*inputChange;
+			const dataType zd = Zd / periodRatio;
+			if(dFilter == 0)
+			{
+				dTerm = -zd*inputChange;
+			}
+			else
+			{
+				dataType alpha = dFilter;
+				if(periodRatio != 1)
+					alpha = (dataType)(dFilterTauMs / (dFilterTauMs + samplePeriodMs*periodRatio));
+				dTerm = alpha*dTerm - (1 - alpha)*zd*inputChange;
+			}
 		}
 
+		// Proportional term on the weighted set-point, which the plain error is a special case of
+		pTerm = (setpointWeight == 1) ? Zp*error : Zp*(setpointWeight*setPoint - input);
+		ffTerm = Zff*setPoint;
+
 		// Compute PID Output. Value depends on outputMode
 		if(outputMode == DONT_ACCUMULATE_OUTPUT)
 		{
-			output = Zp*error + iTerm + dTerm;
+			output = pTerm + iTerm + dTerm + ffTerm;
 		}
 		else if(outputMode == ACCUMULATE_OUTPUT)
 		{
-			output = prevOutput + Zp*error + iTerm + dTerm;
+			output = prevOutput + pTerm + iTerm + dTerm + ffTerm;
 		}
 		
 		// Limit output
@@ -266,7 +354,7 @@ namespace PidNs
 		prevOutput = output;
 		  
 		// Increment the Run() counter.
-		if(numTimesRan < (2^(32))-1)
+		if(numTimesRan < UINT32_MAX)
 			numTimesRan++;
 	}
 
@@ -309,6 +397,37 @@ namespace PidNs
 		#endif
 	}
 
+	template <class dataType, class floatType> void Pid<dataType, floatType>::SetFeedForward(dataType kff)
+	{
+		if (kff<0)
+			return;
+
+		actualKff = kff;
+		Zff = (controllerDir == PID_REVERSE) ? (0 - kff) : kff;
+	}
+
+	template <class dataType, class floatType> void Pid<dataType, floatType>::SetSetpointWeight(dataType weight)
+	{
+		if (weight<0 || weight>1)
+			return;
+
+		setpointWeight = weight;
+	}
+
+	template <class dataType, class floatType> void Pid<dataType, floatType>::SetDerivativeFilter(floatType cutoffHz)
+	{
+		if (cutoffHz <= 0)
+		{
+			dFilter = 0;
+			dFilterTauMs = 0;
+			return;
+		}
+
+		// first-order low-pass, with time constant tau: tau / (tau + T)
+		dFilterTauMs = floatType(1000.0) / (floatType(2.0 * 3.14159265) * cutoffHz);
+		dFilter = (dataType)(dFilterTauMs / (dFilterTauMs + samplePeriodMs));
+	}
+
 	template <class dataType, class floatType> dataType Pid<dataType, floatType>::GetKp()
 	{
 		return actualKp;
@@ -339,6 +458,11 @@ namespace PidNs
 		return Zd;
 	}
 	
+	template <class dataType, class floatType> dataType Pid<dataType, floatType>::GetITerm()
+	{
+		return iTerm;
+	}
+	
 	template <class dataType, class floatType> void Pid<dataType, floatType>::SetSamplePeriod(floatType newSamplePeriodMs)
 	{
 	   if (newSamplePeriodMs > 0)
@@ -348,6 +472,8 @@ namespace PidNs
 	      Zi *= ratio;
 	      Zd /= ratio;
 	      samplePeriodMs = newSamplePeriodMs;
+	      if (dFilterTauMs > 0)
+	         dFilter = (dataType)(dFilterTauMs / (dFilterTauMs + samplePeriodMs));
 	   }
 	}
 
@@ -362,12 +488,13 @@ namespace PidNs
 
 	template <class dataType, class floatType> void Pid<dataType, floatType>::SetControllerDirection(ctrlDir_t controllerDir)
 	{
-		if(controllerDir != controllerDir)
+		if(controllerDir != this->controllerDir)
 		{
 	   		// Invert control constants
 			Zp = (0 - Zp);
 	    	Zi = (0 - Zi);
 	    	Zd = (0 - Zd);
+	    	Zff = (0 - Zff);
 		}   
 	   this->controllerDir = controllerDir;
 	}
@@ -375,8 +502,10 @@ namespace PidNs
 	template <class dataType, class floatType> void Pid<dataType, floatType>::PrintDebug(const char* msg)
 	{
 		// Support for multiple platforms
-		#if(__linux)
+		#if(pidPRINT_DEBUG == 1 && __linux)
 			printf("%s", (const char*)msg);
+		#else
+			(void)msg;
 		#endif
 	}
 
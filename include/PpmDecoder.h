@@ -0,0 +1,67 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef PPMDECODER_H_
+#define PPMDECODER_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Decodes a PPM pulse train from input captures. The receiver sends each
+ * channel as the time between rising edges, with a long low sync gap before
+ * the first one. The capture unit reports pulses as a low time followed by a
+ * high time, so the first channel arrives with the sync gap and the rest in
+ * pairs. Any width outside the valid range drops the frame.
+ */
+class PpmDecoder {
+public:
+    static constexpr size_t NUM_CHANNELS = 5;
+    static constexpr hw::IcuCount MIN_WIDTH = 800;
+    static constexpr hw::IcuCount MAX_WIDTH = 2200;
+    // low times longer than this start a frame
+    static constexpr hw::IcuCount SYNC_WIDTH = 5000;
+
+    PpmDecoder();
+
+    bool pulse(hw::IcuCount negativeWidth, hw::IcuCount positiveWidth);
+
+    const hw::IcuCount *getChannels() const {
+        return channels;
+    }
+
+protected:
+    hw::IcuCount channels[NUM_CHANNELS];
+    size_t current;
+
+    static bool validWidth(hw::IcuCount width) {
+        return width >= MIN_WIDTH && width <= MAX_WIDTH;
+    }
+};
+
+#endif /* PPMDECODER_H_ */
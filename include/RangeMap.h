@@ -0,0 +1,138 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef RANGEMAP_H_
+#define RANGEMAP_H_
+
+#include "IntMath.h"
+
+#include <stdint.h>
+#include <algorithm>
+
+/**
+ * Proportional map from one range to another with a centered deadband, giving
+ * the same results as HFCS::mapRanges() without a divide per call. Centers,
+ * scales, and a fixed-point reciprocal of the input scale are computed once,
+ * at compile time for constant ranges or whenever the ranges change.
+ *
+ * The input is clamped before scaling. Anything past the clamp maps beyond the
+ * end of the output range either way, so this doesn't change results, but it
+ * bounds the product so that it is exact within 64 bits (see the assertions
+ * below the class). Ranges outside those bounds are rejected by valid().
+ */
+class RangeMap {
+public:
+    // largest input range after cutting out the deadband, and output range
+    static constexpr int32_t MAX_IN_SCALE = 1 << 13;
+    static constexpr int32_t MAX_OUT_SCALE = 1 << 17;
+    // fraction bits of the reciprocal
+    static constexpr uint32_t SHIFT = 44;
+
+    /**
+     * Maps everything to zero.
+     */
+    constexpr RangeMap() :
+            RangeMap(-1, 1, 0, 0, 0) {
+    }
+
+    /**
+     * @param inLow input range lower bound
+     * @param inHigh input range upper bound
+     * @param outLow output range lower bound
+     * @param outHigh output range upper bound
+     * @param deadband distance from center of input range for which all input
+     *  values are mapped to the center of the output range
+     */
+    constexpr RangeMap(int32_t inLow, int32_t inHigh, int32_t outLow, int32_t outHigh, int32_t deadband) :
+            inCenter(center(inLow, inHigh)),
+            inMin(center(inLow, inHigh) - (inHigh - inLow - deadband)),
+            inMax(center(inLow, inHigh) + (inHigh - inLow - deadband)),
+            deadband(deadband),
+            outLow(outLow),
+            outHigh(outHigh),
+            outCenter(center(outLow, outHigh)),
+            outScale(outHigh - outLow),
+            multiplier(reciprocal(inHigh - inLow - 2 * deadband)),
+            inScale(inHigh - inLow - 2 * deadband) {
+    }
+
+    /**
+     * @return true if the ranges are within the bounds for which map() is
+     *  exact
+     */
+    constexpr bool valid() const {
+        return inScale > 0 && inScale <= MAX_IN_SCALE && deadband >= 0 && deadband <= MAX_IN_SCALE
+                && outLow <= outHigh && int64_t(outHigh) - outLow <= MAX_OUT_SCALE;
+    }
+
+    /**
+     * @param inValue input value to map
+     * @return mapped input value after adjusting for deadband, clamped to the
+     *  output range
+     */
+    int32_t map(int32_t inValue) const {
+        const int32_t centered = std::min(std::max(inValue, inMin), inMax) - inCenter;
+        // within [0, inScale], so the numerator is below 2^30
+        const uint32_t magnitude = std::max(-nabs(centered) - deadband, int32_t(0));
+        const int32_t scaled = int32_t((uint64_t(magnitude * outScale) * multiplier) >> SHIFT);
+        const int32_t outValue = outCenter + (centered < 0 ? -scaled : scaled);
+        return std::max(outLow, std::min(outHigh, outValue));
+    }
+
+protected:
+    int32_t inCenter;
+    int32_t inMin;
+    int32_t inMax;
+    int32_t deadband;
+    int32_t outLow;
+    int32_t outHigh;
+    int32_t outCenter;
+    uint32_t outScale;
+    uint64_t multiplier;
+    int32_t inScale;
+
+    // same as avg(), rounded towards zero
+    static constexpr int32_t center(int32_t low, int32_t high) {
+        return int32_t((int64_t(low) + high) / 2);
+    }
+
+    // 2^SHIFT / scale, rounded up; error is below one part in 2^SHIFT / scale
+    static constexpr uint64_t reciprocal(int32_t scale) {
+        return scale > 0 ? ((uint64_t(1) << SHIFT) + uint64_t(scale) - 1) / uint64_t(scale) : uint64_t(1) << SHIFT;
+    }
+};
+
+// n * m / 2^SHIFT rounds down to n / d as long as n times the reciprocal's
+// rounding error (less than d) stays below 2^SHIFT; n is at most d * outScale
+static_assert(uint64_t(RangeMap::MAX_IN_SCALE) * RangeMap::MAX_IN_SCALE * RangeMap::MAX_OUT_SCALE
+        <= uint64_t(1) << RangeMap::SHIFT, "Reciprocal too coarse for exact division");
+// n * m is at most outScale * 2^SHIFT + n
+static_assert((~uint64_t(0) - uint64_t(RangeMap::MAX_IN_SCALE) * RangeMap::MAX_OUT_SCALE) >> RangeMap::SHIFT
+        >= uint64_t(RangeMap::MAX_OUT_SCALE), "Scaled product overflows 64 bits");
+static_assert(uint64_t(RangeMap::MAX_IN_SCALE) * RangeMap::MAX_OUT_SCALE <= ~uint32_t(0),
+        "Numerator overflows 32 bits");
+
+#endif /* RANGEMAP_H_ */
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef RATEESTIMATOR_H_
+#define RATEESTIMATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Scalar Kalman filter for yaw rate. Predicts the rate from the differential
+ * drive with a first-order model, a lag towards gain times the drive, and
+ * corrects the prediction with each gyro reading. The model carries the
+ * estimate through gyro noise and through the step of latency between a drive
+ * command and its reading.
+ *
+ * Readings near gyro full scale may be clipped, so the estimate coasts on the
+ * model through them. Readings too far from the prediction to be noise are
+ * rejected; a run of them means either the gyro or the model is wrong, so the
+ * estimator flags a fault and restarts from the reading.
+ *
+ * Constant time per step, a few dozen floating-point operations.
+ */
+class RateEstimator {
+public:
+    // raw gyro readings beyond this, before bias correction and filtering,
+    // may be clipped
+    static constexpr int32_t SENSOR_LIMIT = 32000;
+    // readings beyond this many standard deviations from the prediction are
+    // rejected
+    static constexpr float GATE = 4.f;
+    // consecutive rejections before a fault
+    static constexpr size_t FAULT_STEPS = 20;
+
+    struct Model {
+        float tau;          // time constant of the rate response, in s
+        float gain;         // steady-state rate per unit of differential drive
+        float processSd;    // rate change per step the model doesn't explain
+        float noiseSd;      // gyro noise
+    };
+
+    RateEstimator();
+
+    void configure(const Model &model, float dt);
+    void reset();
+
+    float update(int32_t measured, int16_t raw);
+    void command(int32_t differential);
+
+    float getRate() const {
+        return rate;
+    }
+
+    bool isSaturated() const {
+        return saturated;
+    }
+
+    bool isFaulted() const {
+        return faulted;
+    }
+
+protected:
+    // model, discretized to the step
+    float decay;
+    float drive;
+    float processVariance;
+    float noiseVariance;
+
+    float rate;
+    float variance;
+    // drive applied since the last reading
+    int32_t differential;
+    bool started;
+    bool saturated;
+    bool faulted;
+    size_t rejections;
+};
+
+#endif /* RATEESTIMATOR_H_ */
@@ -26,45 +26,44 @@
 #ifndef VNH5050A_H_
 #define VNH5050A_H_
 
-#include "ch.h"
-#include "hal.h"
+#include "Hw.h"
 
 class VNH5050A {
 public:
     VNH5050A(
-            PWMDriver *pwmp,
-            pwmchannel_t channel,
-            GPIO_TypeDef *port1,
+            hw::Pwm *pwmp,
+            hw::PwmChannel channel,
+            hw::Port *port1,
             uint16_t pad1,
-            GPIO_TypeDef *port2,
+            hw::Port *port2,
             uint16_t pad2);
 
     void setSpeed(int32_t speed) {
         if (speed == 0) {
-            palSetPad(port1, pad1);
-            palSetPad(port2, pad2);
-            pwmEnableChannel(pwmp, channel, 0);
+            hw::setPad(port1, pad1);
+            hw::setPad(port2, pad2);
+            hw::pwmSet(pwmp, channel, 0);
         } else if (speed < 0) {
-            palClearPad(port1, pad1);
-            palSetPad(port2, pad2);
-            pwmEnableChannel(pwmp, channel, -speed);
+            hw::clearPad(port1, pad1);
+            hw::setPad(port2, pad2);
+            hw::pwmSet(pwmp, channel, -speed);
         } else {
-            palSetPad(port1, pad1);
-            palClearPad(port2, pad2);
-            pwmEnableChannel(pwmp, channel, speed);
+            hw::setPad(port1, pad1);
+            hw::clearPad(port2, pad2);
+            hw::pwmSet(pwmp, channel, speed);
         }
     }
 
-    pwmcnt_t getRange() {
-        return pwmp->period;
+    hw::PwmCount getRange() {
+        return hw::pwmPeriod(pwmp);
     }
 
 protected:
-    PWMDriver * const pwmp;
-    const pwmchannel_t channel;
-    GPIO_TypeDef * const port1;
+    hw::Pwm * const pwmp;
+    const hw::PwmChannel channel;
+    hw::Port * const port1;
     const uint16_t pad1;
-    GPIO_TypeDef * const port2;
+    hw::Port * const port2;
     const uint16_t pad2;
 };
 
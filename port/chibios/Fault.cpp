@@ -0,0 +1,116 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "ch.h"
+#include "hal.h"
+
+#include "HFCS.h"
+#include "EventLog.h"
+
+// exception frame sizes, without and with the lazily stacked FPU registers
+static constexpr size_t BASIC_FRAME_WORDS = 8;
+static constexpr size_t EXTENDED_FRAME_WORDS = 26;
+// EXC_RETURN bit that is clear when the frame holds the FPU registers
+static constexpr uint32_t EXC_RETURN_BASIC_FRAME = 1 << 4;
+// stacked xPSR bit set when a padding word realigned the frame
+static constexpr uint32_t PSR_STACK_ALIGNED = 1 << 9;
+
+/**
+ * Saves the fault state to backup SRAM. Called from the hard fault handler
+ * only, with the stacked exception frame.
+ *
+ * @param frame exception frame pushed by the core on fault entry
+ * @param excReturn EXC_RETURN value of the fault, which tells the frame size
+ */
+void EventLog::saveFault(const uint32_t *frame, uint32_t excReturn) {
+    hw::enableBackupRam();
+
+    Storage &s = storage();
+    FaultRecord &fault = s.fault;
+    fault.boot = s.boot;
+    fault.r0 = frame[0];
+    fault.r1 = frame[1];
+    fault.r2 = frame[2];
+    fault.r3 = frame[3];
+    fault.r12 = frame[4];
+    fault.lr = frame[5];
+    fault.pc = frame[6];
+    fault.psr = frame[7];
+    // the rest of the frame, if any, is floating point context
+    const size_t frameWords = (excReturn & EXC_RETURN_BASIC_FRAME) ? BASIC_FRAME_WORDS : EXTENDED_FRAME_WORDS;
+    const size_t paddingWords = (fault.psr & PSR_STACK_ALIGNED) ? 1 : 0;
+    fault.sp = uint32_t(uintptr_t(frame + frameWords + paddingWords));
+    fault.cfsr = SCB->CFSR;
+    fault.hfsr = SCB->HFSR;
+    fault.mmfar = SCB->MMFAR;
+    fault.bfar = SCB->BFAR;
+
+    // snapshot the stack above the exception frame without running off the
+    // end of whichever RAM it lives in
+    const uint32_t stackStart = fault.sp;
+    const uint32_t ramEnd = (stackStart >= CCM_RAM_BASE && stackStart < CCM_RAM_BASE + CCM_RAM_SIZE) ?
+            CCM_RAM_BASE + CCM_RAM_SIZE : MAIN_RAM_END;
+    const uint32_t *stack = reinterpret_cast<const uint32_t *>(stackStart);
+    for (size_t i = 0; i < STACK_WORDS; i++) {
+        fault.stack[i] = (stackStart + i * sizeof(uint32_t) < ramEnd) ? stack[i] : 0;
+    }
+    fault.valid = FAULT_VALID;
+
+    if (s.magic == MAGIC) {
+        log(EVENT_HARD_FAULT, fault.pc);
+    }
+}
+
+extern "C" {
+
+/**
+ * C half of the hard fault handler. Records the fault and resets.
+ *
+ * @param frame exception frame on whichever stack was active at the fault
+ * @param excReturn EXC_RETURN value from the link register on entry
+ */
+__attribute__((used, noreturn)) void hardFaultHandler(const uint32_t *frame, uint32_t excReturn) {
+    EventLog::saveFault(frame, excReturn);
+    NVIC_SystemReset();
+    while (true)
+        ;
+}
+
+/**
+ * Replaces the weak ChibiOS hard fault vector. Picks the stack the exception
+ * frame was pushed to from EXC_RETURN and hands both to the C handler.
+ */
+__attribute__((naked)) void HardFaultVector(void) {
+    asm volatile(
+            "tst lr, #4         \n"
+            "ite eq             \n"
+            "mrseq r0, msp      \n"
+            "mrsne r0, psp      \n"
+            "mov r1, lr         \n"
+            "b hardFaultHandler \n");
+}
+
+}
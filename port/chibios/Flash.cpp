@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#include "Flash.h"
+
+// FLASH_KEYR unlock sequence
+static constexpr uint32_t FLASH_KEY1 = 0x45670123;
+static constexpr uint32_t FLASH_KEY2 = 0xcdef89ab;
+
+// PGSERR | PGPERR | PGAERR | WRPERR | OPERR
+static constexpr uint32_t FLASH_SR_ERRORS = 0xf2;
+
+static void unlock() {
+    if (FLASH->CR & FLASH_CR_LOCK) {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+}
+
+static void lock() {
+    FLASH->CR = FLASH_CR_LOCK;
+}
+
+static bool waitDone() {
+    while (FLASH->SR & FLASH_SR_BSY)
+        ;
+    const bool ok = (FLASH->SR & FLASH_SR_ERRORS) == 0;
+    // error flags are cleared by writing ones
+    FLASH->SR = FLASH_SR_ERRORS | FLASH_SR_EOP;
+    return ok;
+}
+
+/**
+ * Flushes the ART data cache, which may hold contents from before an erase.
+ */
+static void resetDataCache() {
+    FLASH->ACR &= ~FLASH_ACR_DCEN;
+    FLASH->ACR |= FLASH_ACR_DCRST;
+    FLASH->ACR &= ~FLASH_ACR_DCRST;
+    FLASH->ACR |= FLASH_ACR_DCEN;
+}
+
+/**
+ * Erases a sector to all ones.
+ *
+ * @param sector sector number, as in the reference manual
+ * @param base mapped address of the sector, unused on hardware
+ * @param size size of the sector, unused on hardware
+ * @return false if the controller reported an error
+ */
+bool Flash::eraseSector(uint8_t sector, uint8_t *base, size_t size) {
+    (void) base;
+    (void) size;
+
+    unlock();
+    waitDone();
+    // x32 parallelism, valid for 2.7-3.6V supply
+    FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_SER | (uint32_t(sector) << 3);
+    FLASH->CR |= FLASH_CR_STRT;
+    const bool ok = waitDone();
+    lock();
+    resetDataCache();
+    return ok;
+}
+
+/**
+ * Programs words into erased flash.
+ *
+ * @param dst word-aligned destination in flash
+ * @param src words to program
+ * @param words number of words
+ * @return false if the controller reported an error
+ */
+bool Flash::program(uint8_t *dst, const uint32_t *src, size_t words) {
+    volatile uint32_t *p = reinterpret_cast<volatile uint32_t *>(dst);
+
+    unlock();
+    waitDone();
+    FLASH->CR = FLASH_CR_PSIZE_1 | FLASH_CR_PG;
+    bool ok = true;
+    for (size_t i = 0; i < words && ok; i++) {
+        p[i] = src[i];
+        ok = waitDone();
+    }
+    lock();
+    return ok;
+}
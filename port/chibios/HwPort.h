@@ -0,0 +1,211 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef HWPORT_H_
+#define HWPORT_H_
+
+#include "ch.h"
+#include "hal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ChibiOS/RT backend of the hardware interface described in Hw.h. Every call
+ * maps directly onto the kernel or HAL function it is named after.
+ */
+namespace hw {
+
+typedef systime_t Time;
+typedef msg_t Status;
+typedef ::Mutex Mutex;
+typedef GPIO_TypeDef Port;
+typedef PWMDriver Pwm;
+typedef pwmchannel_t PwmChannel;
+typedef pwmcnt_t PwmCount;
+typedef SPIDriver Spi;
+typedef I2CDriver I2c;
+typedef i2caddr_t I2cAddr;
+typedef ICUDriver Icu;
+typedef icucnt_t IcuCount;
+
+static constexpr Status OK = RDY_OK;
+static constexpr Status TIMEOUT = RDY_TIMEOUT;
+
+static constexpr uint32_t TICK_HZ = CH_FREQUENCY;
+
+constexpr Time msToTicks(uint32_t ms) {
+    return MS2ST(ms);
+}
+
+constexpr Time usToTicks(uint32_t us) {
+    return US2ST(us);
+}
+
+inline Time now() {
+    return chTimeNow();
+}
+
+inline void sleepUntil(Time time) {
+    chThdSleepUntil(time);
+}
+
+inline void sleepMs(uint32_t ms) {
+    chThdSleepMilliseconds(ms);
+}
+
+inline void setPad(Port *port, unsigned pad) {
+    palSetPad(port, pad);
+}
+
+inline void clearPad(Port *port, unsigned pad) {
+    palClearPad(port, pad);
+}
+
+inline void togglePad(Port *port, unsigned pad) {
+    palTogglePad(port, pad);
+}
+
+inline bool readPad(Port *port, unsigned pad) {
+    return palReadPad(port, pad) != PAL_LOW;
+}
+
+inline void pwmSet(Pwm *pwmp, PwmChannel channel, PwmCount width) {
+    pwmEnableChannel(pwmp, channel, width);
+}
+
+inline PwmCount pwmPeriod(const Pwm *pwmp) {
+    return pwmp->period;
+}
+
+inline uint16_t spiExchangeWord(Spi *spip, uint16_t tx) {
+    uint16_t rx;
+    spiAcquireBus(spip);
+    spiSelect(spip);
+    spiExchange(spip, 1, &tx, &rx);
+    spiUnselect(spip);
+    spiReleaseBus(spip);
+    return rx;
+}
+
+inline Status i2cTransfer(I2c *i2cp, I2cAddr addr, const uint8_t *tx, size_t txBytes, uint8_t *rx, size_t rxBytes,
+        Time timeout) {
+    i2cAcquireBus(i2cp);
+    const msg_t status = i2cMasterTransmitTimeout(i2cp, addr, tx, txBytes, rx, rxBytes, timeout);
+    i2cReleaseBus(i2cp);
+    return status;
+}
+
+inline void icuStartCapture(Icu *icup) {
+    icuEnable(icup);
+}
+
+inline IcuCount icuWidthI(Icu *icup) {
+    return icuGetWidthI(icup);
+}
+
+inline IcuCount icuPeriodI(Icu *icup) {
+    return icuGetPeriodI(icup);
+}
+
+inline uint32_t irqSave() {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+inline void irqRestore(uint32_t state) {
+    __set_PRIMASK(state);
+}
+
+inline void mutexInit(Mutex *mutex) {
+    chMtxInit(mutex);
+}
+
+inline void mutexLock(Mutex *mutex) {
+    chMtxLock(mutex);
+}
+
+inline void mutexUnlock(Mutex *mutex) {
+    (void) mutex; // ChibiOS unlocks the last mutex locked
+    chMtxUnlock();
+}
+
+inline void channelWrite(BaseChannel *chp, const uint8_t *data, size_t length) {
+    chIOWriteTimeout(chp, data, length, TIME_INFINITE);
+}
+
+inline void *backupRam() {
+    return reinterpret_cast<void *>(BKPSRAM_BASE);
+}
+
+/**
+ * Turns on the backup SRAM clock and regulator and unlocks writes to the
+ * backup domain. Safe to call repeatedly, including from the fault handler.
+ */
+inline void enableBackupRam() {
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+    PWR->CR |= PWR_CR_DBP;
+    RCC->AHB1ENR |= RCC_AHB1ENR_BKPSRAMEN;
+    PWR->CSR |= PWR_CSR_BRE;
+    while ((PWR->CSR & PWR_CSR_BRR) == 0)
+        ;
+}
+
+static constexpr char CYCLE_UNIT[] = "cycles";
+
+/**
+ * Starts the DWT cycle counter, which counts core clock cycles. Safe to call
+ * repeatedly.
+ */
+inline void startCycleCounter() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t cycleCount() {
+    return DWT->CYCCNT;
+}
+
+static constexpr uint32_t TIMESTAMP_HZ = STM32_HCLK;
+
+inline uint32_t timestamp() {
+    return DWT->CYCCNT;
+}
+
+/**
+ * Returns the causes of the last reset and clears them.
+ */
+inline uint32_t takeResetFlags() {
+    // reset flags live in the top byte of RCC_CSR and must be cleared manually
+    const uint32_t flags = RCC->CSR >> 24;
+    RCC->CSR |= RCC_CSR_RMVF;
+    return flags;
+}
+
+}
+
+#endif /* HWPORT_H_ */
@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "ch.h"
+#include "hal.h"
+
+#include "HFCS.h"
+#include "Peripherals.h"
+
+/**
+ * Starts the serial console and the motor, gyro, and receiver drivers. Driver
+ * configs are kept by reference, so they must be static.
+ */
+void Peripherals::start() {
+    // serial setup
+    static const SerialConfig dbgSerialConfig = { 115200, 0, USART_CR2_STOP1_BITS, USART_CR3_CTSE | USART_CR3_RTSE };
+    sdStart(&DBG_SERIAL, &dbgSerialConfig);
+
+    // VNH5050A PWM setup
+    static const PWMConfig dcPWMConfig = { STM32_TIMCLK1, DC_PWM_PERIOD, nullptr, {
+            { PWM_OUTPUT_ACTIVE_HIGH, nullptr },
+            { PWM_OUTPUT_DISABLED, nullptr },
+            { PWM_OUTPUT_DISABLED, nullptr },
+            { PWM_OUTPUT_ACTIVE_HIGH, nullptr } }, 0, };
+    pwmStart(&DC_PWM, &dcPWMConfig);
+
+    // A4960 PWM setup
+    static const PWMConfig mPWMConfig = { STM32_TIMCLK1, M1_PWM_PERIOD, nullptr, {
+            { PWM_OUTPUT_DISABLED, nullptr },
+            { PWM_OUTPUT_DISABLED, nullptr },
+            { PWM_OUTPUT_DISABLED, nullptr },
+            { PWM_OUTPUT_ACTIVE_HIGH, nullptr } }, 0, };
+    pwmStart(&M1_PWM, &mPWMConfig);
+
+    // SPI setup
+    // speed = pclk/8 = 5.25MHz
+    static const SPIConfig m1SPIConfig = { NULL, GPIOC, GPIOC_M1_NSS, SPI_CR1_DFF | SPI_CR1_BR_1 };
+    spiStart(&M1_SPI, &m1SPIConfig);
+
+    // input capture & high-res timer
+    static const ICUConfig icuConfig = { ICU_INPUT_ACTIVE_LOW, 1000000, HFCS::icuWidthCb, HFCS::icuPeriodCb };
+    icuStart(&PPM_ICU, &icuConfig);
+
+    // gyro I2C setup
+    static const I2CConfig i2cConfig = { OPMODE_I2C, 400000, FAST_DUTY_CYCLE_2 };
+    i2cStart(&GYRO_I2C, &i2cConfig);
+}
+
+/**
+ * Flight recorder memory, in otherwise unused CCM.
+ */
+uint8_t *Peripherals::blackboxMemory(size_t *size) {
+    *size = CCM_RAM_SIZE;
+    return reinterpret_cast<uint8_t *>(CCM_RAM_BASE);
+}
+
+/**
+ * Config store pages, in the last two flash sectors.
+ */
+ConfigStore::Page Peripherals::configPage(size_t index) {
+    const ConfigStore::Page pages[2] = {
+            { reinterpret_cast<uint8_t *>(CONFIG_FLASH_A_BASE), CONFIG_FLASH_SECTOR_SIZE, CONFIG_FLASH_A_SECTOR },
+            { reinterpret_cast<uint8_t *>(CONFIG_FLASH_B_BASE), CONFIG_FLASH_SECTOR_SIZE, CONFIG_FLASH_B_SECTOR } };
+    return pages[index];
+}
@@ -0,0 +1,78 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Flash.h"
+
+#include "Hw.h"
+
+#include <string.h>
+
+namespace hw {
+
+namespace mock {
+
+int32_t flashWordsLeft = -1;
+
+}
+
+}
+
+static bool powered() {
+    if (hw::mock::flashWordsLeft == 0) {
+        return false;
+    }
+    if (hw::mock::flashWordsLeft > 0) {
+        hw::mock::flashWordsLeft--;
+    }
+    return true;
+}
+
+/**
+ * Erases a simulated sector, which is just memory owned by the harness.
+ */
+bool Flash::eraseSector(uint8_t sector, uint8_t *base, size_t size) {
+    (void) sector;
+    if (!powered()) {
+        return false;
+    }
+    memset(base, 0xff, size);
+    return true;
+}
+
+/**
+ * Programs words like NOR flash, where bits can only be cleared, so writing
+ * over unerased data corrupts it the same way it would on the target.
+ */
+bool Flash::program(uint8_t *dst, const uint32_t *src, size_t words) {
+    uint32_t *p = reinterpret_cast<uint32_t *>(dst);
+    for (size_t i = 0; i < words; i++) {
+        if (!powered()) {
+            return false;
+        }
+        p[i] &= src[i];
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Hw.h"
+
+namespace hw {
+
+namespace mock {
+
+// inputs idle high, as the target's active-low inputs are pulled up
+Port gpioA = { 0, 0xffff };
+Port gpioB = { 0, 0xffff };
+Port gpioC = { 0, 0xffff };
+
+/**
+ * Delivers one captured input pulse, calling the width then the period
+ * callback like the ICU interrupt does.
+ *
+ * @param icup capture unit
+ * @param width active time of the pulse, in timer counts
+ * @param period time from this pulse's start to the next's, in timer counts
+ */
+void icuCapture(Icu *icup, IcuCount width, IcuCount period) {
+    if (!icup->enabled) {
+        return;
+    }
+    icup->width = width;
+    icup->period = period;
+    if (icup->widthCb != NULL) {
+        icup->widthCb(icup);
+    }
+    if (icup->periodCb != NULL) {
+        icup->periodCb(icup);
+    }
+}
+
+}
+
+}
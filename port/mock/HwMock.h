@@ -0,0 +1,161 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef HWMOCK_H_
+#define HWMOCK_H_
+
+#include "board.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Mock peripherals shared by the backends that don't run on the robot. The
+ * including HwPort.h defines hw::Time and hw::Status first. Peripherals are
+ * plain structs that a harness inspects and drives directly, and bus devices
+ * are modeled by callbacks.
+ */
+namespace hw {
+
+typedef uint32_t PwmChannel;
+typedef uint32_t PwmCount;
+typedef uint16_t I2cAddr;
+typedef uint32_t IcuCount;
+
+struct Port {
+    uint16_t out;
+    uint16_t in; // input levels, set by the harness
+};
+
+struct Pwm {
+    PwmCount period;
+    PwmCount widths[4];
+};
+
+struct Spi {
+    // device model, returns the word shifted out by the slave
+    uint16_t (*exchange)(Spi *spip, uint16_t tx);
+    void *device;
+};
+
+struct I2c {
+    // device model, returns OK or the bus error to report
+    Status (*transfer)(I2c *i2cp, I2cAddr addr, const uint8_t *tx, size_t txBytes, uint8_t *rx, size_t rxBytes);
+    void *device;
+};
+
+struct Icu;
+typedef void (*IcuCallback)(Icu *icup);
+
+struct Icu {
+    IcuCallback widthCb;
+    IcuCallback periodCb;
+    bool enabled;
+    IcuCount width;
+    IcuCount period;
+};
+
+namespace mock {
+
+extern Port gpioA;
+extern Port gpioB;
+extern Port gpioC;
+
+// flash words programmed before the flash mock acts as if power was cut,
+// failing this and every later operation; a sector erase counts as one word,
+// and a negative budget never runs out
+extern int32_t flashWordsLeft;
+
+void icuCapture(Icu *icup, IcuCount width, IcuCount period);
+
+}
+
+inline void setPad(Port *port, unsigned pad) {
+    port->out |= 1u << pad;
+}
+
+inline void clearPad(Port *port, unsigned pad) {
+    port->out &= ~(1u << pad);
+}
+
+inline void togglePad(Port *port, unsigned pad) {
+    port->out ^= 1u << pad;
+}
+
+inline bool readPad(Port *port, unsigned pad) {
+    return (port->in >> pad) & 1;
+}
+
+inline void pwmSet(Pwm *pwmp, PwmChannel channel, PwmCount width) {
+    pwmp->widths[channel] = width;
+}
+
+inline PwmCount pwmPeriod(const Pwm *pwmp) {
+    return pwmp->period;
+}
+
+inline uint16_t spiExchangeWord(Spi *spip, uint16_t tx) {
+    return spip->exchange != NULL ? spip->exchange(spip, tx) : 0;
+}
+
+inline Status i2cTransfer(I2c *i2cp, I2cAddr addr, const uint8_t *tx, size_t txBytes, uint8_t *rx, size_t rxBytes,
+        Time timeout) {
+    (void) timeout;
+    return i2cp->transfer != NULL ? i2cp->transfer(i2cp, addr, tx, txBytes, rx, rxBytes) : TIMEOUT;
+}
+
+inline void icuStartCapture(Icu *icup) {
+    icup->enabled = true;
+}
+
+inline IcuCount icuWidthI(Icu *icup) {
+    return icup->width;
+}
+
+inline IcuCount icuPeriodI(Icu *icup) {
+    return icup->period;
+}
+
+// benchmarks count nanoseconds of the host's clock instead of core cycles
+static constexpr char CYCLE_UNIT[] = "ns";
+
+inline void startCycleCounter() {
+}
+
+inline uint32_t cycleCount() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return uint32_t(now.tv_sec) * 1000000000u + uint32_t(now.tv_nsec);
+}
+
+}
+
+#define GPIOA (&hw::mock::gpioA)
+#define GPIOB (&hw::mock::gpioB)
+#define GPIOC (&hw::mock::gpioC)
+
+#endif /* HWMOCK_H_ */
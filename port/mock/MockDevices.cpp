@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "MockDevices.h"
+
+#define L3GD20_ADDR_SEL_LOW  (0x6a)
+#define L3GD20_ADDR_SEL_HIGH (0x6b)
+
+#define L3GD20_WHO_AM_I      (0x0F)
+#define L3GD20_OUT_TEMP      (0x26)
+#define L3GD20_STATUS_REG    (0x27)
+#define L3GD20_OUT_X_L       (0x28)
+#define L3GD20_OUT_Z_H       (0x2D)
+
+// msb of the subaddress asks for auto-increment
+#define L3GD20_AUTO_INCREMENT (0x80)
+
+MockL3GD20::MockL3GD20() :
+        rate { 0, 0, 0 }, temperature(25), failed(false), regs { } {
+}
+
+void MockL3GD20::attach(hw::I2c *i2cp) {
+    i2cp->transfer = transfer;
+    i2cp->device = this;
+}
+
+uint8_t MockL3GD20::read(uint8_t reg) const {
+    if (reg >= L3GD20_OUT_X_L && reg <= L3GD20_OUT_Z_H) {
+        const uint16_t value = rate[(reg - L3GD20_OUT_X_L) / 2];
+        return (reg & 1) ? value >> 8 : value & 0xff;
+    }
+    switch (reg) {
+    case L3GD20_WHO_AM_I:
+        return 0xd4;
+    case L3GD20_OUT_TEMP:
+        return temperature;
+    case L3GD20_STATUS_REG:
+        return 0x0f; // new data on all axes
+    default:
+        return reg < sizeof(regs) ? regs[reg] : 0;
+    }
+}
+
+hw::Status MockL3GD20::transfer(hw::I2c *i2cp, hw::I2cAddr addr, const uint8_t *tx, size_t txBytes, uint8_t *rx,
+        size_t rxBytes) {
+    MockL3GD20 * const gyro = static_cast<MockL3GD20 *>(i2cp->device);
+    if (gyro->failed || (addr != L3GD20_ADDR_SEL_LOW && addr != L3GD20_ADDR_SEL_HIGH) || txBytes == 0) {
+        return hw::TIMEOUT;
+    }
+
+    const bool increment = tx[0] & L3GD20_AUTO_INCREMENT;
+    uint8_t reg = tx[0] & ~L3GD20_AUTO_INCREMENT;
+    for (size_t i = 1; i < txBytes; i++) {
+        if (reg < sizeof(gyro->regs)) {
+            gyro->regs[reg] = tx[i];
+        }
+        reg += increment;
+    }
+    for (size_t i = 0; i < rxBytes; i++) {
+        rx[i] = gyro->read(reg);
+        reg += increment;
+    }
+    return hw::OK;
+}
+
+MockA4960::MockA4960() :
+        regs { }, fault(false) {
+}
+
+MockA4960::MockA4960(hw::Spi *spip) :
+        MockA4960() {
+    attach(spip);
+}
+
+void MockA4960::attach(hw::Spi *spip) {
+    spip->exchange = exchange;
+    spip->device = this;
+}
+
+uint16_t MockA4960::exchange(hw::Spi *spip, uint16_t tx) {
+    MockA4960 * const driver = static_cast<MockA4960 *>(spip->device);
+    const size_t addr = tx >> 13;
+    if (tx & 0x1000) {
+        driver->regs[addr] = tx & 0xfff;
+        // writes shift out the diagnostic register, with FF in the msb
+        return driver->fault ? 0x8000 : 0;
+    }
+    return driver->regs[addr];
+}
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef MOCKDEVICES_H_
+#define MOCKDEVICES_H_
+
+#include "Hw.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * L3GD20 model for a mock I2C bus: a register file whose output registers
+ * read back the rates set by the harness, in raw counts.
+ */
+class MockL3GD20 {
+public:
+    MockL3GD20();
+
+    void attach(hw::I2c *i2cp);
+
+    int16_t rate[3];
+    int8_t temperature;
+    // bus stops acknowledging, as with a loose connector
+    bool failed;
+
+protected:
+    uint8_t regs[0x40];
+
+    uint8_t read(uint8_t reg) const;
+
+    static hw::Status transfer(hw::I2c *i2cp, hw::I2cAddr addr, const uint8_t *tx, size_t txBytes, uint8_t *rx,
+            size_t rxBytes);
+};
+
+/**
+ * A4960 model for a mock SPI bus: keeps written registers and answers with the
+ * diagnostic word, whose fault flag the harness sets.
+ */
+class MockA4960 {
+public:
+    MockA4960();
+    explicit MockA4960(hw::Spi *spip);
+
+    void attach(hw::Spi *spip);
+
+    uint16_t regs[8];
+    bool fault;
+
+protected:
+    static uint16_t exchange(hw::Spi *spip, uint16_t tx);
+};
+
+#endif /* MOCKDEVICES_H_ */
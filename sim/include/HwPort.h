@@ -0,0 +1,132 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef HWPORT_H_
+#define HWPORT_H_
+
+#include "ch.h"
+#include "hal.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Simulator backend of the hardware interface described in Hw.h. Threads,
+ * time, and the serial console come from the ChibiOS/RT POSIX port, so
+ * main() runs unchanged; the motor, gyro, and receiver peripherals are the
+ * mocks of HwMock.h, driven by the scenario runner in sim/src.
+ *
+ * The kernel is cooperative in the simulator and the "interrupts" are
+ * delivered by the scenario thread, so critical sections only need to keep
+ * out other threads, which a thread that doesn't call into the kernel
+ * already does.
+ */
+namespace hw {
+
+typedef systime_t Time;
+typedef msg_t Status;
+typedef ::Mutex Mutex;
+
+static constexpr Status OK = RDY_OK;
+static constexpr Status TIMEOUT = RDY_TIMEOUT;
+
+}
+
+#include "HwMock.h"
+
+namespace hw {
+
+static constexpr uint32_t TICK_HZ = CH_FREQUENCY;
+
+constexpr Time msToTicks(uint32_t ms) {
+    return MS2ST(ms);
+}
+
+constexpr Time usToTicks(uint32_t us) {
+    return US2ST(us);
+}
+
+inline Time now() {
+    return chTimeNow();
+}
+
+inline void sleepUntil(Time time) {
+    chThdSleepUntil(time);
+}
+
+inline void sleepMs(uint32_t ms) {
+    chThdSleepMilliseconds(ms);
+}
+
+// timestamps follow the simulated clock, so that runs don't depend on the host
+static constexpr uint32_t TIMESTAMP_HZ = 1000000;
+
+inline uint32_t timestamp() {
+    return uint32_t(now()) * (TIMESTAMP_HZ / TICK_HZ);
+}
+
+inline uint32_t irqSave() {
+    return 0;
+}
+
+inline void irqRestore(uint32_t state) {
+    (void) state;
+}
+
+inline void mutexInit(Mutex *mutex) {
+    chMtxInit(mutex);
+}
+
+inline void mutexLock(Mutex *mutex) {
+    chMtxLock(mutex);
+}
+
+inline void mutexUnlock(Mutex *mutex) {
+    (void) mutex; // ChibiOS unlocks the last mutex locked
+    chMtxUnlock();
+}
+
+inline void channelWrite(BaseChannel *chp, const uint8_t *data, size_t length) {
+    chIOWriteTimeout(chp, data, length, TIME_INFINITE);
+}
+
+void *backupRam();
+void enableBackupRam();
+uint32_t takeResetFlags();
+
+}
+
+// the drivers named in HFCS.h
+extern hw::Pwm PWMD1;
+extern hw::Pwm PWMD3;
+extern hw::Spi SPID2;
+extern hw::Icu ICUD2;
+extern hw::I2c I2CD1;
+
+// the console is the simulator's first serial port, on TCP port 29001
+#define SD6 SD1
+
+#endif /* HWPORT_H_ */
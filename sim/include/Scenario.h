@@ -0,0 +1,93 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef SCENARIO_H_
+#define SCENARIO_H_
+
+#include "Hw.h"
+#include "HFCS.h"
+#include "MockDevices.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Scripted stimulus for the simulator. A scenario is a text file of commands,
+ * one per line, run in order by a thread just below the control loop's
+ * priority, so that the loop has already stepped when a command looks at the
+ * outputs of the same tick:
+ *
+ *   wait <ms>                          let the firmware run
+ *   ppm <ch0> <ch1> <ch2> <ch3> <ch4>  send a receiver frame every 20 ms, in us
+ *   ppm off                            stop sending frames
+ *   gyro <x> <y> <z>                   set the rates, in raw counts
+ *   gyro fail | gyro ok                stop or resume answering on the bus
+ *   temp <celsius>                     set the gyro temperature
+ *   diag 0|1                           release or assert the A4960 DIAG pin
+ *   button 0|1                         release or press the user button
+ *   expect armed 0|1                   check the receiver failsafe state
+ *   expect left|right|weapon <lo> <hi> check a motor output, in percent
+ *   print                              print the inputs and outputs
+ *   end                                exit, as does the end of the file
+ *
+ * Blank lines and lines starting with '#' are skipped. The process exits with
+ * the number of failed expectations as its status.
+ */
+class Scenario {
+public:
+    static MockL3GD20 gyro;
+    static MockA4960 m1Driver;
+
+    static void start(const char *path);
+
+protected:
+    static constexpr size_t NUM_CHANNELS = 5;
+    static constexpr size_t MAX_ARGS = 8;
+    static constexpr uint32_t PPM_FRAME_MS = 20;
+    // low time before the first channel that marks the start of a frame
+    static constexpr hw::IcuCount PPM_SYNC_US = 6000;
+
+    static FILE *file;
+    static const char *path;
+    static size_t lineNumber;
+    static uint32_t failures;
+
+    static volatile bool ppmEnabled;
+    static hw::IcuCount ppmChannels[NUM_CHANNELS];
+
+    NORETURN static void threadScript(void *arg);
+    NORETURN static void threadPpm(void *arg);
+
+    static void run(size_t argc, char *argv[]);
+    static void expect(size_t argc, char *argv[]);
+    static int32_t motorOutput(const char *name, bool *found);
+    static void print();
+    static void fail(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+    NORETURN static void finish();
+};
+
+#endif /* SCENARIO_H_ */
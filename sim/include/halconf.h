@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#ifndef SIM_HALCONF_H_
+#define SIM_HALCONF_H_
+
+/*
+ * HAL settings for the simulator. Only the serial driver is real; the motor,
+ * gyro, and receiver peripherals are mocks (see sim/include/HwPort.h).
+ */
+
+#define HAL_USE_TM                  FALSE
+#define HAL_USE_PAL                 FALSE
+#define HAL_USE_ADC                 FALSE
+#define HAL_USE_CAN                 FALSE
+#define HAL_USE_EXT                 FALSE
+#define HAL_USE_GPT                 FALSE
+#define HAL_USE_I2C                 FALSE
+#define HAL_USE_ICU                 FALSE
+#define HAL_USE_MAC                 FALSE
+#define HAL_USE_MMC_SPI             FALSE
+#define HAL_USE_PWM                 FALSE
+#define HAL_USE_RTC                 FALSE
+#define HAL_USE_SDC                 FALSE
+#define HAL_USE_SERIAL              TRUE
+#define HAL_USE_SERIAL_USB          FALSE
+#define HAL_USE_SPI                 FALSE
+#define HAL_USE_UART                FALSE
+#define HAL_USE_USB                 FALSE
+
+#define SERIAL_DEFAULT_BITRATE      115200
+
+// large enough that a log burst never blocks a simulated thread on the socket
+#define SERIAL_BUFFERS_SIZE         4096
+
+#endif /* SIM_HALCONF_H_ */
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "ch.h"
+#include "hal.h"
+
+#include "HFCS.h"
+#include "Peripherals.h"
+#include "Scenario.h"
+
+#include <stdlib.h>
+
+// STM32_TIMCLK1 on the robot, so PWM ranges match
+static constexpr uint32_t TIMER_CLOCK = 84000000;
+
+static uint8_t blackboxRam[CCM_RAM_SIZE];
+
+// word-aligned like the flash sectors they stand in for
+static uint32_t configFlash[2][CONFIG_FLASH_SECTOR_SIZE / sizeof(uint32_t)];
+
+/**
+ * Starts the serial console, connects the device models to the mock buses,
+ * and starts the scenario named by the HFCS_SCENARIO environment variable.
+ */
+void Peripherals::start() {
+    sdStart(&DBG_SERIAL, NULL);
+
+    DC_PWM.period = TIMER_CLOCK / DC_PWM_FREQ;
+    M1_PWM.period = TIMER_CLOCK / M1_PWM_FREQ;
+
+    Scenario::m1Driver.attach(&M1_SPI);
+    Scenario::gyro.attach(&GYRO_I2C);
+
+    PPM_ICU.widthCb = HFCS::icuWidthCb;
+    PPM_ICU.periodCb = HFCS::icuPeriodCb;
+
+    Scenario::start(getenv("HFCS_SCENARIO"));
+}
+
+uint8_t *Peripherals::blackboxMemory(size_t *size) {
+    *size = sizeof(blackboxRam);
+    return blackboxRam;
+}
+
+/**
+ * Config store pages in RAM, so every run starts with an unformatted store.
+ */
+ConfigStore::Page Peripherals::configPage(size_t index) {
+    const ConfigStore::Page page = {
+            reinterpret_cast<uint8_t *>(configFlash[index]), sizeof(configFlash[index]), uint8_t(index) };
+    return page;
+}
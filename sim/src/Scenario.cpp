@@ -0,0 +1,238 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "ch.h"
+#include "hal.h"
+
+#include "Scenario.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+// stdio needs much more stack than the firmware's threads
+static WORKING_AREA(waScript, 16384);
+static WORKING_AREA(waPpm, 2048);
+
+FILE *Scenario::file = NULL;
+const char *Scenario::path = NULL;
+size_t Scenario::lineNumber = 0;
+uint32_t Scenario::failures = 0;
+
+MockL3GD20 Scenario::gyro;
+MockA4960 Scenario::m1Driver;
+
+volatile bool Scenario::ppmEnabled = false;
+hw::IcuCount Scenario::ppmChannels[NUM_CHANNELS] = { };
+
+/**
+ * Opens a scenario and starts running it, along with the receiver model. With
+ * no scenario the firmware runs idle until killed, for use from the shell.
+ *
+ * @param scenarioPath scenario file, or NULL
+ */
+void Scenario::start(const char *scenarioPath) {
+    chThdCreateStatic(waPpm, sizeof(waPpm), HIGHPRIO, tfunc_t(threadPpm), nullptr);
+    if (scenarioPath == NULL) {
+        return;
+    }
+
+    path = scenarioPath;
+    file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        exit(EXIT_FAILURE);
+    }
+    chThdCreateStatic(waScript, sizeof(waScript), NORMALPRIO - 1, tfunc_t(threadScript), nullptr);
+}
+
+/**
+ * Receiver model, sending a PPM frame every PPM_FRAME_MS like the real one.
+ * Frames arrive as input captures in the order HFCS::newPulse() decodes them:
+ * the sync gap with the first channel, then the other channels in pairs.
+ */
+void Scenario::threadPpm(void *arg) {
+    (void) arg;
+    chRegSetThreadName("sim ppm");
+    hw::Time next = hw::now();
+    while (TRUE) {
+        if (ppmEnabled) {
+            const hw::IcuCount * const ch = ppmChannels;
+            hw::mock::icuCapture(&PPM_ICU, PPM_SYNC_US, PPM_SYNC_US + ch[0]);
+            hw::mock::icuCapture(&PPM_ICU, ch[1], ch[1] + ch[2]);
+            hw::mock::icuCapture(&PPM_ICU, ch[3], ch[3] + ch[4]);
+        }
+        next += hw::msToTicks(PPM_FRAME_MS);
+        hw::sleepUntil(next);
+    }
+    chThdExit(0);
+}
+
+void Scenario::threadScript(void *arg) {
+    (void) arg;
+    chRegSetThreadName("sim script");
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *argv[MAX_ARGS];
+        size_t argc = 0;
+        for (char *token = strtok(line, " \t\r\n"); token != NULL && argc < MAX_ARGS;
+                token = strtok(NULL, " \t\r\n")) {
+            argv[argc++] = token;
+        }
+        if (argc == 0 || argv[0][0] == '#') {
+            continue;
+        }
+        run(argc, argv);
+    }
+    finish();
+}
+
+void Scenario::run(size_t argc, char *argv[]) {
+    const char * const command = argv[0];
+    if (strcmp(command, "wait") == 0 && argc == 2) {
+        hw::sleepMs(strtoul(argv[1], NULL, 0));
+    } else if (strcmp(command, "ppm") == 0 && argc == 2 && strcmp(argv[1], "off") == 0) {
+        ppmEnabled = false;
+    } else if (strcmp(command, "ppm") == 0 && argc == 1 + NUM_CHANNELS) {
+        for (size_t i = 0; i < NUM_CHANNELS; i++) {
+            ppmChannels[i] = strtoul(argv[1 + i], NULL, 0);
+        }
+        ppmEnabled = true;
+    } else if (strcmp(command, "gyro") == 0 && argc == 2) {
+        gyro.failed = strcmp(argv[1], "fail") == 0;
+    } else if (strcmp(command, "gyro") == 0 && argc == 4) {
+        for (size_t i = 0; i < 3; i++) {
+            gyro.rate[i] = strtol(argv[1 + i], NULL, 0);
+        }
+    } else if (strcmp(command, "temp") == 0 && argc == 2) {
+        gyro.temperature = strtol(argv[1], NULL, 0);
+    } else if (strcmp(command, "diag") == 0 && argc == 2) {
+        // DIAG is active low
+        m1Driver.fault = strtol(argv[1], NULL, 0) != 0;
+        if (m1Driver.fault) {
+            GPIOC->in &= ~(1u << GPIOC_M1_DIAG);
+        } else {
+            GPIOC->in |= 1u << GPIOC_M1_DIAG;
+        }
+    } else if (strcmp(command, "button") == 0 && argc == 2) {
+        // the button pulls its input low
+        if (strtol(argv[1], NULL, 0) != 0) {
+            GPIOC->in &= ~(1u << GPIOC_BUT1);
+        } else {
+            GPIOC->in |= 1u << GPIOC_BUT1;
+        }
+    } else if (strcmp(command, "expect") == 0) {
+        expect(argc, argv);
+    } else if (strcmp(command, "print") == 0 && argc == 1) {
+        print();
+    } else if (strcmp(command, "end") == 0 && argc == 1) {
+        finish();
+    } else {
+        fprintf(stderr, "%s:%u: bad command %s\n", path, unsigned(lineNumber), command);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// the script may run before main() has constructed the controller
+static bool armed() {
+    return HFCS::instance != NULL && HFCS::instance->isArmed();
+}
+
+void Scenario::expect(size_t argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "armed") == 0) {
+        const bool expected = strtol(argv[2], NULL, 0) != 0;
+        if (armed() != expected) {
+            fail("expected armed %d", expected);
+        }
+        return;
+    }
+
+    bool found = false;
+    const int32_t output = argc == 4 ? motorOutput(argv[1], &found) : 0;
+    if (!found) {
+        fprintf(stderr, "%s:%u: bad expectation\n", path, unsigned(lineNumber));
+        exit(EXIT_FAILURE);
+    }
+    const int32_t low = strtol(argv[2], NULL, 0);
+    const int32_t high = strtol(argv[3], NULL, 0);
+    if (output < low || output > high) {
+        fail("expected %s in [%d, %d], got %d", argv[1], int(low), int(high), int(output));
+    }
+}
+
+/**
+ * Reads back a motor output from the PWM and direction pins, as a percentage
+ * of full scale. Drive outputs are negative in reverse.
+ *
+ * @param name left, right, or weapon
+ * @param found set to false for an unknown name
+ * @return motor output in percent
+ */
+int32_t Scenario::motorOutput(const char *name, bool *found) {
+    *found = true;
+    if (strcmp(name, "weapon") == 0) {
+        return int32_t(M1_PWM.widths[M1_PWM_CHAN] * 100 / M1_PWM.period);
+    }
+
+    // VNH5050A::setSpeed() clears the first pad to reverse
+    int32_t output;
+    bool reverse;
+    if (strcmp(name, "left") == 0) {
+        output = DC_PWM.widths[DC_PWM_AB_CHAN] * 100 / DC_PWM.period;
+        reverse = (GPIOC->out & (1u << GPIOC_MTR_A)) == 0;
+    } else if (strcmp(name, "right") == 0) {
+        output = DC_PWM.widths[DC_PWM_XY_CHAN] * 100 / DC_PWM.period;
+        reverse = (GPIOA->out & (1u << GPIOA_MTR_X)) == 0;
+    } else {
+        *found = false;
+        return 0;
+    }
+    return reverse ? -output : output;
+}
+
+void Scenario::print() {
+    bool found;
+    printf("[%6u ms] armed %d left %d right %d weapon %d\n", unsigned(hw::now() * 1000 / hw::TICK_HZ),
+            armed(), int(motorOutput("left", &found)), int(motorOutput("right", &found)),
+            int(motorOutput("weapon", &found)));
+}
+
+void Scenario::fail(const char *fmt, ...) {
+    failures++;
+    printf("[%6u ms] %s:%u: FAIL: ", unsigned(hw::now() * 1000 / hw::TICK_HZ), path, unsigned(lineNumber));
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+}
+
+void Scenario::finish() {
+    printf("%s: %u failed expectations\n", path, unsigned(failures));
+    fflush(stdout);
+    exit(failures);
+}
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "ch.h"
+#include "hal.h"
+
+/*
+ * Replaces the POSIX platform's hal_lld.c, whose system tick follows the wall
+ * clock, with one on virtual time.
+ */
+
+/**
+ * Low level HAL driver initialization.
+ */
+void hal_lld_init(void) {
+}
+
+/**
+ * Interrupt sources simulation, polled by the port whenever no thread is
+ * ready. Pending serial traffic is serviced first; otherwise every thread is
+ * waiting, so the clock skips straight to the next tick instead of waiting
+ * for it. Simulations then run as fast as the host allows, and identically
+ * every time.
+ */
+void ChkIntSources(void) {
+#if HAL_USE_SERIAL
+    if (sd_lld_interrupt_pending()) {
+        dbg_check_lock();
+        if (chSchIsPreemptionRequired()) {
+            chSchDoReschedule();
+        }
+        dbg_check_unlock();
+        return;
+    }
+#endif
+
+    CH_IRQ_PROLOGUE();
+
+    chSysLockFromIsr();
+    chSysTimerHandlerI();
+    chSysUnlockFromIsr();
+
+    CH_IRQ_EPILOGUE();
+
+    dbg_check_lock();
+    if (chSchIsPreemptionRequired()) {
+        chSchDoReschedule();
+    }
+    dbg_check_unlock();
+}
@@ -23,12 +23,11 @@
  *  in this Software without prior written authorization from Xo Wang.
  */
 
-#include "ch.h"
-#include "hal.h"
+#include "Hw.h"
 
 #include "HFCS.h"
 #include "A4960.h"
-#include "chprintf.h"
+#include "Log.h"
 
 #include <stdint.h>
 
@@ -44,36 +43,22 @@ const uint16_t A4960::config[8] = {
         // auto BEMF hyst, 3.2us zx det window, no stop on fail, DIAG pin = fault, restart on loss of sync, brake off, forward, coast
 };
 
-A4960::A4960(SPIDriver *spip, PWMDriver *pwmp, pwmchannel_t channel) :
+A4960::A4960(hw::Spi *spip, hw::Pwm *pwmp, hw::PwmChannel channel) :
         spip(spip), pwmp(pwmp), channel(channel) {
     for (size_t addr = 0; addr < 8U; addr++) {
         uint16_t diag = writeReg(addr, config[addr]);
-        chprintf((BaseChannel *) &DBG_SERIAL, "[%d] 0x%x: 0x%x\r\n", channel, addr, diag);
-        chThdSleepMilliseconds(1);
+        LOG_INFO("A4960 [%d] 0x%x: 0x%x", channel, addr, diag);
+        hw::sleepMs(1);
     }
-    pwmEnableChannel(pwmp, channel, 0);
+    hw::pwmSet(pwmp, channel, 0);
 }
 
 uint16_t A4960::writeReg(const uint8_t addr, const uint16_t data) {
     const uint16_t txData = (uint16_t(addr & 0x7) << 13) | 0x1000 | (data & 0xfff);
-    uint16_t rxData;
-    spiAcquireBus(spip);
-    spiSelect(spip);
-    spiExchange(spip, 1, &txData, &rxData);
-    spiUnselect(spip);
-    spiReleaseBus(spip);
-
-    return rxData;
+    return hw::spiExchangeWord(spip, txData);
 }
 
 uint16_t A4960::readReg(const uint8_t addr) {
     const uint16_t txData = (uint16_t(addr & 0x7) << 13);
-    uint16_t rxData;
-    spiAcquireBus(spip);
-    spiSelect(spip);
-    spiExchange(spip, 1, &txData, &rxData);
-    spiUnselect(spip);
-    spiReleaseBus(spip);
-
-    return rxData;
+    return hw::spiExchangeWord(spip, txData);
 }
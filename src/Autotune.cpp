@@ -0,0 +1,254 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Autotune.h"
+#include "Format.h"
+#include "Params.h"
+#include "chprintf.h"
+
+#include <math.h>
+#include <string.h>
+
+static constexpr float PI = 3.14159265f;
+
+Autotune *Autotune::instance = NULL;
+
+Autotune::Autotune() :
+        requested(false),
+        state(IDLE),
+        result { },
+        relay(0),
+        hysteresis(0),
+        maxSteps(0),
+        dt(0.f),
+        scale(1.f),
+        output(0),
+        steps(0),
+        lastRise(0),
+        cycles(0),
+        high(0.f),
+        low(0.f),
+        measured(0),
+        periodSum(0.f),
+        amplitudeSum(0.f),
+        lastPeriod(0.f),
+        lastAmplitude(0.f) {
+    instance = this;
+}
+
+/**
+ * Clears and returns a pending request from the shell or stick command.
+ */
+bool Autotune::takeRequest() {
+    if (!requested) {
+        return false;
+    }
+    requested = false;
+    return true;
+}
+
+/**
+ * Starts the experiment. The relay starts out turning towards positive rates.
+ *
+ * @param relay turn output of the relay
+ * @param hysteresis rate the relay has to be past to switch, above the noise
+ * @param maxSteps steps before giving up on a steady oscillation
+ * @param dt time between steps, in s
+ * @param scale gain schedule scale at the weapon command the experiment runs at
+ */
+void Autotune::start(int32_t relay, int32_t hysteresis, size_t maxSteps, float dt, float scale) {
+    this->relay = relay;
+    this->hysteresis = hysteresis;
+    this->maxSteps = maxSteps;
+    this->dt = dt;
+    this->scale = scale;
+    output = relay;
+    steps = 0;
+    lastRise = 0;
+    cycles = 0;
+    high = 0.f;
+    low = 0.f;
+    measured = 0;
+    periodSum = 0.f;
+    amplitudeSum = 0.f;
+    lastPeriod = 0.f;
+    lastAmplitude = 0.f;
+    state = RUNNING;
+}
+
+/**
+ * Abandons a running experiment, keeping the last result.
+ */
+void Autotune::stop() {
+    if (state == RUNNING) {
+        state = IDLE;
+    }
+    output = 0;
+}
+
+/**
+ * Runs the relay for one step.
+ *
+ * @param rate measured yaw rate
+ * @return turn output, zero once the experiment has ended
+ */
+int32_t Autotune::step(float rate) {
+    if (state != RUNNING) {
+        return 0;
+    }
+    if (++steps > maxSteps) {
+        state = FAILED;
+        output = 0;
+        return 0;
+    }
+
+    if (rate > high) {
+        high = rate;
+    }
+    if (rate < low) {
+        low = rate;
+    }
+
+    // the relay opposes the rate, as the PID it stands in for does; a cycle
+    // runs from one switch to positive output to the next
+    if (output < 0 && rate < -hysteresis) {
+        output = relay;
+        if (lastRise != 0) {
+            cycle(steps - lastRise, (high - low) / 2);
+        }
+        lastRise = steps;
+        high = rate;
+        low = rate;
+    } else if (output > 0 && rate > hysteresis) {
+        output = -relay;
+    }
+    return state == RUNNING ? output : 0;
+}
+
+void Autotune::cycle(size_t period, float amplitude) {
+    if (++cycles <= SKIP_CYCLES) {
+        return;
+    }
+    measured++;
+    periodSum += period;
+    amplitudeSum += amplitude;
+    if (measured < MEASURE_CYCLES) {
+        return;
+    }
+
+    const float meanPeriod = periodSum / measured;
+    const float meanAmplitude = amplitudeSum / measured;
+    measured = 0;
+    periodSum = 0.f;
+    amplitudeSum = 0.f;
+    if (fabsf(meanPeriod - lastPeriod) <= TOLERANCE * meanPeriod
+            && fabsf(meanAmplitude - lastAmplitude) <= TOLERANCE * meanAmplitude) {
+        finish((meanPeriod + lastPeriod) / 2, (meanAmplitude + lastAmplitude) / 2);
+        return;
+    }
+    lastPeriod = meanPeriod;
+    lastAmplitude = meanAmplitude;
+}
+
+/**
+ * @param period mean period, in steps
+ * @param amplitude mean rate amplitude
+ */
+void Autotune::finish(float period, float amplitude) {
+    output = 0;
+    if (amplitude <= hysteresis) {
+        state = FAILED;
+        return;
+    }
+
+    const float ku = 4 * relay / (PI * sqrtf(amplitude * amplitude - float(hysteresis) * hysteresis));
+    const float tu = period * dt;
+    result.ultimateGain = ku;
+    result.ultimatePeriod = tu;
+    result.amplitude = amplitude;
+    result.kp = 0.6f * ku;
+    result.ki = 1.2f * ku / tu;
+    result.kd = 0.075f * ku * tu;
+    result.scale = scale;
+    COMPILER_BARRIER();
+    state = DONE;
+}
+
+static void printValue(BaseChannel *chp, const char *name, float value) {
+    chprintf(chp, "%s = ", name);
+    printFixed(chp, value, 6);
+    chprintf(chp, "\r\n");
+}
+
+void Autotune::shellCommand(BaseChannel *chp, int argc, char *argv[]) {
+    Autotune * const autotune = instance;
+    if (argc == 1 && strcmp(argv[0], "start") == 0) {
+        autotune->request();
+        chprintf(chp, "autotune requested, starts in gyro mode once the sticks are centered\r\n");
+        return;
+    }
+
+    if (argc == 1 && strcmp(argv[0], "keep") == 0) {
+        if (autotune->state != DONE) {
+            chprintf(chp, "error: no autotune result\r\n");
+            return;
+        }
+        // one edit, so the control thread never runs a mix of old and new
+        // gains; gains far outside the parameter ranges point at a failed
+        // experiment
+        Params * const params = Params::instance;
+        Config &config = params->beginEdit();
+        // the config holds the idle weapon gains that the schedule scales, as
+        // GainSchedule::retune() does with the result
+        const Result &result = autotune->result;
+        config.kp = result.kp / result.scale;
+        config.ki = result.ki / result.scale;
+        config.kd = result.kd / result.scale;
+        if (!params->commitEdit()) {
+            chprintf(chp, "error: gains out of range\r\n");
+            return;
+        }
+        chprintf(chp, "gains kept, save with config save\r\n");
+        return;
+    }
+
+    if (argc == 0) {
+        static const char * const names[] = { "idle", "running", "done", "failed" };
+        chprintf(chp, "autotune %s\r\n", names[autotune->state]);
+        if (autotune->state == DONE) {
+            printValue(chp, "ultimate_gain", autotune->result.ultimateGain);
+            printValue(chp, "ultimate_period", autotune->result.ultimatePeriod);
+            printValue(chp, "amplitude", autotune->result.amplitude);
+            printValue(chp, "kp", autotune->result.kp);
+            printValue(chp, "ki", autotune->result.ki);
+            printValue(chp, "kd", autotune->result.kd);
+            printValue(chp, "gain_scale", autotune->result.scale);
+        }
+        return;
+    }
+
+    chprintf(chp, "Usage: autotune [start | keep]\r\n");
+}
@@ -0,0 +1,396 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Hw.h"
+
+#include "Bench.h"
+#include "Biquad.h"
+#include "Curve.h"
+#include "Format.h"
+#include "HFCS.h"
+#include "IntMath.h"
+#include "Mixer.h"
+#include "Pid.hpp"
+#include "PpmDecoder.h"
+#include "RangeMap.h"
+#include "chprintf.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr size_t NUM_INPUTS = 64;
+static constexpr int32_t DC_RANGE = 4941;
+
+// checksums end up here so that the compiler can't drop the calls
+static volatile int32_t sink;
+
+/**
+ * Hides a value from the optimizer, so that calls can't be hoisted out of the
+ * loop or vectorized across iterations.
+ */
+static inline int32_t opaque(int32_t value) {
+    asm volatile("" : "+r"(value));
+    return value;
+}
+
+/**
+ * Pseudo-random stick widths, some inside the deadband, and signed values
+ * spanning the whole int32_t range. Generated once with a fixed seed.
+ */
+static int32_t sticks[NUM_INPUTS];
+static int32_t values[NUM_INPUTS];
+
+static void makeInputs() {
+    static bool made = false;
+    if (made) {
+        return;
+    }
+    uint32_t state = 1;
+    for (size_t i = 0; i < NUM_INPUTS; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        sticks[i] = 1200 + state % 601;
+        values[i] = int32_t(state);
+    }
+    made = true;
+}
+
+static int32_t benchLoop(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(values[i % NUM_INPUTS]);
+    }
+    return sum;
+}
+
+static int32_t benchNabs(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(nabs(opaque(values[i % NUM_INPUTS])));
+    }
+    return sum;
+}
+
+static int32_t benchNabsBranch(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        const int32_t value = opaque(values[i % NUM_INPUTS]);
+        sum += opaque(value < 0 ? value : -value);
+    }
+    return sum;
+}
+
+static int32_t benchAvg(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(avg(opaque(values[i % NUM_INPUTS]), opaque(values[(i + 1) % NUM_INPUTS])));
+    }
+    return sum;
+}
+
+static int32_t benchSignum(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(signum(opaque(values[i % NUM_INPUTS])));
+    }
+    return sum;
+}
+
+static int32_t benchMapRanges(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(HFCS::mapRanges(1200, 1800, opaque(sticks[i % NUM_INPUTS]), -DC_RANGE, DC_RANGE, 17));
+    }
+    return sum;
+}
+
+/**
+ * mapRanges() in single-precision float, as a candidate replacement.
+ */
+static int32_t mapRangesFloat(int32_t inLow, int32_t inHigh, int32_t inValue, int32_t outLow, int32_t outHigh,
+        int32_t deadband) {
+    const float centered = inValue - (inLow + inHigh) * 0.5f;
+    float cut = 0.f;
+    if (centered > deadband) {
+        cut = centered - deadband;
+    } else if (centered < -deadband) {
+        cut = centered + deadband;
+    }
+    const float scale = float(outHigh - outLow) / float(inHigh - inLow - 2 * deadband);
+    const float out = cut * scale + (outLow + outHigh) * 0.5f;
+    return out < outLow ? outLow : out > outHigh ? outHigh : int32_t(out);
+}
+
+static int32_t benchMapRangesFloat(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(mapRangesFloat(1200, 1800, opaque(sticks[i % NUM_INPUTS]), -DC_RANGE, DC_RANGE, 17));
+    }
+    return sum;
+}
+
+static int32_t benchRangeMap(uint32_t calls) {
+    // built from opaque values, as the loop builds its maps from the config
+    const RangeMap rangeMap(opaque(1200), opaque(1800), opaque(-DC_RANGE), opaque(DC_RANGE), opaque(17));
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(rangeMap.map(opaque(sticks[i % NUM_INPUTS])));
+    }
+    return sum;
+}
+
+static int32_t benchCurve(uint32_t calls) {
+    const Curve curve(opaque(50) / 100.f, opaque(50) / 100.f, opaque(DC_RANGE));
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        sum += opaque(curve.apply(opaque(values[i % NUM_INPUTS] % (DC_RANGE + 1))));
+    }
+    return sum;
+}
+
+static int32_t benchBiquadFloat(uint32_t calls) {
+    BiquadBank<3, 2> bank;
+    bank.setStage(0, Biquad::lowPass(40.f, 200.f));
+    bank.setStage(1, Biquad::notch(60.f, 200.f, 2.f));
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        float rates[3] = { float(opaque(values[i % NUM_INPUTS] >> 16)), float(opaque(values[(i + 1) % NUM_INPUTS] >> 16)),
+                float(opaque(values[(i + 2) % NUM_INPUTS] >> 16)) };
+        bank.process(rates, rates);
+        sum += opaque(int32_t(rates[2]));
+    }
+    return sum;
+}
+
+static int32_t benchBiquadFixed(uint32_t calls) {
+    FixedBiquadBank<3, 2> bank;
+    bank.setStage(0, Biquad::lowPass(40.f, 200.f));
+    bank.setStage(1, Biquad::notch(60.f, 200.f, 2.f));
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        int32_t rates[3] = { opaque(values[i % NUM_INPUTS] >> 16), opaque(values[(i + 1) % NUM_INPUTS] >> 16),
+                opaque(values[(i + 2) % NUM_INPUTS] >> 16) };
+        bank.process(rates, rates);
+        sum += opaque(rates[2]);
+    }
+    return sum;
+}
+
+static int32_t benchPid(uint32_t calls) {
+    PidNs::Pid<float, float> pid;
+    pid.Init(0.25f, 0.01f, 0.001f, PidNs::Pid<float>::PID_DIRECT, PidNs::Pid<float>::DONT_ACCUMULATE_OUTPUT,
+            HFCS::LOOP_DELAY_US / 1000.f, -DC_RANGE, DC_RANGE, 0.f);
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        pid.setPoint = opaque(sticks[i % NUM_INPUTS]) - 1500;
+        pid.Run(opaque(sticks[(i + 7) % NUM_INPUTS]) - 1500);
+        sum += opaque(int32_t(pid.output));
+    }
+    return sum;
+}
+
+/**
+ * Decodes whole frames; one call is one captured pulse.
+ */
+static int32_t benchPpm(uint32_t calls) {
+    PpmDecoder decoder;
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        const size_t k = i % NUM_INPUTS;
+        const hw::IcuCount low = i % 3 == 0 ? 6000 : opaque(sticks[k]);
+        if (decoder.pulse(low, opaque(sticks[(k + 1) % NUM_INPUTS]))) {
+            sum += decoder.getChannels()[PpmDecoder::NUM_CHANNELS - 1];
+        }
+    }
+    return sum;
+}
+
+/**
+ * The differential drive mix that HFCS hard-coded before Mixer, with the
+ * output deadband, as the baseline for the mixer.
+ */
+static void mixDrive(int32_t forward, int32_t turn, int32_t range, int32_t deadband, int32_t *left, int32_t *right) {
+    *left = std::min(std::max(forward + turn, -range), range);
+    *right = std::min(std::max(forward - turn, -range), range);
+    *left = nabs(*left) < -deadband ? *left : 0;
+    *right = nabs(*right) < -deadband ? *right : 0;
+}
+
+static int32_t benchMixDrive(uint32_t calls) {
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        int32_t left;
+        int32_t right;
+        mixDrive(opaque(values[i % NUM_INPUTS] >> 18), opaque(values[(i + 1) % NUM_INPUTS] >> 18), DC_RANGE, 10,
+                &left, &right);
+        sum += opaque(left) + opaque(right);
+    }
+    return sum;
+}
+
+static int32_t benchMixer(uint32_t calls) {
+    const Mixer::Output outputs[] = {
+            { { 1.f, 1.f }, DC_RANGE, 10, false },
+            { { 1.f, -1.f }, DC_RANGE, 10, false },
+    };
+    Mixer mixer;
+    mixer.configure(2, outputs, 2);
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < calls; i++) {
+        const int32_t inputs[] = { opaque(values[i % NUM_INPUTS] >> 18), opaque(values[(i + 1) % NUM_INPUTS] >> 18) };
+        int32_t mix[2];
+        mixer.mix(inputs, mix);
+        sum += opaque(mix[0]) + opaque(mix[1]);
+    }
+    return sum;
+}
+
+const Bench::Case Bench::cases[] = {
+        { "loop", benchLoop },
+        { "nabs", benchNabs },
+        { "nabs_branch", benchNabsBranch },
+        { "avg", benchAvg },
+        { "signum", benchSignum },
+        { "map_ranges", benchMapRanges },
+        { "map_ranges_float", benchMapRangesFloat },
+        { "range_map", benchRangeMap },
+        { "curve", benchCurve },
+        { "pid_run", benchPid },
+        { "ppm_pulse", benchPpm },
+        { "mix_drive", benchMixDrive },
+        { "mixer", benchMixer },
+        { "biquad_float", benchBiquadFloat },
+        { "biquad_fixed", benchBiquadFixed },
+};
+
+const size_t Bench::NUM_CASES = sizeof(cases) / sizeof(cases[0]);
+
+const Bench::Case *Bench::find(const char *name) {
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        if (strcmp(cases[i].name, name) == 0) {
+            return &cases[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Times one case, after a warm-up run to fill caches.
+ *
+ * @param benchCase case to run
+ * @param calls calls per run
+ * @param runs number of runs, at most MAX_RUNS
+ * @return per-call statistics over the runs
+ */
+Bench::Result Bench::measure(const Case &benchCase, uint32_t calls, size_t runs) {
+    makeInputs();
+    hw::startCycleCounter();
+    sink = benchCase.run(calls);
+
+    uint32_t totals[MAX_RUNS] = { };
+    for (size_t r = 0; r < runs; r++) {
+        const uint32_t start = hw::cycleCount();
+        sink = benchCase.run(calls);
+        totals[r] = hw::cycleCount() - start;
+    }
+
+    // runs are few, so insertion sort will do
+    for (size_t r = 1; r < runs; r++) {
+        const uint32_t total = totals[r];
+        size_t j = r;
+        for (; j > 0 && totals[j - 1] > total; j--) {
+            totals[j] = totals[j - 1];
+        }
+        totals[j] = total;
+    }
+
+    float mean = 0.f;
+    for (size_t r = 0; r < runs; r++) {
+        mean += float(totals[r]) / calls;
+    }
+    mean /= runs;
+    float variance = 0.f;
+    for (size_t r = 0; r < runs; r++) {
+        const float error = float(totals[r]) / calls - mean;
+        variance += error * error;
+    }
+    variance = runs > 1 ? variance / (runs - 1) : 0.f;
+
+    Result result;
+    result.name = benchCase.name;
+    result.calls = calls;
+    result.runs = runs;
+    result.min = float(totals[0]) / calls;
+    result.median = (runs % 2 != 0 ? float(totals[runs / 2]) : (float(totals[runs / 2 - 1]) + totals[runs / 2]) / 2)
+            / calls;
+    result.mean = mean;
+    result.stddev = sqrtf(variance);
+    return result;
+}
+
+void Bench::printHeader(BaseChannel *chp) {
+    chprintf(chp, "bench,name,calls,runs,unit,min,median,mean,stddev\r\n");
+}
+
+void Bench::print(BaseChannel *chp, const Result &result) {
+    chprintf(chp, "bench,%s,%u,%u,%s", result.name, result.calls, result.runs, hw::CYCLE_UNIT);
+    const float values[] = { result.min, result.median, result.mean, result.stddev };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        chprintf(chp, ",");
+        printFixed(chp, values[i], 2);
+    }
+    chprintf(chp, "\r\n");
+}
+
+void Bench::shellCommand(BaseChannel *chp, int argc, char *argv[]) {
+    if (argc > 2 || (argc >= 1 && strcmp(argv[0], "all") != 0 && find(argv[0]) == NULL)) {
+        chprintf(chp, "Usage: bench [all|<case>] [calls]\r\ncases:");
+        for (size_t i = 0; i < NUM_CASES; i++) {
+            chprintf(chp, " %s", cases[i].name);
+        }
+        chprintf(chp, "\r\n");
+        return;
+    }
+    if (HFCS::instance != NULL && HFCS::instance->isArmed()) {
+        chprintf(chp, "error: disarm first\r\n");
+        return;
+    }
+
+    const uint32_t calls = argc == 2 ? strtoul(argv[1], NULL, 0) : DEFAULT_CALLS;
+    if (calls == 0) {
+        chprintf(chp, "error: invalid number of calls\r\n");
+        return;
+    }
+    printHeader(chp);
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        if (argc == 0 || strcmp(argv[0], "all") == 0 || strcmp(argv[0], cases[i].name) == 0) {
+            print(chp, measure(cases[i], calls, DEFAULT_RUNS));
+        }
+    }
+}
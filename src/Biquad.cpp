@@ -0,0 +1,119 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Biquad.h"
+
+#include <math.h>
+
+static constexpr float PI = 3.14159265f;
+
+static bool validFrequency(float hz, float sampleHz) {
+    return hz > 0.f && hz < sampleHz / 2;
+}
+
+Biquad Biquad::passThrough() {
+    const Biquad coeffs = { 1.f, 0.f, 0.f, 0.f, 0.f };
+    return coeffs;
+}
+
+/**
+ * Second-order low-pass; Butterworth at the default Q.
+ *
+ * @param cutoffHz -3 dB frequency at the default Q
+ * @param sampleHz sample rate
+ * @param q quality factor; higher peaks at the cutoff
+ */
+Biquad Biquad::lowPass(float cutoffHz, float sampleHz, float q) {
+    if (!validFrequency(cutoffHz, sampleHz) || !(q > 0.f)) {
+        return passThrough();
+    }
+    const float w0 = 2 * PI * cutoffHz / sampleHz;
+    const float cosw = cosf(w0);
+    const float alpha = sinf(w0) / (2 * q);
+    const float a0 = 1 + alpha;
+    const Biquad coeffs = {
+            (1 - cosw) / 2 / a0,
+            (1 - cosw) / a0,
+            (1 - cosw) / 2 / a0,
+            -2 * cosw / a0,
+            (1 - alpha) / a0 };
+    return coeffs;
+}
+
+/**
+ * Band-reject with unity gain away from the center.
+ *
+ * @param centerHz rejected frequency
+ * @param sampleHz sample rate
+ * @param q center frequency over -3 dB bandwidth; higher is narrower
+ */
+Biquad Biquad::notch(float centerHz, float sampleHz, float q) {
+    if (!validFrequency(centerHz, sampleHz) || !(q > 0.f)) {
+        return passThrough();
+    }
+    const float w0 = 2 * PI * centerHz / sampleHz;
+    const float cosw = cosf(w0);
+    const float alpha = sinf(w0) / (2 * q);
+    const float a0 = 1 + alpha;
+    const Biquad coeffs = {
+            1 / a0,
+            -2 * cosw / a0,
+            1 / a0,
+            -2 * cosw / a0,
+            (1 - alpha) / a0 };
+    return coeffs;
+}
+
+/**
+ * Differentiator rolled off by a second-order low-pass, as the analog
+ * s w^2 / (s^2 + s w / q + w^2). This is the band-pass design scaled by w q,
+ * with w prewarped so that the low-frequency gain is the derivative per
+ * second of the input.
+ *
+ * @param cutoffHz frequency above which the derivative is attenuated
+ * @param sampleHz sample rate
+ * @param q quality factor of the roll-off
+ */
+Biquad Biquad::derivativeLowPass(float cutoffHz, float sampleHz, float q) {
+    if (!validFrequency(cutoffHz, sampleHz) || !(q > 0.f)) {
+        const Biquad difference = { sampleHz, -sampleHz, 0.f, 0.f, 0.f };
+        return difference;
+    }
+    const float w0 = 2 * PI * cutoffHz / sampleHz;
+    const float cosw = cosf(w0);
+    const float alpha = sinf(w0) / (2 * q);
+    const float a0 = 1 + alpha;
+    // analog frequency that the bilinear transform maps to w0
+    const float warped = 2 * sampleHz * tanf(w0 / 2);
+    const float gain = warped * q;
+    const Biquad coeffs = {
+            gain * alpha / a0,
+            0.f,
+            -gain * alpha / a0,
+            -2 * cosw / a0,
+            (1 - alpha) / a0 };
+    return coeffs;
+}
@@ -0,0 +1,262 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#include "Hw.h"
+
+#include "Blackbox.h"
+#include "chprintf.h"
+
+#include <string.h>
+
+Blackbox *Blackbox::instance = NULL;
+
+static const char * const triggerNames[] = { "none", "failsafe", "m1 fault", "gyro fault", "button", "command" };
+
+static inline uint32_t zigzag(int32_t i) {
+    return (uint32_t(i) << 1) ^ uint32_t(i >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u) {
+    return int32_t(u >> 1) ^ -int32_t(u & 1);
+}
+
+static inline uint8_t *putVarint(uint8_t *p, uint32_t u) {
+    while (u >= 0x80) {
+        *p++ = uint8_t(u) | 0x80;
+        u >>= 7;
+    }
+    *p++ = uint8_t(u);
+    return p;
+}
+
+// returns NULL if the varint runs past end
+static inline const uint8_t *getVarint(const uint8_t *p, const uint8_t *end, uint32_t *u) {
+    uint32_t result = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (p >= end) {
+            return NULL;
+        }
+        const uint8_t byte = *p++;
+        result |= uint32_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    *u = result;
+    return p;
+}
+
+Blackbox::Blackbox(uint8_t *storage, size_t size) :
+                storage(storage),
+                numBlocks(size / BLOCK_SIZE),
+                block(0),
+                wrapped(false),
+                prev { },
+                reason(TRIGGER_NONE),
+                postTrigger(0),
+                frozen(false),
+                rearmRequested(false) {
+    // CCM is not cleared by the startup code
+    reset();
+    instance = this;
+}
+
+void Blackbox::reset() {
+    block = 0;
+    wrapped = false;
+    postTrigger = 0;
+    reason = TRIGGER_NONE;
+    startBlock(0);
+}
+
+void Blackbox::startBlock(size_t i) {
+    BlockHeader * const header = reinterpret_cast<BlockHeader *>(blockAt(i));
+    header->count = 0;
+    header->length = 0;
+    // each block decodes against an all-zero reference
+    memset(&prev, 0, sizeof(prev));
+}
+
+/**
+ * Appends a sample to the ring. Must only be called from the control thread.
+ *
+ * @param sample values of all fields for this control step
+ */
+void Blackbox::record(const Sample &sample) {
+    if (rearmRequested) {
+        reset();
+        frozen = false;
+        rearmRequested = false;
+    }
+
+    if (frozen) {
+        return;
+    }
+
+    if (reason != TRIGGER_NONE) {
+        if (postTrigger == 0) {
+            frozen = true;
+            return;
+        }
+        postTrigger--;
+    }
+
+    BlockHeader *header = reinterpret_cast<BlockHeader *>(blockAt(block));
+    if (sizeof(BlockHeader) + header->length + MAX_RECORD_SIZE > BLOCK_SIZE) {
+        block++;
+        if (block >= numBlocks) {
+            block = 0;
+            wrapped = true;
+        }
+        startBlock(block);
+        header = reinterpret_cast<BlockHeader *>(blockAt(block));
+    }
+
+    uint8_t * const start = blockAt(block) + sizeof(BlockHeader) + header->length;
+    uint32_t mask = 0;
+    uint32_t deltas[NUM_FIELDS];
+    size_t numDeltas = 0;
+    for (size_t i = 0; i < NUM_FIELDS; i++) {
+        const int32_t delta = sample.field[i] - prev.field[i];
+        if (delta != 0) {
+            mask |= 1U << i;
+            deltas[numDeltas++] = zigzag(delta);
+        }
+    }
+
+    uint8_t *p = putVarint(start, mask);
+    for (size_t i = 0; i < numDeltas; i++) {
+        p = putVarint(p, deltas[i]);
+    }
+
+    header->length += p - start;
+    header->count++;
+    prev = sample;
+}
+
+/**
+ * Stops the recording after a short post-trigger window. Only the first
+ * trigger after arming is kept. Safe to call from any thread.
+ *
+ * @param why cause of the trigger, saved in the dump header
+ */
+void Blackbox::trigger(Trigger why) {
+    if (reason != TRIGGER_NONE || frozen) {
+        return;
+    }
+    postTrigger = POST_TRIGGER_SAMPLES;
+    reason = why;
+}
+
+/**
+ * Discards the current recording and starts over on the next control step.
+ */
+void Blackbox::rearm() {
+    rearmRequested = true;
+}
+
+/**
+ * Writes the recording in binary to a channel, oldest block first. Only
+ * meaningful once the recording is frozen.
+ *
+ * @param chp channel to write to
+ */
+void Blackbox::dump(BaseChannel *chp) const {
+    const size_t first = wrapped ? (block + 1) % numBlocks : 0;
+    const size_t count = wrapped ? numBlocks : block + 1;
+
+    DumpHeader dumpHeader;
+    dumpHeader.magic = DUMP_MAGIC;
+    dumpHeader.version = DUMP_VERSION;
+    dumpHeader.numFields = NUM_FIELDS;
+    dumpHeader.trigger = reason;
+    dumpHeader.reserved = 0;
+    dumpHeader.blockSize = BLOCK_SIZE;
+    dumpHeader.numBlocks = count;
+    dumpHeader.tickFrequency = hw::TICK_HZ;
+    hw::channelWrite(chp, reinterpret_cast<const uint8_t *>(&dumpHeader), sizeof(dumpHeader));
+
+    for (size_t i = 0; i < count; i++) {
+        hw::channelWrite(chp, blockAt((first + i) % numBlocks), BLOCK_SIZE);
+    }
+}
+
+/**
+ * Decodes the samples stored in one block of a dump. Decoding never reads past
+ * the block, and stops at the first sample that doesn't fit in the length the
+ * header gives, so a corrupt block yields at most its intact samples.
+ *
+ * @param block start of a block, including its header, BLOCK_SIZE bytes
+ * @param samples output array
+ * @param maxSamples capacity of output array
+ * @return number of samples decoded
+ */
+size_t Blackbox::decodeBlock(const uint8_t *block, Sample *samples, size_t maxSamples) {
+    const BlockHeader * const header = reinterpret_cast<const BlockHeader *>(block);
+    const uint8_t *p = block + sizeof(BlockHeader);
+    const size_t length = header->length < BLOCK_SIZE - sizeof(BlockHeader) ?
+            header->length : BLOCK_SIZE - sizeof(BlockHeader);
+    const uint8_t * const end = p + length;
+
+    Sample current = { };
+    size_t n = 0;
+    while (n < header->count && n < maxSamples && p < end) {
+        uint32_t mask = 0;
+        p = getVarint(p, end, &mask);
+        for (size_t i = 0; i < NUM_FIELDS && p != NULL; i++) {
+            if (mask & (1U << i)) {
+                uint32_t delta = 0;
+                p = getVarint(p, end, &delta);
+                current.field[i] += unzigzag(delta);
+            }
+        }
+        if (p == NULL) {
+            break;
+        }
+        samples[n++] = current;
+    }
+    return n;
+}
+
+void Blackbox::shellCommand(BaseChannel *chp, int argc, char *argv[]) {
+    Blackbox * const bb = instance;
+    if (argc == 0) {
+        chprintf(chp, "blackbox %s, trigger: %s\r\n",
+                bb->isFrozen() ? "frozen" : "recording",
+                triggerNames[bb->getTrigger()]);
+    } else if (strcmp(argv[0], "dump") == 0) {
+        if (!bb->isFrozen()) {
+            chprintf(chp, "blackbox still recording, use \"bb stop\" first\r\n");
+            return;
+        }
+        bb->dump(chp);
+    } else if (strcmp(argv[0], "stop") == 0) {
+        bb->trigger(TRIGGER_COMMAND);
+    } else if (strcmp(argv[0], "arm") == 0) {
+        bb->rearm();
+    } else {
+        chprintf(chp, "Usage: bb [dump|stop|arm]\r\n");
+    }
+}
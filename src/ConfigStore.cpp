@@ -0,0 +1,339 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#include "ConfigStore.h"
+#include "Flash.h"
+
+#include <string.h>
+
+static constexpr uint32_t ERASED_WORD = 0xffffffff;
+
+static_assert(sizeof(ConfigStore::PageHeader) == 16, "Page header layout changed");
+static_assert(sizeof(ConfigStore::RecordHeader) == 8, "Record header layout changed");
+
+ConfigStore *ConfigStore::instance = NULL;
+
+static inline uint32_t readWord(const uint8_t *p) {
+    return *reinterpret_cast<const uint32_t *>(p);
+}
+
+ConfigStore::ConfigStore(const Page &a, const Page &b) :
+                pages { a, b },
+                active(0),
+                sequence(0),
+                freeOffset(0),
+                latest { } {
+    hw::mutexInit(&mutex);
+    instance = this;
+}
+
+/**
+ * CRC-32 (IEEE 802.3), using a nibble table to keep flash use small.
+ *
+ * @param crc CRC of preceding data, or zero to start
+ * @param data bytes to checksum
+ * @param length number of bytes
+ * @return updated CRC
+ */
+uint32_t ConfigStore::crc32(uint32_t crc, const void *data, size_t length) {
+    static const uint32_t table[16] = {
+            0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+            0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+            0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+            0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c };
+
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ p[i]) & 0xf] ^ (crc >> 4);
+        crc = table[(crc ^ (p[i] >> 4)) & 0xf] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+bool ConfigStore::pageValid(const Page &page, uint32_t *seq) const {
+    const PageHeader * const header = reinterpret_cast<const PageHeader *>(page.base);
+    if (header->magic != MAGIC || header->format != FORMAT) {
+        return false;
+    }
+    if (crc32(0, header, offsetof(PageHeader, crc)) != header->crc) {
+        return false;
+    }
+    *seq = header->sequence;
+    return true;
+}
+
+/**
+ * Finds the active page and indexes its records. Formats the store if neither
+ * page is valid. Only walks record headers; CRCs are checked on read.
+ *
+ * @return false if the store could not be formatted
+ */
+bool ConfigStore::mount() {
+    hw::mutexLock(&mutex);
+    uint32_t seqA = 0;
+    uint32_t seqB = 0;
+    const bool validA = pageValid(pages[0], &seqA);
+    const bool validB = pageValid(pages[1], &seqB);
+
+    if (!validA && !validB) {
+        // format by "compacting" an empty page into page 0
+        active = 1;
+        sequence = 0;
+        freeOffset = pages[1].size;
+        for (size_t i = 0; i < MAX_KEYS; i++) {
+            latest[i] = NO_RECORD;
+        }
+        const bool formatted = compactLocked();
+        hw::mutexUnlock(&mutex);
+        return formatted;
+    }
+
+    if (validA && (!validB || int32_t(seqA - seqB) > 0)) {
+        active = 0;
+        sequence = seqA;
+    } else {
+        active = 1;
+        sequence = seqB;
+    }
+    scan();
+    hw::mutexUnlock(&mutex);
+    return true;
+}
+
+void ConfigStore::scan() {
+    const Page &page = pages[active];
+    for (size_t i = 0; i < MAX_KEYS; i++) {
+        latest[i] = NO_RECORD;
+    }
+
+    size_t offset = sizeof(PageHeader);
+    while (offset + sizeof(RecordHeader) <= page.size) {
+        const uint32_t word = readWord(page.base + offset);
+        if (word == ERASED_WORD) {
+            break;
+        }
+
+        const RecordHeader * const header = reinterpret_cast<const RecordHeader *>(page.base + offset);
+        const size_t next = offset + sizeof(RecordHeader) + padded(header->length);
+        if (header->length > MAX_RECORD_LENGTH || next > page.size) {
+            // can't skip a corrupt length, so treat the page as full
+            offset = page.size;
+            break;
+        }
+        if (header->key < MAX_KEYS) {
+            latest[header->key] = offset;
+        }
+        offset = next;
+    }
+    freeOffset = offset;
+}
+
+bool ConfigStore::recordValid(const Page &page, size_t offset) const {
+    const RecordHeader * const header = reinterpret_cast<const RecordHeader *>(page.base + offset);
+    if (header->length > MAX_RECORD_LENGTH) {
+        return false;
+    }
+    uint32_t crc = crc32(0, header, offsetof(RecordHeader, crc));
+    crc = crc32(crc, page.base + offset + sizeof(RecordHeader), header->length);
+    return crc == header->crc;
+}
+
+/**
+ * Finds the newest record of a key that passes its CRC check. This is usually
+ * the last one found by scan(); older records are only searched for if that
+ * one was torn by a power loss.
+ */
+size_t ConfigStore::findValid(uint8_t key) const {
+    const Page &page = pages[active];
+    const size_t last = latest[key];
+    if (last == NO_RECORD) {
+        return NO_RECORD;
+    }
+    if (recordValid(page, last)) {
+        return last;
+    }
+
+    size_t found = NO_RECORD;
+    for (size_t offset = sizeof(PageHeader); offset < last;) {
+        const RecordHeader * const header = reinterpret_cast<const RecordHeader *>(page.base + offset);
+        if (header->key == key && recordValid(page, offset)) {
+            found = offset;
+        }
+        offset += sizeof(RecordHeader) + padded(header->length);
+    }
+    return found;
+}
+
+/**
+ * Reads the newest value of a key.
+ *
+ * @param key key to read
+ * @param version expected layout version of the value
+ * @param data buffer to copy the value into
+ * @param length expected size of the value
+ * @return false if there is no valid value with this version and size
+ */
+bool ConfigStore::read(uint8_t key, uint8_t version, void *data, size_t length) const {
+    if (key >= MAX_KEYS) {
+        return false;
+    }
+    hw::mutexLock(&mutex);
+    const size_t offset = findValid(key);
+    const Page &page = pages[active];
+    const RecordHeader * const header = reinterpret_cast<const RecordHeader *>(page.base + offset);
+    const bool found = offset != NO_RECORD && header->version == version && header->length == length;
+    if (found) {
+        memcpy(data, page.base + offset + sizeof(RecordHeader), length);
+    }
+    hw::mutexUnlock(&mutex);
+    return found;
+}
+
+bool ConfigStore::append(const Page &page, size_t *offset, uint8_t key, uint8_t version, const void *data,
+        size_t length) {
+    const size_t words = padded(length) / sizeof(uint32_t);
+    if (*offset + sizeof(RecordHeader) + padded(length) > page.size) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.key = key;
+    header.version = version;
+    header.length = length;
+    header.crc = crc32(crc32(0, &header, offsetof(RecordHeader, crc)), data, length);
+
+    uint32_t payload[MAX_RECORD_LENGTH / sizeof(uint32_t)];
+    payload[words - 1] = ERASED_WORD;
+    memcpy(payload, data, length);
+
+    uint8_t * const dst = page.base + *offset;
+    const uint32_t * const headerWords = reinterpret_cast<const uint32_t *>(&header);
+    // CRC goes in last to commit the record
+    const bool ok = Flash::program(dst, &headerWords[0], 1)
+            && Flash::program(dst + sizeof(RecordHeader), payload, words)
+            && Flash::program(dst + offsetof(RecordHeader, crc), &headerWords[1], 1);
+    // a failed write may have left partial data, so never reuse the space
+    *offset = ok ? *offset + sizeof(RecordHeader) + padded(length) : page.size;
+    return ok;
+}
+
+/**
+ * Stores a new value for a key. Writing a value identical to the stored one
+ * does nothing. May erase a sector, so must not be called with motors running.
+ *
+ * @param key key to write
+ * @param version layout version of the value
+ * @param data value to store
+ * @param length size of the value, at most MAX_RECORD_LENGTH
+ * @return false if the value could not be stored
+ */
+bool ConfigStore::write(uint8_t key, uint8_t version, const void *data, size_t length) {
+    if (key >= MAX_KEYS || length == 0 || length > MAX_RECORD_LENGTH) {
+        return false;
+    }
+    hw::mutexLock(&mutex);
+    const bool written = writeLocked(key, version, data, length);
+    hw::mutexUnlock(&mutex);
+    return written;
+}
+
+bool ConfigStore::writeLocked(uint8_t key, uint8_t version, const void *data, size_t length) {
+    const size_t existing = findValid(key);
+    if (existing != NO_RECORD) {
+        const uint8_t * const p = pages[active].base + existing;
+        const RecordHeader * const header = reinterpret_cast<const RecordHeader *>(p);
+        if (header->version == version && header->length == length
+                && memcmp(p + sizeof(RecordHeader), data, length) == 0) {
+            return true;
+        }
+    }
+
+    size_t offset = freeOffset;
+    if (!append(pages[active], &offset, key, version, data, length)) {
+        freeOffset = offset;
+        if (!compactLocked()) {
+            return false;
+        }
+        offset = freeOffset;
+        if (!append(pages[active], &offset, key, version, data, length)) {
+            freeOffset = offset;
+            return false;
+        }
+    }
+    latest[key] = freeOffset;
+    freeOffset = offset;
+    return true;
+}
+
+/**
+ * Copies the newest valid record of every key to the inactive page, then
+ * makes it active by writing its header.
+ *
+ * @return false on a flash error, in which case the old page stays active
+ */
+bool ConfigStore::compact() {
+    hw::mutexLock(&mutex);
+    const bool compacted = compactLocked();
+    hw::mutexUnlock(&mutex);
+    return compacted;
+}
+
+bool ConfigStore::compactLocked() {
+    const size_t target = active ^ 1;
+    const Page &page = pages[target];
+    if (!Flash::eraseSector(page.sector, page.base, page.size)) {
+        return false;
+    }
+
+    size_t offset = sizeof(PageHeader);
+    for (size_t key = 0; key < MAX_KEYS; key++) {
+        const size_t source = findValid(key);
+        if (source == NO_RECORD) {
+            continue;
+        }
+        const uint8_t * const p = pages[active].base + source;
+        const RecordHeader * const header = reinterpret_cast<const RecordHeader *>(p);
+        if (!append(page, &offset, key, header->version, p + sizeof(RecordHeader), header->length)) {
+            return false;
+        }
+    }
+
+    PageHeader header;
+    header.magic = MAGIC;
+    header.format = FORMAT;
+    header.reserved = 0xffff;
+    header.sequence = sequence + 1;
+    header.crc = crc32(0, &header, offsetof(PageHeader, crc));
+    const uint32_t * const headerWords = reinterpret_cast<const uint32_t *>(&header);
+    if (!Flash::program(page.base, headerWords, 3) || !Flash::program(page.base + offsetof(PageHeader, crc), &headerWords[3], 1)) {
+        return false;
+    }
+
+    active = target;
+    sequence = header.sequence;
+    scan();
+    return true;
+}
@@ -0,0 +1,234 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Hw.h"
+
+#include "DspCheck.h"
+#include "Dsp.h"
+#include "chprintf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int64_t clamp64(int64_t value, int64_t low, int64_t high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+static int32_t lane(uint32_t word, unsigned index) {
+    return int16_t((word >> (16 * index)) & 0xffff);
+}
+
+static uint32_t lanes(int64_t low, int64_t high) {
+    return (uint32_t(low) & 0xffff) | (uint32_t(high) & 0xffff) << 16;
+}
+
+static bool checkQadd(uint32_t a, uint32_t b, uint32_t) {
+    return dsp::qadd(a, b) == clamp64(int64_t(int32_t(a)) + int32_t(b), -0x80000000ll, 0x7fffffffll);
+}
+
+static bool checkQsub(uint32_t a, uint32_t b, uint32_t) {
+    return dsp::qsub(a, b) == clamp64(int64_t(int32_t(a)) - int32_t(b), -0x80000000ll, 0x7fffffffll);
+}
+
+static bool checkSsat8(uint32_t a, uint32_t, uint32_t) {
+    return dsp::ssat<8>(a) == clamp64(int32_t(a), -128, 127);
+}
+
+static bool checkSsat16(uint32_t a, uint32_t, uint32_t) {
+    return dsp::ssat<16>(a) == clamp64(int32_t(a), -32768, 32767);
+}
+
+static bool checkUsat8(uint32_t a, uint32_t, uint32_t) {
+    return dsp::usat<8>(a) == clamp64(int32_t(a), 0, 255);
+}
+
+static bool checkUsat16(uint32_t a, uint32_t, uint32_t) {
+    return dsp::usat<16>(a) == clamp64(int32_t(a), 0, 65535);
+}
+
+static bool checkPack16(uint32_t a, uint32_t b, uint32_t) {
+    return dsp::pack16(a, b) == lanes(int32_t(a), int32_t(b));
+}
+
+static bool checkQadd16(uint32_t a, uint32_t b, uint32_t) {
+    return dsp::qadd16(a, b) == lanes(clamp64(lane(a, 0) + lane(b, 0), -32768, 32767),
+            clamp64(lane(a, 1) + lane(b, 1), -32768, 32767));
+}
+
+static bool checkQsub16(uint32_t a, uint32_t b, uint32_t) {
+    return dsp::qsub16(a, b) == lanes(clamp64(lane(a, 0) - lane(b, 0), -32768, 32767),
+            clamp64(lane(a, 1) - lane(b, 1), -32768, 32767));
+}
+
+static bool checkSmuad(uint32_t a, uint32_t b, uint32_t) {
+    const int64_t sum = int64_t(lane(a, 0)) * lane(b, 0) + int64_t(lane(a, 1)) * lane(b, 1);
+    return uint32_t(dsp::smuad(a, b)) == uint32_t(sum);
+}
+
+static bool checkSmlad(uint32_t a, uint32_t b, uint32_t c) {
+    const int64_t sum = int64_t(int32_t(c)) + int64_t(lane(a, 0)) * lane(b, 0) + int64_t(lane(a, 1)) * lane(b, 1);
+    return uint32_t(dsp::smlad(a, b, c)) == uint32_t(sum);
+}
+
+static bool checkMulhr(uint32_t a, uint32_t b, uint32_t) {
+    const int64_t product = int64_t(int32_t(a)) * int32_t(b);
+    // floor of the high word, plus one if the discarded half is at least 2^31
+    const int64_t high = (product - (product & 0xffffffffll)) / 0x100000000ll;
+    return dsp::mulhr(a, b) == high + ((product & 0xffffffffll) >= 0x80000000ll);
+}
+
+static bool checkQmul(uint32_t a, uint32_t b, uint32_t) {
+    return dsp::qmul(a, b) == clamp64(int64_t(int32_t(a)) * int32_t(b), -0x80000000ll, 0x7fffffffll);
+}
+
+static bool checkMulq24(uint32_t a, uint32_t b, uint32_t) {
+    const int64_t product = int64_t(int32_t(a)) * int32_t(b) + (1 << 23);
+    const int64_t scaled = (product - (product & 0xffffff)) / 0x1000000;
+    return dsp::mulq<24>(a, b) == clamp64(scaled, -0x80000000ll, 0x7fffffffll);
+}
+
+static bool checkMulq15(uint32_t a, uint32_t b, uint32_t) {
+    const int64_t product = int64_t(lane(a, 0)) * lane(b, 0) + (1 << 14);
+    const int64_t scaled = (product - (product & 0x7fff)) / 0x8000;
+    return dsp::mulq15(lane(a, 0), lane(b, 0)) == clamp64(scaled, -32768, 32767);
+}
+
+const DspCheck::Case DspCheck::cases[] = {
+        { "qadd", checkQadd },
+        { "qsub", checkQsub },
+        { "ssat8", checkSsat8 },
+        { "ssat16", checkSsat16 },
+        { "usat8", checkUsat8 },
+        { "usat16", checkUsat16 },
+        { "pack16", checkPack16 },
+        { "qadd16", checkQadd16 },
+        { "qsub16", checkQsub16 },
+        { "smuad", checkSmuad },
+        { "smlad", checkSmlad },
+        { "mulhr", checkMulhr },
+        { "qmul", checkQmul },
+        { "mulq24", checkMulq24 },
+        { "mulq15", checkMulq15 },
+};
+
+const size_t DspCheck::NUM_CASES = sizeof(cases) / sizeof(cases[0]);
+
+// lane and word limits, and their neighbors
+static const uint32_t EDGES[] = {
+        0x00000000, 0x00000001, 0x00007fff, 0x00008000,
+        0x0000ffff, 0x00010000, 0x7fffffff, 0x80000000,
+        0xffffffff, 0x80008000, 0x7fff7fff, 0xffff8000,
+        0x80007fff, 0x40004000, 0xc000c000, 0x00ff00ff,
+};
+static const size_t NUM_EDGES = sizeof(EDGES) / sizeof(EDGES[0]);
+
+static inline uint32_t xorshift(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// random words, with an edge case one time in four to reach saturation often
+static uint32_t operand(uint32_t *state) {
+    const uint32_t r = xorshift(state);
+    return (r & 3) == 0 ? EDGES[(r >> 2) % NUM_EDGES] : xorshift(state);
+}
+
+const DspCheck::Case *DspCheck::find(const char *name) {
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        if (strcmp(cases[i].name, name) == 0) {
+            return &cases[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Checks one primitive over all triples of edge cases, then over random ones.
+ *
+ * @param checkCase primitive to check
+ * @param iterations number of random operand triples
+ * @param seed nonzero seed of the random operands
+ * @return number of operand triples checked and failed
+ */
+DspCheck::Result DspCheck::run(const Case &checkCase, uint32_t iterations, uint32_t seed) {
+    Result result = { checkCase.name, 0, 0, 0, 0, 0 };
+    uint32_t state = seed != 0 ? seed : DEFAULT_SEED;
+    const uint32_t total = NUM_EDGES * NUM_EDGES * NUM_EDGES + iterations;
+    for (uint32_t i = 0; i < total; i++) {
+        uint32_t a;
+        uint32_t b;
+        uint32_t c;
+        if (i < NUM_EDGES * NUM_EDGES * NUM_EDGES) {
+            a = EDGES[i % NUM_EDGES];
+            b = EDGES[i / NUM_EDGES % NUM_EDGES];
+            c = EDGES[i / (NUM_EDGES * NUM_EDGES)];
+        } else {
+            a = operand(&state);
+            b = operand(&state);
+            c = operand(&state);
+        }
+        result.checked++;
+        if (!checkCase.check(a, b, c)) {
+            if (result.failed == 0) {
+                result.a = a;
+                result.b = b;
+                result.c = c;
+            }
+            result.failed++;
+        }
+    }
+    return result;
+}
+
+void DspCheck::print(BaseChannel *chp, const Result &result) {
+    chprintf(chp, "dspcheck,%s,%u,%u", result.name, result.checked, result.failed);
+    if (result.failed != 0) {
+        chprintf(chp, ",%08x,%08x,%08x", result.a, result.b, result.c);
+    }
+    chprintf(chp, "\r\n");
+}
+
+void DspCheck::shellCommand(BaseChannel *chp, int argc, char *argv[]) {
+    if (argc > 3 || (argc >= 1 && strcmp(argv[0], "all") != 0 && find(argv[0]) == NULL)) {
+        chprintf(chp, "Usage: dspcheck [all|<case>] [iterations] [seed]\r\ncases:");
+        for (size_t i = 0; i < NUM_CASES; i++) {
+            chprintf(chp, " %s", cases[i].name);
+        }
+        chprintf(chp, "\r\n");
+        return;
+    }
+
+    const uint32_t iterations = argc >= 2 ? strtoul(argv[1], NULL, 0) : DEFAULT_ITERATIONS;
+    const uint32_t seed = argc == 3 ? strtoul(argv[2], NULL, 0) : DEFAULT_SEED;
+    chprintf(chp, "dspcheck,name,checked,failed,a,b,c\r\n");
+    for (size_t i = 0; i < NUM_CASES; i++) {
+        if (argc == 0 || strcmp(argv[0], "all") == 0 || strcmp(argv[0], cases[i].name) == 0) {
+            print(chp, run(cases[i], iterations, seed));
+        }
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#include "Hw.h"
+
+#include "HFCS.h"
+#include "EventLog.h"
+#include "chprintf.h"
+
+#include <string.h>
+
+static_assert(sizeof(EventLog::Storage) <= BKP_SRAM_SIZE, "Event log does not fit in backup SRAM");
+
+static const char * const eventNames[EventLog::NUM_EVENT_TYPES] = {
+        "reset",
+        "gyro fail",
+        "m1 fault",
+        "failsafe",
+        "failsafe clear",
+        "hard fault" };
+
+EventLog::Storage &EventLog::storage() {
+    return *static_cast<Storage *>(hw::backupRam());
+}
+
+/**
+ * Validates the log, starts a new boot, and records the cause of the reset.
+ * Must be called once at startup before any other use of the log.
+ */
+void EventLog::init() {
+    hw::enableBackupRam();
+
+    Storage &s = storage();
+    if (s.magic != MAGIC || s.head >= NUM_ENTRIES || s.count > NUM_ENTRIES) {
+        memset(&s, 0, sizeof(s));
+        s.magic = MAGIC;
+    }
+    s.boot++;
+
+    log(EVENT_RESET, hw::takeResetFlags());
+}
+
+/**
+ * Appends an event to the log. Safe to call from both thread and ISR context.
+ *
+ * @param type kind of event
+ * @param arg event-specific value, such as an error code
+ */
+void EventLog::log(Type type, uint32_t arg) {
+    Storage &s = storage();
+
+    const uint32_t irqState = hw::irqSave();
+    Entry &entry = s.entries[s.head];
+    entry.boot = s.boot;
+    entry.type = type;
+    entry.reserved = 0;
+    entry.time = hw::now();
+    entry.arg = arg;
+    s.head = (s.head + 1) % NUM_ENTRIES;
+    if (s.count < NUM_ENTRIES) {
+        s.count++;
+    }
+    hw::irqRestore(irqState);
+}
+
+void EventLog::clear() {
+    Storage &s = storage();
+
+    const uint32_t irqState = hw::irqSave();
+    s.head = 0;
+    s.count = 0;
+    s.fault.valid = 0;
+    hw::irqRestore(irqState);
+}
+
+void EventLog::printEntry(BaseChannel *chp, const Entry &entry) {
+    const char * const name = entry.type < NUM_EVENT_TYPES ? eventNames[entry.type] : "?";
+    chprintf(chp, "[%u %10u] %s 0x%x\r\n", entry.boot, entry.time, name, entry.arg);
+}
+
+void EventLog::printFault(BaseChannel *chp, const FaultRecord &fault) {
+    chprintf(chp, "hard fault in boot %u\r\n", fault.boot);
+    chprintf(chp, " r0 0x%08x  r1 0x%08x  r2 0x%08x  r3 0x%08x\r\n", fault.r0, fault.r1, fault.r2, fault.r3);
+    chprintf(chp, "r12 0x%08x  lr 0x%08x  pc 0x%08x psr 0x%08x\r\n", fault.r12, fault.lr, fault.pc, fault.psr);
+    chprintf(chp, " sp 0x%08x cfsr 0x%08x hfsr 0x%08x\r\n", fault.sp, fault.cfsr, fault.hfsr);
+    chprintf(chp, "mmfar 0x%08x bfar 0x%08x\r\n", fault.mmfar, fault.bfar);
+    for (size_t i = 0; i < STACK_WORDS; i += 4) {
+        chprintf(chp, "  0x%08x: %08x %08x %08x %08x\r\n",
+                uint32_t(fault.sp + i * sizeof(uint32_t)),
+                fault.stack[i], fault.stack[i + 1], fault.stack[i + 2], fault.stack[i + 3]);
+    }
+}
+
+/**
+ * Prints the events logged during the previous boot and the saved hard fault,
+ * if it happened in the previous boot.
+ */
+void EventLog::printSummary(BaseChannel *chp) {
+    const Storage &s = storage();
+    const uint16_t lastBoot = s.boot - 1;
+
+    chprintf(chp, "boot %u, %u events logged\r\n", s.boot, s.count);
+    for (size_t i = 0; i < s.count; i++) {
+        const Entry &entry = s.entries[(s.head + NUM_ENTRIES - s.count + i) % NUM_ENTRIES];
+        if (entry.boot == lastBoot || entry.boot == s.boot) {
+            printEntry(chp, entry);
+        }
+    }
+    if (s.fault.valid == FAULT_VALID && s.fault.boot == lastBoot) {
+        printFault(chp, s.fault);
+    }
+}
+
+void EventLog::print(BaseChannel *chp) {
+    const Storage &s = storage();
+
+    for (size_t i = 0; i < s.count; i++) {
+        printEntry(chp, s.entries[(s.head + NUM_ENTRIES - s.count + i) % NUM_ENTRIES]);
+    }
+    if (s.fault.valid == FAULT_VALID) {
+        printFault(chp, s.fault);
+    }
+}
+
+void EventLog::shellCommand(BaseChannel *chp, int argc, char *argv[]) {
+    if (argc == 0) {
+        print(chp);
+    } else if (strcmp(argv[0], "clear") == 0) {
+        clear();
+    } else {
+        chprintf(chp, "Usage: log [clear]\r\n");
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Format.h"
+#include "chprintf.h"
+
+#include <stdint.h>
+
+/**
+ * Prints a number in fixed point, as chprintf has no float support. The value
+ * is rounded before splitting, so that a fraction rounding up carries into the
+ * whole part.
+ *
+ * @param chp console to print to
+ * @param value number to print, with a whole part that fits in 32 bits
+ * @param places decimal places, at most MAX_FIXED_PLACES
+ */
+void printFixed(BaseChannel *chp, float value, size_t places) {
+    uint32_t scale = 1;
+    for (size_t i = 0; i < places; i++) {
+        scale *= 10;
+    }
+    const char * const sign = value < 0 ? "-" : "";
+    const float magnitude = value < 0 ? -value : value;
+    uint64_t scaled = uint64_t(magnitude * scale + 0.5f);
+    const uint32_t whole = scaled / scale;
+
+    char fraction[MAX_FIXED_PLACES + 1];
+    fraction[places] = '\0';
+    for (size_t i = places; i > 0; i--) {
+        fraction[i - 1] = '0' + scaled % 10;
+        scaled /= 10;
+    }
+    chprintf(chp, places > 0 ? "%s%u.%s" : "%s%u%s", sign, whole, fraction);
+}
@@ -0,0 +1,111 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "GainSchedule.h"
+
+GainSchedule::GainSchedule() :
+        base { },
+        scales { },
+        range(0),
+        scale(1.f),
+        gains { } {
+    for (size_t i = 0; i < NUM_POINTS; i++) {
+        scales[i] = 1.f;
+    }
+}
+
+/**
+ * Sets the gains at idle weapon and the scales on top of them. The gains take
+ * the scale of the last command right away.
+ *
+ * @param base gains with the weapon stopped
+ * @param scales gain scale at each breakpoint after idle, NUM_POINTS - 1 of them
+ * @param range weapon command at full speed
+ */
+void GainSchedule::configure(const Gains &base, const float *scales, int32_t range) {
+    this->base = base;
+    this->scales[0] = 1.f;
+    for (size_t i = 1; i < NUM_POINTS; i++) {
+        this->scales[i] = scales[i - 1];
+    }
+    this->range = range;
+    apply();
+}
+
+/**
+ * Replaces the whole schedule's gains with ones found at some weapon command,
+ * such as from an autotune run, keeping the scales. The base becomes the found
+ * gains divided by the scale they were found at; "autotune keep" stores that
+ * same base as kp, ki and kd, so keeping a result leaves the gains in use as
+ * they are.
+ *
+ * @param found gains found at the scale foundScale
+ * @param foundScale schedule scale when the gains were found
+ */
+void GainSchedule::retune(const Gains &found, float foundScale) {
+    base.kp = found.kp / foundScale;
+    base.ki = found.ki / foundScale;
+    base.kd = found.kd / foundScale;
+    apply();
+}
+
+/**
+ * Looks up the scale for a weapon command.
+ *
+ * @param command weapon command, within [0, range]
+ * @return true if the gains changed
+ */
+bool GainSchedule::update(int32_t command) {
+    if (range <= 0) {
+        return false;
+    }
+    if (command < 0) {
+        command = 0;
+    } else if (command > range) {
+        command = range;
+    }
+
+    // 64-bit product, as the command times the segment count may not fit
+    const int32_t position = int64_t(command) * (NUM_POINTS - 1) * 256 / range;
+    size_t segment = position >> 8;
+    if (segment >= NUM_POINTS - 1) {
+        segment = NUM_POINTS - 2;
+    }
+    const float fraction = (position - int32_t(segment << 8)) / 256.f;
+    const float next = scales[segment] + (scales[segment + 1] - scales[segment]) * fraction;
+    if (next == scale) {
+        return false;
+    }
+    scale = next;
+    apply();
+    return true;
+}
+
+void GainSchedule::apply() {
+    gains.kp = base.kp * scale;
+    gains.ki = base.ki * scale;
+    gains.kd = base.kd * scale;
+}
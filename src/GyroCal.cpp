@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "GyroCal.h"
+
+#include <algorithm>
+
+static_assert(sizeof(GyroCal) == 12, "Gyro calibration layout changed");
+
+GyroCalibrator::GyroCalibrator() {
+    reset();
+}
+
+void GyroCalibrator::reset() {
+    for (size_t i = 0; i < 3; i++) {
+        sums[i] = 0;
+        lows[i] = INT16_MAX;
+        highs[i] = INT16_MIN;
+    }
+    samples = 0;
+}
+
+void GyroCalibrator::add(const int16_t rates[3]) {
+    for (size_t i = 0; i < 3; i++) {
+        sums[i] += rates[i];
+        lows[i] = std::min(lows[i], rates[i]);
+        highs[i] = std::max(highs[i], rates[i]);
+    }
+    samples++;
+}
+
+void GyroCalibrator::getBias(int16_t bias[3]) const {
+    for (size_t i = 0; i < 3; i++) {
+        bias[i] = samples > 0 ? sums[i] / int32_t(samples) : 0;
+    }
+}
+
+uint16_t GyroCalibrator::getSpread() const {
+    if (samples == 0) {
+        return 0;
+    }
+    int32_t spread = 0;
+    for (size_t i = 0; i < 3; i++) {
+        spread = std::max(spread, int32_t(highs[i]) - lows[i]);
+    }
+    return std::min(spread, int32_t(UINT16_MAX));
+}
+
+/**
+ * Packs the current average into a calibration record.
+ *
+ * @param temperature raw sensor temperature at the time of calibration
+ */
+GyroCal GyroCalibrator::result(int8_t temperature) const {
+    GyroCal cal;
+    getBias(cal.bias);
+    cal.temperature = temperature;
+    cal.reserved = 0;
+    cal.spread = getSpread();
+    cal.samples = std::min(samples, size_t(UINT16_MAX));
+    return cal;
+}
@@ -23,274 +23,724 @@
  *  in this Software without prior written authorization from Xo Wang.
  */
 
-#include "ch.h"
-#include "hal.h"
+#include "Hw.h"
 
 #include "HFCS.h"
 #include "A4960.h"
 #include "VNH5050A.h"
 #include "L3GD20.h"
 #include "Pid.hpp"
+#include "EventLog.h"
+#include "Log.h"
+#include "ConfigStore.h"
+#include "IntMath.h"
 
 #include <algorithm>
 
-static inline int32_t nabs(int32_t i);
-
 HFCS *HFCS::instance = NULL;
-icucnt_t HFCS::negativeWidth = 0;
-icucnt_t HFCS::positiveWidth = 0;
+hw::IcuCount HFCS::negativeWidth = 0;
+hw::IcuCount HFCS::positiveWidth = 0;
 
-HFCS::HFCS(A4960 &m1, VNH5050A &mLeft, VNH5050A &mRight, ICUDriver *icup, L3GD20 &gyro) :
+HFCS::HFCS(A4960 &m1, VNH5050A &mLeft, VNH5050A &mRight, hw::Icu *icup, L3GD20 &gyro, Blackbox &blackbox, Params &params,
+        ConfigStore &store) :
                 m1(m1),
                 mLeft(mLeft),
                 mRight(mRight),
                 icup(icup),
                 gyro(gyro),
-                pulseWidths { },
-                currentPulse(0),
+                blackbox(blackbox),
+                params(params),
+                store(store),
+                ppm(),
                 dcOutRange(mLeft.getRange()),
+                throttleMap(),
+                rateMap(),
+                driveMap(),
+                rateCurve(),
+                turnCurve(),
+                driveCurve(),
+                mixer(),
+                gyroFilter(),
+                notchTracker(),
+                rateEstimator(),
+                rateEstimate(false),
+                headingHold(),
+                holdingHeading(false),
+                autotune(),
+                throttlePercentMap(),
+                stickPercentMap(),
+                rudderPercentMap(),
                 channels { },
                 channelsValid(false),
                 lastValidChannels(0),
-                gyroEnable(true) {
+                gyroEnable(true),
+                gainSchedule(),
+                lastTimestamp(0),
+                periodMs(0.f),
+                gyroCal { },
+                calibrating(false),
+                commandSteps(0),
+                calibrationUnsaved(false),
+                receiverOffSteps(0),
+                frame { },
+                buttonPressed(false),
+                m1Fault(false),
+                m1FaultPending(false),
+                failsafeTripped(false) {
                     instance = this;
 }
 
-static constexpr size_t LOOP_DELAY_US = 5000;
-static constexpr systime_t LOOP_DELAY = US2ST(LOOP_DELAY_US);
+static constexpr hw::Time LOOP_DELAY = hw::usToTicks(HFCS::LOOP_DELAY_US);
+static constexpr float LOOP_HZ = 1e6f / HFCS::LOOP_DELAY_US;
+
+// full calibration: discard readings while the sensor settles, then average
+static constexpr size_t CAL_IGNORE_ITERS = 100 * 1000 / HFCS::LOOP_DELAY_US;
+static constexpr size_t CAL_ITERS = 1500 * 1000 / HFCS::LOOP_DELAY_US;
+// boot-time check of the stored calibration, 100 ms in total
+static constexpr size_t CHECK_IGNORE_ITERS = 20 * 1000 / HFCS::LOOP_DELAY_US;
+static constexpr size_t CHECK_ITERS = 80 * 1000 / HFCS::LOOP_DELAY_US;
+// ~1 deg/s at 2000 deg/s full scale
+static constexpr int32_t CHECK_BIAS_TOLERANCE = 15;
+// sensor temperature is in degrees C, with an unspecified offset
+static constexpr int32_t CHECK_TEMPERATURE_TOLERANCE = 10;
+// largest peak-to-peak reading of a gyro at rest, noise included
+static constexpr uint16_t STILL_MAX_SPREAD = 80;
+// background results closer than this to the current bias aren't saved
+static constexpr int32_t SAVE_BIAS_THRESHOLD = 3;
+// a new calibration is only saved once the receiver has been off this long,
+// as an erase during the save stalls the CPU for a second or two, which must
+// not happen when the robot could be driven again
+static constexpr size_t SAVE_IDLE_ITERS = 10000 * 1000 / HFCS::LOOP_DELAY_US;
+// recalibration stick command must be held for this long
+static constexpr size_t COMMAND_ITERS = 1000 * 1000 / HFCS::LOOP_DELAY_US;
+// autotune gives up if the oscillation isn't steady by then
+static constexpr size_t AUTOTUNE_ITERS = 5000 * 1000 / HFCS::LOOP_DELAY_US;
+
+// config validation keeps the input range within the widths the decoder
+// accepts, and outputs are at most 16-bit timer periods or gyro full scale
+static_assert(RangeMap(PpmDecoder::MIN_WIDTH, PpmDecoder::MAX_WIDTH, -65535, 65535, 0).valid(),
+        "Stick ranges too wide for exact mapping");
 
 void HFCS::init() {
-    constexpr float Kp = 0.25f;
-    constexpr float Ki = 0.01f;
-    constexpr float Kd = 0.f;
+    const Config &config = params.active();
     constexpr float timeStepMS = LOOP_DELAY_US / 1000.f;
 
     gyroPID.Init(
-        Kp,                                         // tuning constants
-        Ki,
-        Kd,
+        config.kp,                                  // tuning constants
+        config.ki,
+        config.kd,
         PidNs::Pid<float>::PID_DIRECT,              // feedback direction
         PidNs::Pid<float>::DONT_ACCUMULATE_OUTPUT,  // rate or distance control
         timeStepMS,                                 // time step size in ms
         -dcOutRange,                                // output min
         dcOutRange,                                 // output max
         0.f);                                       // initial setpoint
+    applyConfig();
 
     if (gyroEnable) {
         // signal bias recording started
-        palClearPad(GPIOA, GPIOA_LEDQ);
-        palClearPad(GPIOA, GPIOA_LEDR);
-        // number of iterations to discard readings
-        constexpr size_t ignoreIters = 100 * 1000 / LOOP_DELAY_US;
-        // number of iterations to record for bias (specified as time)
-        constexpr size_t biasIters = 1500 * 1000 / LOOP_DELAY_US;
-        int16_t rates[3];
-        int32_t accumulatedRates[3] = { 0, 0, 0 };
-
-        systime_t ticks = chTimeNow();
-        for (size_t i = 0; i < biasIters + ignoreIters; i++) {
-            gyro.readGyro(&rates[0], &rates[1], &rates[2]);
-            if (gyro.error() != RDY_OK) {
-                // disable gyro mode if reading fails
-                gyroEnable = false;
-                break;
-            }
+        hw::clearPad(GPIOA, GPIOA_LEDQ);
+        hw::clearPad(GPIOA, GPIOA_LEDR);
+
+        int8_t temperature;
+        gyro.readTemperature(&temperature);
+        if (gyro.error() != hw::OK) {
+            EventLog::log(EventLog::EVENT_GYRO_FAIL, gyro.error());
+            gyroEnable = false;
+            return;
+        }
 
-            // discard the first <ignoreIters> results
-            if (i >= ignoreIters) {
-                // accumulate rates into array
-                for (size_t j = 0; j < 3; j++) {
-                    accumulatedRates[j] += rates[j];
-                }
+        // a short look is enough to tell if the stored bias still holds
+        GyroCal stored;
+        if (store.read(ConfigStore::KEY_GYRO_CAL, GyroCal::VERSION, &stored, sizeof(stored))
+                && collectGyro(CHECK_IGNORE_ITERS, CHECK_ITERS)
+                && calibrationHolds(stored, temperature)) {
+            gyroCal = stored;
+            LOG_INFO("gyro calibration restored");
+        } else if (gyroEnable && collectGyro(CAL_IGNORE_ITERS, CAL_ITERS)) {
+            gyroCal = calibrator.result(temperature);
+            // don't keep a bias taken while the robot was being moved
+            if (gyroCal.spread <= STILL_MAX_SPREAD) {
+                LOG_INFO("gyro calibrated, bias %d %d %d, spread %d", gyroCal.bias[0], gyroCal.bias[1],
+                        gyroCal.bias[2], gyroCal.spread);
+                // still booting, so the motors can't run yet
+                saveCalibration(gyroCal);
             }
+        }
+        calibrator.reset();
+    }
+}
 
-            ticks += LOOP_DELAY;
-            chThdSleepUntil(ticks);
+/**
+ * Samples the gyro at the loop rate into the calibrator. Only for use before
+ * the control loop starts.
+ *
+ * @param ignoreIters number of initial readings to discard
+ * @param iters number of readings to accumulate
+ * @return false if a read failed, which also disables gyro mode
+ */
+bool HFCS::collectGyro(size_t ignoreIters, size_t iters) {
+    calibrator.reset();
+    int16_t rates[3];
+    hw::Time ticks = hw::now();
+    for (size_t i = 0; i < ignoreIters + iters; i++) {
+        gyro.readGyro(&rates[0], &rates[1], &rates[2]);
+        if (gyro.error() != hw::OK) {
+            // disable gyro mode if reading fails
+            EventLog::log(EventLog::EVENT_GYRO_FAIL, gyro.error());
+            gyroEnable = false;
+            return false;
         }
-        // divide accumulated rates by iterations
-        for (size_t i = 0; i < 3; i++) {
-            gyroBias[i] = accumulatedRates[i] / int32_t(biasIters);
+
+        // discard the first <ignoreIters> results
+        if (i >= ignoreIters) {
+            calibrator.add(rates);
         }
+
+        ticks += LOOP_DELAY;
+        hw::sleepUntil(ticks);
     }
+    return true;
 }
 
-NORETURN void HFCS::fastLoop() {
-    icuEnable(icup);
+/**
+ * Checks a stored calibration against the readings in the calibrator.
+ *
+ * @param stored calibration loaded from flash
+ * @param temperature current raw sensor temperature
+ * @return true if the gyro is at rest and still has the stored bias
+ */
+bool HFCS::calibrationHolds(const GyroCal &stored, int8_t temperature) const {
+    if (stored.spread > STILL_MAX_SPREAD || calibrator.getSpread() > STILL_MAX_SPREAD) {
+        return false;
+    }
+    if (nabs(temperature - stored.temperature) < -CHECK_TEMPERATURE_TOLERANCE) {
+        return false;
+    }
+    int16_t bias[3];
+    calibrator.getBias(bias);
+    for (size_t i = 0; i < 3; i++) {
+        if (nabs(bias[i] - stored.bias[i]) < -CHECK_BIAS_TOLERANCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Enables the inputs and the weapon motor. Called once before the first step.
+ */
+void HFCS::start() {
+    hw::icuStartCapture(icup);
     m1.setMode(true);
+    hw::startCycleCounter();
+    // the first step counts as one nominal period, so a recorded period is never zero
+    lastTimestamp = hw::timestamp() - LOOP_DELAY_US * (hw::TIMESTAMP_HZ / 1000000);
+}
 
-    systime_t ticks = chTimeNow();
+NORETURN void HFCS::fastLoop() {
+    start();
+
+    hw::Time ticks = hw::now();
     while (true) {
-        palSetPad(GPIOA, GPIOA_LEDR);
-        if (channelsValid) {
-            if (gyroEnable) {
-                gyroMotorControl();
-            } else {
-                manualMotorControl();
-            }
+        step();
+        ticks += LOOP_DELAY;
+        hw::sleepUntil(ticks);
+    }
+}
+
+/**
+ * Runs one iteration of the control loop. Must be called every LOOP_DELAY_US.
+ */
+void HFCS::step() {
+    hw::setPad(GPIOA, GPIOA_LEDR);
+    // pick up parameter changes only between steps
+    if (params.update()) {
+        applyConfig();
+    }
+
+    // whole microseconds, as recorded, so that a replay runs the same PID steps
+    static_assert(hw::TIMESTAMP_HZ % 1000000 == 0, "Timestamps must count whole microseconds");
+    const uint32_t timestamp = hw::timestamp();
+    const uint32_t periodUs = (timestamp - lastTimestamp) / (hw::TIMESTAMP_HZ / 1000000);
+    periodMs = periodUs / 1000.f;
+    lastTimestamp = timestamp;
+    frame.field[Blackbox::PERIOD] = periodUs;
+
+    frame.field[Blackbox::TIME] = hw::now();
+    for (size_t i = 0; i < NUM_CHANNELS; i++) {
+        frame.field[Blackbox::CHANNEL_0 + i] = channels[i];
+    }
+    // gyro error flag is sticky, as gyro mode is never re-enabled
+    frame.field[Blackbox::FLAGS] &= Blackbox::FLAG_GYRO_ERROR;
+    frame.field[Blackbox::FLAGS] |= (channelsValid ? Blackbox::FLAG_CHANNELS_VALID : 0)
+            | (gyroEnable ? Blackbox::FLAG_GYRO_ENABLE : 0)
+            | (!hw::readPad(GPIOC, GPIOC_M1_DIAG) ? Blackbox::FLAG_M1_FAULT : 0);
+    if (m1FaultPending) {
+        m1FaultPending = false;
+        EventLog::log(EventLog::EVENT_M1_FAULT, m1.readReg(0x7));
+    }
+
+    if (channelsValid && !calibrating && stickCommanded()) {
+        // the aux switch picks the command
+        if (rudderPercentMap.map(channels[4]) > 0) {
+            LOG_INFO("autotune commanded");
+            autotune.request();
         } else {
-            disableMotors();
+            LOG_INFO("gyro recalibration commanded");
+            calibrator.reset();
+            calibrating = true;
         }
+    }
 
-        ticks += LOOP_DELAY;
-        palClearPad(GPIOA, GPIOA_LEDR);
-        chThdSleepUntil(ticks);
+    if (channelsValid) {
+        receiverOffSteps = 0;
+    } else if (receiverOffSteps < SAVE_IDLE_ITERS) {
+        receiverOffSteps++;
+    }
+
+    if (channelsValid && !calibrating) {
+        // background calibration windows must not span driving
+        calibrator.reset();
+        if (gyroEnable) {
+            gyroMotorControl();
+        } else {
+            manualMotorControl();
+        }
+    } else {
+        disableMotors();
+        // don't start the next drive from stale filter state
+        gyroFilter.reset();
+        rateEstimator.reset();
+        holdingHeading = false;
+        autotune.stop();
+        // recalibrate in the background while disarmed
+        if (gyroEnable) {
+            calibrationStep();
+        }
+        if (calibrationUnsaved && receiverOffSteps >= SAVE_IDLE_ITERS) {
+            calibrationUnsaved = false;
+            saveCalibration(gyroCal);
+        }
     }
+    blackbox.record(frame);
+
+    hw::clearPad(GPIOA, GPIOA_LEDR);
+}
+
+/**
+ * Applies parameters that need more than a read at each use.
+ */
+void HFCS::applyConfig() {
+    const Config &config = params.active();
+    const GainSchedule::Gains gains = { config.kp, config.ki, config.kd };
+    gainSchedule.configure(gains, config.gainScale, m1.getRange());
+    const GainSchedule::Gains &scheduled = gainSchedule.getGains();
+    // integrator is kept, so there is no bump on retuning
+    gyroPID.SetTunings(scheduled.kp, scheduled.ki, scheduled.kd);
+    gyroPID.SetFeedForward(config.kff);
+    gyroPID.SetSetpointWeight(config.setpointWeight);
+    gyroPID.SetDerivativeFilter(config.dFilterHz);
+
+    // map aileron to constant scaled into gyro rate range (2000 deg/s full scale)
+    const int32_t rateRange = config.yawRate * 32767 / 2000;
+    throttleMap = RangeMap(config.inputLow, config.inputHigh, 0, m1.getRange(), 0);
+    rateMap = RangeMap(config.inputLow, config.inputHigh, -rateRange, rateRange, config.inputDeadband);
+    driveMap = RangeMap(config.inputLow, config.inputHigh, -dcOutRange, dcOutRange, config.inputDeadband);
+    throttlePercentMap = RangeMap(config.inputLow, config.inputHigh, 0, 100, 0);
+    stickPercentMap = RangeMap(config.inputLow, config.inputHigh, -100, 100, config.inputDeadband);
+    rudderPercentMap = RangeMap(config.inputLow, config.inputHigh, -100, 100, 0);
+    rateCurve = Curve(config.aileronExpo, config.aileronSuperRate, rateRange);
+    turnCurve = Curve(config.aileronExpo, config.aileronSuperRate, dcOutRange);
+    driveCurve = Curve(config.elevatorExpo, config.elevatorSuperRate, dcOutRange);
+
+    const Mixer::Output outputs[NUM_MIX_OUTPUTS] = {
+            { { config.mixLeftForward, config.mixLeftTurn }, dcOutRange, config.dcDeadband, config.leftInvert != 0 },
+            { { config.mixRightForward, config.mixRightTurn }, dcOutRange, config.dcDeadband, config.rightInvert != 0 },
+    };
+    mixer.configure(NUM_MIX_INPUTS, outputs, NUM_MIX_OUTPUTS);
+
+    // nothing above Nyquist validates, which turns the stage off
+    gyroFilter.setStage(GYRO_LOW_PASS, Biquad::lowPass(config.gyroLowPassHz, LOOP_HZ));
+    gyroFilter.setStage(GYRO_NOTCH, Biquad::notch(config.gyroNotchHz, LOOP_HZ, config.gyroNotchQ));
+
+    const NotchTracker::Settings tracking = {
+            LOOP_HZ, config.dynNotchMinHz, config.dynNotchMaxHz, config.dynNotchQ, size_t(config.dynNotchCount) };
+    notchTracker.configure(tracking);
+
+    const RateEstimator::Model model = {
+            config.rateModelTau, config.rateModelGain, config.rateProcessSd, config.rateNoiseSd };
+    rateEstimator.configure(model, LOOP_DELAY_US / 1e6f);
+    rateEstimate = config.rateEstimate != 0;
+
+    headingHold.configure(config.headingKp, config.headingMaxError, LOOP_DELAY_US / 1e6f);
 }
 
 inline void HFCS::gyroMotorControl() {
     // map throttle to 3ph motor drive
-    const int32_t throttle = mapRanges(INPUT_LOW, INPUT_HIGH, channels[2], 0, m1.getRange(), 0);
+    const int32_t throttle = throttleMap.map(channels[2]);
     m1.setWidth(throttle);
+    // the weapon's angular momentum couples into yaw, so the gains follow it
+    if (gainSchedule.update(throttle)) {
+        const GainSchedule::Gains &gains = gainSchedule.getGains();
+        gyroPID.SetTunings(gains.kp, gains.ki, gains.kd);
+    }
 
-    // map aileron to constant scaled into gyro rate range
-    constexpr int32_t rateRange = 720 * 32767 / 2000;
-    const int32_t aileron = mapRanges(INPUT_LOW, INPUT_HIGH, channels[0], -rateRange, rateRange, INPUT_DEADBAND);
-    const int32_t elevator = mapRanges(INPUT_LOW, INPUT_HIGH, channels[1], -dcOutRange, dcOutRange, INPUT_DEADBAND);
+    const int32_t aileron = rateCurve.apply(rateMap.map(channels[0]));
+    const int32_t elevator = driveCurve.apply(driveMap.map(channels[1]));
 
     int16_t rates[3];
     gyro.readGyro(&rates[0], &rates[1], &rates[2]);
     // disable gyro correction if there's an error
-    if (gyro.error() != RDY_OK) {
-        gyroEnable = false;
+    if (gyro.error() != hw::OK) {
+        gyroFailed();
         return;
     }
-    // correct for bias
+    // correct for bias, in 32 bits, as a reading near full scale can end up
+    // past the range of a reading
+    int32_t filtered[3];
     for (size_t i = 0; i < 3; i++) {
-        rates[i] -= gyroBias[i];
+        filtered[i] = int32_t(rates[i]) - gyroCal.bias[i];
+        frame.field[Blackbox::RATE_X + i] = filtered[i];
     }
+    if (notchTracker.isEnabled()) {
+        notchTracker.push(filtered[2]);
+    }
+    Biquad notches[NotchTracker::MAX_NOTCHES];
+    if (notchTracker.takeNotches(notches)) {
+        for (size_t i = 0; i < NotchTracker::MAX_NOTCHES; i++) {
+            gyroFilter.setStage(GYRO_DYNAMIC_NOTCH + i, notches[i]);
+        }
+    }
+    // the blackbox keeps the raw rates, to show what the filters remove
+    gyroFilter.process(filtered, filtered);
+
+    float rate = filtered[2];
+    if (rateEstimate) {
+        const bool wasFaulted = rateEstimator.isFaulted();
+        rate = rateEstimator.update(filtered[2], rates[2]);
+        if (rateEstimator.isFaulted() && !wasFaulted) {
+            LOG_WARN("yaw rate model disagrees with gyro");
+        }
+        frame.field[Blackbox::FLAGS] |= (rateEstimator.isSaturated() ? Blackbox::FLAG_RATE_SATURATED : 0)
+                | (rateEstimator.isFaulted() ? Blackbox::FLAG_RATE_FAULT : 0);
+    }
+
+    // a requested experiment starts once the sticks are let go, and steering
+    // stops it
+    if (aileron != 0) {
+        if (autotune.isRunning()) {
+            LOG_INFO("autotune stopped by steering");
+            autotune.stop();
+        }
+    } else if (autotune.takeRequest()) {
+        const Config &config = params.active();
+        autotune.start(config.autotuneRelay * dcOutRange, config.autotuneHysteresis, AUTOTUNE_ITERS,
+                LOOP_DELAY_US / 1e6f, gainSchedule.getScale());
+    }
+
+    const int32_t zControl = autotune.isRunning() ? autotuneControl(rate) : yawControl(aileron, rate);
+    frame.field[Blackbox::PID_OUTPUT] = zControl;
 
-    gyroPID.setPoint = -aileron;
-    gyroPID.Run(rates[2]);
-    const int32_t zControl = gyroPID.output;
+    const int32_t inputs[NUM_MIX_INPUTS] = { elevator, zControl };
+    int32_t mix[NUM_MIX_OUTPUTS];
+    mixer.mix(inputs, mix);
 
-    const int32_t left = std::min(std::max(elevator + zControl, -dcOutRange), dcOutRange);
-    const int32_t right = std::min(std::max(elevator - zControl, -dcOutRange), dcOutRange);
+    if (rateEstimate) {
+        // the model wants the drive as the wheels see it, before wiring inversion
+        const Config &config = params.active();
+        const int32_t left = config.leftInvert != 0 ? -mix[MIX_LEFT] : mix[MIX_LEFT];
+        const int32_t right = config.rightInvert != 0 ? -mix[MIX_RIGHT] : mix[MIX_RIGHT];
+        rateEstimator.command(left - right);
+    }
 
-    mLeft.setSpeed(nabs(left) < -DC_DEADBAND ? left : 0);
-    mRight.setSpeed(nabs(right) < -DC_DEADBAND ? right : 0);
+    driveMotors(mix, throttle);
+}
+
+/**
+ * Runs the yaw rate PID, behind the heading loop if that is switched on.
+ *
+ * @param aileron commanded yaw rate, in gyro units
+ * @param rate measured yaw rate
+ * @return turn command
+ */
+int32_t HFCS::yawControl(int32_t aileron, float rate) {
+    // the aux switch reads like the rudder stick; heading hold is on above center
+    const bool holdHeading = params.active().headingKp > 0.f && rudderPercentMap.map(channels[4]) > 0;
+    float setPoint = -aileron;
+    if (holdHeading) {
+        // hold the heading at the moment of switching
+        if (!holdingHeading) {
+            headingHold.reset();
+        }
+        setPoint = headingHold.update(setPoint, rate);
+        frame.field[Blackbox::FLAGS] |= Blackbox::FLAG_HEADING_HOLD;
+    }
+    holdingHeading = holdHeading;
+
+    gyroPID.setPoint = setPoint;
+    if (params.active().pidMeasuredPeriod != 0) {
+        gyroPID.Run(rate, periodMs);
+    } else {
+        gyroPID.Run(rate);
+    }
+    frame.field[Blackbox::SET_POINT] = gyroPID.setPoint;
+    frame.field[Blackbox::PID_INTEGRAL] = gyroPID.GetITerm();
+    return gyroPID.output;
+}
+
+/**
+ * Runs the autotune relay in place of the PID, and switches to the new gains
+ * once it is done. They last until the next parameter change, unless kept
+ * with the autotune shell command.
+ *
+ * @param rate measured yaw rate
+ * @return turn command
+ */
+int32_t HFCS::autotuneControl(float rate) {
+    const int32_t zControl = autotune.step(rate);
+    // the heading loop restarts from wherever the experiment left the robot
+    holdingHeading = false;
+    frame.field[Blackbox::FLAGS] |= Blackbox::FLAG_AUTOTUNE;
+    frame.field[Blackbox::SET_POINT] = 0;
+    frame.field[Blackbox::PID_INTEGRAL] = gyroPID.GetITerm();
+
+    if (autotune.getState() == Autotune::DONE) {
+        const Autotune::Result &result = autotune.getResult();
+        // found at the experiment's weapon speed; the schedule scales them for
+        // the others
+        const GainSchedule::Gains found = { result.kp, result.ki, result.kd };
+        gainSchedule.retune(found, result.scale);
+        const GainSchedule::Gains &gains = gainSchedule.getGains();
+        gyroPID.SetTunings(gains.kp, gains.ki, gains.kd);
+        LOG_INFO("autotune done, gains x1000: kp %d ki %d kd %d", int32_t(result.kp * 1000),
+                int32_t(result.ki * 1000), int32_t(result.kd * 1000));
+    } else if (autotune.getState() == Autotune::FAILED) {
+        LOG_WARN("autotune found no steady oscillation");
+    }
+    return zControl;
+}
+
+/**
+ * Detects the stick command: weapon throttle off, drive sticks centered, and
+ * the otherwise unused rudder stick held at either end for a second. The
+ * command has to be released before it can trigger again.
+ */
+bool HFCS::stickCommanded() {
+    const int32_t throttle = throttlePercentMap.map(channels[2]);
+    const int32_t aileron = stickPercentMap.map(channels[0]);
+    const int32_t elevator = stickPercentMap.map(channels[1]);
+    const int32_t rudder = rudderPercentMap.map(channels[3]);
+
+    if (throttle > 5 || aileron != 0 || elevator != 0 || nabs(rudder) > -90) {
+        commandSteps = 0;
+        return false;
+    }
+    if (commandSteps < COMMAND_ITERS) {
+        commandSteps++;
+        return commandSteps == COMMAND_ITERS;
+    }
+    return false;
+}
+
+/**
+ * Accumulates one gyro reading towards a new calibration while the motors are
+ * off. Commanded calibrations are always applied unless the robot moved; the
+ * ones done in the background while disarmed only when the bias has drifted,
+ * to keep noise from wearing out the flash.
+ */
+void HFCS::calibrationStep() {
+    int16_t rates[3];
+    gyro.readGyro(&rates[0], &rates[1], &rates[2]);
+    if (gyro.error() != hw::OK) {
+        gyroFailed();
+        calibrating = false;
+        return;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        frame.field[Blackbox::RATE_X + i] = rates[i] - gyroCal.bias[i];
+    }
+
+    calibrator.add(rates);
+    if (calibrator.count() < CAL_ITERS) {
+        return;
+    }
+
+    const bool commanded = calibrating;
+    calibrating = false;
+    const uint16_t spread = calibrator.getSpread();
+    if (spread > STILL_MAX_SPREAD) {
+        if (commanded) {
+            LOG_WARN("gyro recalibration failed, robot moved (spread %d)", spread);
+        }
+        calibrator.reset();
+        return;
+    }
+
+    int8_t temperature;
+    gyro.readTemperature(&temperature);
+    if (gyro.error() != hw::OK) {
+        gyroFailed();
+        return;
+    }
+    const GyroCal cal = calibrator.result(temperature);
+    calibrator.reset();
+
+    bool drifted = false;
+    for (size_t i = 0; i < 3; i++) {
+        drifted = drifted || nabs(cal.bias[i] - gyroCal.bias[i]) <= -SAVE_BIAS_THRESHOLD;
+    }
+    if (commanded || drifted) {
+        gyroCal = cal;
+        // the receiver may be live, so the save waits
+        calibrationUnsaved = true;
+        LOG_INFO("gyro calibrated, bias %d %d %d, spread %d", cal.bias[0], cal.bias[1], cal.bias[2], cal.spread);
+    }
+}
+
+void HFCS::saveCalibration(const GyroCal &cal) {
+    if (!store.write(ConfigStore::KEY_GYRO_CAL, GyroCal::VERSION, &cal, sizeof(cal))) {
+        LOG_WARN("gyro calibration not saved");
+        return;
+    }
+    LOG_INFO("gyro calibration saved");
+}
+
+/**
+ * Falls back to manual control after a gyro read error.
+ */
+void HFCS::gyroFailed() {
+    EventLog::log(EventLog::EVENT_GYRO_FAIL, gyro.error());
+    LOG_WARN("gyro read failed (%d), switching to manual", gyro.error());
+    gyroEnable = false;
+    frame.field[Blackbox::FLAGS] |= Blackbox::FLAG_GYRO_ERROR;
+    blackbox.trigger(Blackbox::TRIGGER_GYRO_FAULT);
 }
 
 inline void HFCS::manualMotorControl() {
-    const int32_t aileron = mapRanges(INPUT_LOW, INPUT_HIGH, channels[0], -dcOutRange, dcOutRange, INPUT_DEADBAND);
-    const int32_t elevator = mapRanges(INPUT_LOW, INPUT_HIGH, channels[1], -dcOutRange, dcOutRange, INPUT_DEADBAND);
+    const int32_t aileron = turnCurve.apply(driveMap.map(channels[0]));
+    const int32_t elevator = driveCurve.apply(driveMap.map(channels[1]));
 
-    const int32_t left = std::min(std::max(elevator - aileron, -dcOutRange), dcOutRange);
-    const int32_t right = std::min(std::max(elevator + aileron, -dcOutRange), dcOutRange);
-    mLeft.setSpeed(nabs(left) < -DC_DEADBAND ? left : 0);
-    mRight.setSpeed(nabs(right) < -DC_DEADBAND ? right : 0);
+    const int32_t inputs[NUM_MIX_INPUTS] = { elevator, -aileron };
+    int32_t mix[NUM_MIX_OUTPUTS];
+    mixer.mix(inputs, mix);
 
-    const int32_t throttle = mapRanges(INPUT_LOW, INPUT_HIGH, channels[2], 0, m1.getRange(), 0);
+    const int32_t throttle = throttleMap.map(channels[2]);
     m1.setWidth(throttle);
+
+    driveMotors(mix, throttle);
 }
 
 inline void HFCS::disableMotors() {
     m1.setWidth(0);
     mLeft.setSpeed(0);
     mRight.setSpeed(0);
+
+    frame.field[Blackbox::LEFT] = 0;
+    frame.field[Blackbox::RIGHT] = 0;
+    frame.field[Blackbox::THROTTLE] = 0;
+}
+
+/**
+ * Sets the drive motors and records the outputs to the blackbox frame.
+ *
+ * @param mix drive mixer outputs, already clamped and cut to the deadband
+ * @param throttle weapon motor command already set, for recording only
+ */
+inline void HFCS::driveMotors(const int32_t *mix, int32_t throttle) {
+    const int32_t left = mix[MIX_LEFT];
+    const int32_t right = mix[MIX_RIGHT];
+    mLeft.setSpeed(left);
+    mRight.setSpeed(right);
+
+    frame.field[Blackbox::LEFT] = left;
+    frame.field[Blackbox::RIGHT] = right;
+    frame.field[Blackbox::THROTTLE] = throttle;
 }
 
 NORETURN void HFCS::failsafeLoop() {
     while (true) {
-        if (chTimeNow() - lastValidChannels > MS2ST(500)) {
-            channelsValid = false;
-            palClearPad(GPIOA, GPIOA_LEDQ);
-        }
-
-        if (palReadPad(GPIOC, GPIOC_M1_DIAG) == 0) {
-//            m1.setMode(false);
-        }
-
-        chThdSleepMilliseconds(50);
+        failsafeStep();
+        hw::sleepMs(FAILSAFE_DELAY_MS);
     }
 }
 
-void HFCS::newPulse() {
-    // start of pulse train (long low time)
-    if (negativeWidth > 5000) {
-        currentPulse = 0;
-        if (checkPulseWidth(positiveWidth)) {
-            pulseWidths[0] = positiveWidth;
-            currentPulse++;
+/**
+ * Runs one iteration of the failsafe and fault monitor. Must be called every
+ * FAILSAFE_DELAY_MS.
+ */
+void HFCS::failsafeStep() {
+    if (hw::now() - lastValidChannels > hw::msToTicks(FAILSAFE_TIMEOUT_MS)) {
+        if (channelsValid) {
+            EventLog::log(EventLog::EVENT_FAILSAFE, hw::now() - lastValidChannels);
+            blackbox.trigger(Blackbox::TRIGGER_FAILSAFE);
+            failsafeTripped = true;
         }
-    } else {
-        if (checkPulseWidth(negativeWidth) && checkPulseWidth(positiveWidth)) {
-            pulseWidths[currentPulse++] = negativeWidth;
-            pulseWidths[currentPulse++] = positiveWidth;
-            if (currentPulse >= NUM_CHANNELS) {
-                currentPulse = 0;
-                std::copy(pulseWidths, pulseWidths + NUM_CHANNELS, channels);
-                palTogglePad(GPIOA, GPIOA_LEDQ);
-                lastValidChannels = chTimeNow();
-                channelsValid = true;
-            }
-        } else {
-            currentPulse = 0;
+        channelsValid = false;
+        hw::clearPad(GPIOA, GPIOA_LEDQ);
+    } else if (channelsValid && failsafeTripped) {
+        EventLog::log(EventLog::EVENT_FAILSAFE_CLEAR);
+        failsafeTripped = false;
+    }
+
+    const bool diag = !hw::readPad(GPIOC, GPIOC_M1_DIAG);
+    if (diag) {
+//        m1.setMode(false);
+        if (!m1Fault) {
+            // logged by the control thread, which owns the driver's SPI bus
+            // and has the stack for it
+            m1FaultPending = true;
         }
+        blackbox.trigger(Blackbox::TRIGGER_M1_FAULT);
     }
-}
+    m1Fault = diag;
 
-void HFCS::icuWidthCb(ICUDriver *icup) {
-    negativeWidth = icuGetWidthI(icup);
+    // button is pulled up, so pressed reads low
+    const bool button = !hw::readPad(GPIOC, GPIOC_BUT1);
+    if (button && !buttonPressed) {
+        blackbox.trigger(Blackbox::TRIGGER_BUTTON);
+    }
+    buttonPressed = button;
 }
 
-void HFCS::icuPeriodCb(ICUDriver *icup) {
-    positiveWidth = icuGetPeriodI(icup) - negativeWidth;
-    instance->newPulse();
+NORETURN void HFCS::spectrumLoop() {
+    while (true) {
+        spectrumStep();
+        hw::sleepMs(SPECTRUM_DELAY_MS);
+    }
 }
 
 /**
- * Negative absolute value. Used to avoid undefined behavior for most negative
- * integer (see C99 standard 7.20.6.1.2 and footnote 265 for the description of
- * abs/labs/llabs behavior).
- *
- * @param i input value, as a 32-bit signed integer
- * @return negative absolute value of i; defined for all values of i
+ * Analyzes the latest gyro samples and retunes the dynamic notches. Runs at
+ * low priority, so it may lag the control loop by a block or two.
  */
-static inline int32_t nabs(int32_t i) {
-#if (((int32_t)-1) >> 1) == ((int32_t)-1)
-    // signed right shift sign-extends (arithmetic)
-    const int32_t negSign = ~(i >> 31); // splat sign bit into all 32 and complement
-    // if i is positive (negSign is -1), xor will invert i and sub will add 1
-    // otherwise i is unchanged
-    return (i ^ negSign) - negSign;
-#else
-    return i < 0 ? i : -i;
-#endif
+void HFCS::spectrumStep() {
+    notchTracker.analyze();
 }
 
-/**
- * Overflow-safe average of two signed integers. The naive average function is
- * erroneous when the sum of the inputs overflows integer limits; this average
- * works by summing the halves of the input values and then correcting the sum
- * for rounding.
- *
- * @param a first value, as a 32-bit signed integer
- * @param b second value, as a 32-bit signed integer
- * @return signed average of the two values, rounded towards zero if their
- * average is not an integer
- */
-static inline int32_t avg(int32_t a, int32_t b) {
-#if (((int32_t)-1) >> 1) != ((int32_t)-1)
-#error "Arithmetic right shift not available with this compiler/platform."
-#endif
-    // shifts divide by two, rounded towards negative infinity
-    const int32_t sumHalves = (a >> 1) + (b >> 1);
-    // this has error of magnitude one if both are odd
-    const uint32_t bothOdd = (a & b) & 1;
-    // round toward zero; add one if one input is odd and sum is negative
-    const uint32_t roundToZero = (sumHalves < 0) & (a ^ b);
-
-    // result is sum of halves corrected for rounding
-    return sumHalves + bothOdd + roundToZero;
+void HFCS::newPulse() {
+    if (ppm.pulse(negativeWidth, positiveWidth)) {
+        std::copy(ppm.getChannels(), ppm.getChannels() + NUM_CHANNELS, channels);
+        hw::togglePad(GPIOA, GPIOA_LEDQ);
+        lastValidChannels = hw::now();
+        channelsValid = true;
+    }
+}
+
+void HFCS::icuWidthCb(hw::Icu *icup) {
+    negativeWidth = hw::icuWidthI(icup);
 }
 
-static inline int32_t signum(int32_t i) {
-    return (i > 0) - (i < 0);
+void HFCS::icuPeriodCb(hw::Icu *icup) {
+    positiveWidth = hw::icuPeriodI(icup) - negativeWidth;
+    instance->newPulse();
 }
 
 /**
  * Proportionally map one range of values to another, with deadband. Care must
- * be taken to not exceed integer limits in this computation!
+ * be taken to not exceed integer limits in this computation! The control loop
+ * uses RangeMap instead, which gives the same results without dividing; this
+ * is kept as its reference.
  *
  * todo: describe exactly conditions for integer overflow errors
  *
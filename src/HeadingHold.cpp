@@ -0,0 +1,69 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "HeadingHold.h"
+
+HeadingHold::HeadingHold() :
+        kp(0.f),
+        maxError(0.f),
+        dt(0.f),
+        error(0.f) {
+}
+
+/**
+ * @param kp rate correction per heading error, in 1/s
+ * @param maxErrorDeg largest heading error held, in degrees
+ * @param dt time between updates, in s
+ */
+void HeadingHold::configure(float kp, float maxErrorDeg, float dt) {
+    this->kp = kp;
+    this->maxError = maxErrorDeg * RATE_SCALE;
+    this->dt = dt;
+}
+
+/**
+ * Holds the current heading from here on.
+ */
+void HeadingHold::reset() {
+    error = 0.f;
+}
+
+/**
+ * Advances both headings by one step.
+ *
+ * @param commandedRate rate commanded by the stick
+ * @param measuredRate rate measured over the last step
+ * @return rate set point for the rate controller
+ */
+float HeadingHold::update(float commandedRate, float measuredRate) {
+    error += (commandedRate - measuredRate) * dt;
+    if (error > maxError) {
+        error = maxError;
+    } else if (error < -maxError) {
+        error = -maxError;
+    }
+    return commandedRate + kp * error;
+}
@@ -39,7 +39,7 @@
 #define L3GD20_ADDR_SEL_LOW     (0x6a)
 #define L3GD20_ADDR_SEL_HIGH    (0x6b)
 
-static const systime_t I2C_TIMEOUT = MS2ST(4);
+static const hw::Time I2C_TIMEOUT = hw::msToTicks(4);
 
 // register addresses
 
@@ -76,8 +76,8 @@ static const systime_t I2C_TIMEOUT = MS2ST(4);
 
 // Public Methods //////////////////////////////////////////////////////////////
 
-L3GD20::L3GD20(I2CDriver *i2cp) :
-        i2cp(i2cp), i2cAddr(L3GD20_ADDR_SEL_HIGH), errFlag(RDY_OK) {
+L3GD20::L3GD20(hw::I2c *i2cp) :
+        i2cp(i2cp), i2cAddr(L3GD20_ADDR_SEL_HIGH), errFlag(hw::OK) {
 }
 
 void L3GD20::setSlaveAddrLSB(uint8_t lsb) {
@@ -99,11 +99,9 @@ void L3GD20::enableDefault() {
 void L3GD20::writeReg(uint8_t reg, uint8_t value) {
     const uint8_t txbuf[2] = { reg, value };
 
-    i2cAcquireBus(i2cp);
-    const msg_t status = i2cMasterTransmitTimeout(i2cp, i2cAddr, txbuf, 2, nullptr, 0, I2C_TIMEOUT);
-    i2cReleaseBus(i2cp);
+    const hw::Status status = hw::i2cTransfer(i2cp, i2cAddr, txbuf, 2, nullptr, 0, I2C_TIMEOUT);
 
-    if (status != RDY_OK) {
+    if (status != hw::OK) {
         errFlag = status;
     }
 }
@@ -111,11 +109,9 @@ void L3GD20::writeReg(uint8_t reg, uint8_t value) {
 // Reads a gyro register
 uint8_t L3GD20::readReg(uint8_t reg) {
     uint8_t value;
-    i2cAcquireBus(i2cp);
-    const msg_t status = i2cMasterTransmitTimeout(i2cp, i2cAddr, &reg, 1, &value, 1, I2C_TIMEOUT);
-    i2cReleaseBus(i2cp);
+    const hw::Status status = hw::i2cTransfer(i2cp, i2cAddr, &reg, 1, &value, 1, I2C_TIMEOUT);
 
-    if (status != RDY_OK) {
+    if (status != hw::OK) {
         errFlag = status;
     }
     return value;
@@ -129,11 +125,9 @@ void L3GD20::readGyro(int16_t *pX, int16_t *pY, int16_t *pZ) {
     // assert MSB of address so gyro auto-increments slave-transmit subaddress
     const uint8_t reg = L3GD20_OUT_X_L | (1 << 7);
 
-    i2cAcquireBus(i2cp);
-    const msg_t status = i2cMasterTransmitTimeout(i2cp, i2cAddr, &reg, 1, values, 6, I2C_TIMEOUT);
-    i2cReleaseBus(i2cp);
+    const hw::Status status = hw::i2cTransfer(i2cp, i2cAddr, &reg, 1, values, 6, I2C_TIMEOUT);
 
-    if (status != RDY_OK) {
+    if (status != hw::OK) {
         errFlag = status;
     }
 #else
@@ -0,0 +1,93 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#include "Hw.h"
+
+#include "Log.h"
+#include "chprintf.h"
+
+Log::Record Log::records[NUM_RECORDS];
+volatile size_t Log::head = 0;
+volatile size_t Log::tail = 0;
+volatile uint32_t Log::dropped = 0;
+
+static const char levelNames[] = "?EWID";
+
+/**
+ * Copies a record into the ring. Interrupts are masked only for the copy.
+ *
+ * @param level severity of the record
+ * @param fmt chprintf format string, which must have static storage duration
+ * @param args raw argument values
+ * @param numArgs number of valid values in args
+ */
+void Log::push(Level level, const char *fmt, const uint32_t *args, size_t numArgs) {
+    const uint32_t irqState = hw::irqSave();
+    const size_t next = (head + 1) % NUM_RECORDS;
+    if (next == tail) {
+        dropped++;
+    } else {
+        Record &record = records[head];
+        record.fmt = fmt;
+        record.time = hw::now();
+        record.level = level;
+        record.numArgs = numArgs;
+        for (size_t i = 0; i < MAX_ARGS; i++) {
+            record.args[i] = args[i];
+        }
+        head = next;
+    }
+    hw::irqRestore(irqState);
+}
+
+/**
+ * Formats and writes out all pending records. Must only be called from one
+ * thread, as it may block on the channel.
+ *
+ * @param chp channel to write formatted records to
+ * @return number of records written
+ */
+size_t Log::drain(BaseChannel *chp) {
+    size_t count = 0;
+    while (tail != head) {
+        const Record record = records[tail];
+        tail = (tail + 1) % NUM_RECORDS;
+
+        chprintf(chp, "%c %u: ", levelNames[record.level], record.time);
+        // unused arguments are zero and ignored by the format string
+        chprintf(chp, record.fmt, record.args[0], record.args[1], record.args[2], record.args[3]);
+        chprintf(chp, "\r\n");
+        count++;
+    }
+
+    if (dropped != 0) {
+        const uint32_t irqState = hw::irqSave();
+        const uint32_t n = dropped;
+        dropped = 0;
+        hw::irqRestore(irqState);
+        chprintf(chp, "W %u: %u log records dropped\r\n", hw::now(), n);
+    }
+    return count;
+}
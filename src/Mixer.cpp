@@ -0,0 +1,111 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Mixer.h"
+#include "Dsp.h"
+#include "IntMath.h"
+
+#include <algorithm>
+
+static constexpr int32_t MAX_INPUT = 32767;
+
+static inline int32_t saturate(int32_t value) {
+    return std::min(std::max(value, -MAX_INPUT), MAX_INPUT);
+}
+
+Mixer::Mixer() :
+        numInputs(0),
+        numOutputs(0),
+        weights { },
+        ranges { },
+        deadbands { },
+        inverted { } {
+}
+
+/**
+ * Replaces the matrix. Must not be called concurrently with mix().
+ *
+ * @param numInputs number of inputs, at most MAX_INPUTS
+ * @param outputs one row of weights and limits per output
+ * @param numOutputs number of outputs, at most MAX_OUTPUTS
+ * @return false if a size or weight is out of range, in which case the matrix
+ *      is left unchanged
+ */
+bool Mixer::configure(size_t numInputs, const Output *outputs, size_t numOutputs) {
+    if (numInputs > MAX_INPUTS || numOutputs > MAX_OUTPUTS) {
+        return false;
+    }
+    for (size_t o = 0; o < numOutputs; o++) {
+        for (size_t i = 0; i < numInputs; i++) {
+            const float weight = outputs[o].weights[i];
+            if (!(weight >= -MAX_WEIGHT && weight <= MAX_WEIGHT)) {
+                return false;
+            }
+        }
+    }
+
+    this->numInputs = numInputs;
+    this->numOutputs = numOutputs;
+    for (size_t o = 0; o < numOutputs; o++) {
+        int16_t row[MAX_INPUTS] = { };
+        for (size_t i = 0; i < numInputs; i++) {
+            const float weight = outputs[o].weights[i];
+            row[i] = int16_t(weight * ONE + (weight < 0 ? -0.5f : 0.5f));
+        }
+        for (size_t p = 0; p < NUM_PAIRS; p++) {
+            weights[o][p] = dsp::pack16(row[2 * p], row[2 * p + 1]);
+        }
+        ranges[o] = outputs[o].range;
+        deadbands[o] = outputs[o].deadband;
+        inverted[o] = outputs[o].inverted;
+    }
+    return true;
+}
+
+/**
+ * @param inputs numInputs values, saturated to [-32767, 32767]
+ * @param outputs numOutputs values, each within its range
+ */
+void Mixer::mix(const int32_t *inputs, int32_t *outputs) const {
+    const size_t numPairs = (numInputs + 1) / 2;
+    uint32_t packed[NUM_PAIRS];
+    for (size_t p = 0; p < numPairs; p++) {
+        const int32_t high = 2 * p + 1 < numInputs ? saturate(inputs[2 * p + 1]) : 0;
+        packed[p] = dsp::pack16(saturate(inputs[2 * p]), high);
+    }
+
+    for (size_t o = 0; o < numOutputs; o++) {
+        // round to nearest
+        int32_t sum = ONE / 2;
+        for (size_t p = 0; p < numPairs; p++) {
+            sum = dsp::smlad(packed[p], weights[o][p], sum);
+        }
+        int32_t value = sum >> WEIGHT_BITS;
+        value = std::min(std::max(value, -ranges[o]), ranges[o]);
+        value = nabs(value) < -deadbands[o] ? value : 0;
+        outputs[o] = inverted[o] ? -value : value;
+    }
+}
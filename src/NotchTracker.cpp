@@ -0,0 +1,326 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "Hw.h"
+
+#include "NotchTracker.h"
+#include "Dsp.h"
+#include "Format.h"
+#include "chprintf.h"
+
+#include <algorithm>
+#include <math.h>
+
+static constexpr float PI = 3.14159265f;
+
+NotchTracker *NotchTracker::instance = NULL;
+
+NotchTracker::NotchTracker() :
+        enabled(false),
+        blocks { },
+        writeBlock(0),
+        fill(0),
+        takenSequence(0),
+        readyBlock(0),
+        blockReady(false),
+        requested { },
+        settingsSequence(0),
+        published { },
+        notchSequence(0),
+        appliedSequence(0),
+        settings { },
+        window { },
+        windowSum(0.f),
+        binHz { },
+        coeffs { },
+        centers { },
+        amplitudes { },
+        snapshotHz { },
+        snapshotCenters { },
+        snapshotCount(0) {
+    for (size_t n = 0; n < BLOCK_SIZE; n++) {
+        window[n] = 0.5f - 0.5f * cosf(2 * PI * n / (BLOCK_SIZE - 1));
+        windowSum += window[n];
+    }
+    hw::mutexInit(&mutex);
+    instance = this;
+}
+
+/**
+ * Changes the settings, taking effect at the next analysis. Control thread
+ * only.
+ */
+void NotchTracker::configure(const Settings &settings) {
+    enabled = settings.count > 0;
+    settingsSequence = settingsSequence + 1;
+    COMPILER_BARRIER();
+    requested = settings;
+    if (requested.count > MAX_NOTCHES) {
+        requested.count = MAX_NOTCHES;
+    }
+    COMPILER_BARRIER();
+    settingsSequence = settingsSequence + 1;
+}
+
+/**
+ * Adds one sample. Control thread only, once per step while enabled.
+ */
+void NotchTracker::push(int32_t sample) {
+    blocks[writeBlock][fill++] = dsp::ssat<16>(sample);
+    if (fill < BLOCK_SIZE) {
+        return;
+    }
+    fill = 0;
+    // if the last block is still being analyzed, overwrite this one instead
+    if (!blockReady) {
+        readyBlock = writeBlock;
+        COMPILER_BARRIER();
+        blockReady = true;
+        writeBlock ^= 1;
+    }
+}
+
+/**
+ * Copies out the notches published since the last call, if any. Control
+ * thread only.
+ *
+ * @param notches MAX_NOTCHES filter sections, pass-through for unused ones
+ * @return false if there was nothing new, or it was being written
+ */
+bool NotchTracker::takeNotches(Biquad *notches) {
+    const uint32_t sequence = notchSequence;
+    if (sequence == takenSequence || (sequence & 1) != 0) {
+        return false;
+    }
+    COMPILER_BARRIER();
+    for (size_t i = 0; i < MAX_NOTCHES; i++) {
+        notches[i] = published[i];
+    }
+    COMPILER_BARRIER();
+    if (notchSequence != sequence) {
+        return false;
+    }
+    takenSequence = sequence;
+    return true;
+}
+
+/**
+ * Analyzes the latest full block, if any, and publishes notches at its peaks.
+ * Called periodically from a low-priority thread.
+ *
+ * @return true if a block was analyzed
+ */
+bool NotchTracker::analyze() {
+    applySettings();
+    if (!blockReady) {
+        return false;
+    }
+    const bool active = settings.count > 0;
+    float power[NUM_BINS];
+    if (active) {
+        spectrum(blocks[readyBlock], power);
+    }
+    COMPILER_BARRIER();
+    blockReady = false;
+    if (!active) {
+        return false;
+    }
+
+    float peaks[MAX_NOTCHES];
+    const size_t found = findPeaks(power, peaks);
+    for (size_t i = 0; i < found; i++) {
+        centers[i] = centers[i] > 0.f ? centers[i] + SMOOTHING * (peaks[i] - centers[i]) : peaks[i];
+    }
+    publish();
+
+    hw::mutexLock(&mutex);
+    for (size_t k = 0; k < NUM_BINS; k++) {
+        amplitudes[k] = 2 * sqrtf(power[k] > 0.f ? power[k] : 0.f) / windowSum;
+        snapshotHz[k] = binHz[k];
+    }
+    for (size_t i = 0; i < MAX_NOTCHES; i++) {
+        snapshotCenters[i] = i < settings.count ? centers[i] : 0.f;
+    }
+    snapshotCount = settings.count;
+    hw::mutexUnlock(&mutex);
+    return true;
+}
+
+/**
+ * Picks up new settings, if they were completely written. Analysis thread.
+ */
+bool NotchTracker::applySettings() {
+    const uint32_t sequence = settingsSequence;
+    if (sequence == appliedSequence || (sequence & 1) != 0) {
+        return false;
+    }
+    COMPILER_BARRIER();
+    const Settings copy = requested;
+    COMPILER_BARRIER();
+    if (settingsSequence != sequence) {
+        return false;
+    }
+    appliedSequence = sequence;
+    settings = copy;
+
+    for (size_t k = 0; k < NUM_BINS; k++) {
+        binHz[k] = settings.minHz + (settings.maxHz - settings.minHz) * k / (NUM_BINS - 1);
+        coeffs[k] = 2 * cosf(2 * PI * binHz[k] / settings.sampleHz);
+    }
+    for (size_t i = 0; i < MAX_NOTCHES; i++) {
+        centers[i] = 0.f;
+    }
+    // clears the notches if turned off
+    publish();
+    return true;
+}
+
+/**
+ * Power at each bin frequency, of the block with its mean removed and
+ * windowed. Goertzel's algorithm, one second-order recurrence per bin.
+ */
+void NotchTracker::spectrum(const int16_t *samples, float *power) const {
+    float mean = 0.f;
+    for (size_t n = 0; n < BLOCK_SIZE; n++) {
+        mean += samples[n];
+    }
+    mean /= BLOCK_SIZE;
+
+    float x[BLOCK_SIZE];
+    for (size_t n = 0; n < BLOCK_SIZE; n++) {
+        x[n] = (samples[n] - mean) * window[n];
+    }
+
+    for (size_t k = 0; k < NUM_BINS; k++) {
+        const float coeff = coeffs[k];
+        float s1 = 0.f;
+        float s2 = 0.f;
+        for (size_t n = 0; n < BLOCK_SIZE; n++) {
+            const float s0 = x[n] + coeff * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+        power[k] = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    }
+}
+
+/**
+ * Finds the largest local maxima that stand out from the noise floor, up to
+ * the number of notches, interpolated between bins.
+ *
+ * @param power power per bin
+ * @param peaks peak frequencies, in ascending order
+ * @return number of peaks found
+ */
+size_t NotchTracker::findPeaks(const float *power, float *peaks) const {
+    float sorted[NUM_BINS];
+    std::copy(power, power + NUM_BINS, sorted);
+    std::nth_element(sorted, sorted + NUM_BINS / 2, sorted + NUM_BINS);
+    const float threshold = PEAK_RATIO * sorted[NUM_BINS / 2];
+
+    size_t best[MAX_NOTCHES];
+    size_t found = 0;
+    for (size_t k = 1; k + 1 < NUM_BINS; k++) {
+        if (power[k] <= threshold || power[k] <= power[k - 1] || power[k] < power[k + 1]) {
+            continue;
+        }
+        // insert into the list of the strongest, kept in descending order
+        size_t i = found < settings.count ? found++ : settings.count;
+        while (i > 0 && power[best[i - 1]] < power[k]) {
+            if (i < settings.count) {
+                best[i] = best[i - 1];
+            }
+            i--;
+        }
+        if (i < settings.count) {
+            best[i] = k;
+        }
+    }
+
+    const float spacing = (settings.maxHz - settings.minHz) / (NUM_BINS - 1);
+    for (size_t i = 0; i < found; i++) {
+        const size_t k = best[i];
+        const float curvature = power[k - 1] - 2 * power[k] + power[k + 1];
+        const float offset = curvature < 0.f ? 0.5f * (power[k - 1] - power[k + 1]) / curvature : 0.f;
+        peaks[i] = binHz[k] + offset * spacing;
+    }
+    for (size_t i = 1; i < found; i++) {
+        for (size_t j = i; j > 0 && peaks[j - 1] > peaks[j]; j--) {
+            const float swap = peaks[j];
+            peaks[j] = peaks[j - 1];
+            peaks[j - 1] = swap;
+        }
+    }
+    return found;
+}
+
+void NotchTracker::publish() {
+    Biquad notches[MAX_NOTCHES];
+    for (size_t i = 0; i < MAX_NOTCHES; i++) {
+        notches[i] = i < settings.count && centers[i] > 0.f ?
+                Biquad::notch(centers[i], settings.sampleHz, settings.q) : Biquad::passThrough();
+    }
+    notchSequence = notchSequence + 1;
+    COMPILER_BARRIER();
+    for (size_t i = 0; i < MAX_NOTCHES; i++) {
+        published[i] = notches[i];
+    }
+    COMPILER_BARRIER();
+    notchSequence = notchSequence + 1;
+}
+
+void NotchTracker::shellCommand(BaseChannel *chp, int argc, char *argv[]) {
+    (void) argv;
+    NotchTracker * const tracker = instance;
+    if (argc != 0) {
+        chprintf(chp, "Usage: spectrum\r\n");
+        return;
+    }
+
+    hw::mutexLock(&tracker->mutex);
+    if (tracker->snapshotCount == 0) {
+        hw::mutexUnlock(&tracker->mutex);
+        chprintf(chp, "error: dynamic notch off or no spectrum yet\r\n");
+        return;
+    }
+    // amplitudes are in gyro units
+    chprintf(chp, "spectrum,hz,amplitude\r\n");
+    for (size_t k = 0; k < NUM_BINS; k++) {
+        chprintf(chp, "spectrum");
+        chprintf(chp, ",");
+        printFixed(chp, tracker->snapshotHz[k], 2);
+        chprintf(chp, ",");
+        printFixed(chp, tracker->amplitudes[k], 2);
+        chprintf(chp, "\r\n");
+    }
+    for (size_t i = 0; i < tracker->snapshotCount; i++) {
+        chprintf(chp, "notch,%u", unsigned(i));
+        chprintf(chp, ",");
+        printFixed(chp, tracker->snapshotCenters[i], 2);
+        chprintf(chp, "\r\n");
+    }
+    hw::mutexUnlock(&tracker->mutex);
+}
@@ -0,0 +1,294 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+#include "Hw.h"
+
+#include "Params.h"
+#include "Curve.h"
+#include "Format.h"
+#include "Mixer.h"
+#include "NotchTracker.h"
+#include "chprintf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const Config Params::defaults = {
+        0.25f,  // kp
+        0.01f,  // ki
+        0.f,    // kd
+        0.f,    // kff
+        1.f,    // setpointWeight
+        0.f,    // dFilterHz
+        0,      // pidMeasuredPeriod
+        1200,   // inputLow
+        1800,   // inputHigh
+        17,     // inputDeadband
+        10,     // dcDeadband
+        720,    // yawRate
+        0.f,    // aileronExpo
+        0.f,    // aileronSuperRate
+        0.f,    // elevatorExpo
+        0.f,    // elevatorSuperRate
+        1.f,    // mixLeftForward
+        1.f,    // mixLeftTurn
+        1.f,    // mixRightForward
+        -1.f,   // mixRightTurn
+        0,      // leftInvert
+        0,      // rightInvert
+        0.f,    // gyroLowPassHz
+        0.f,    // gyroNotchHz
+        2.f,    // gyroNotchQ
+        0,      // dynNotchCount
+        20.f,   // dynNotchMinHz
+        95.f,   // dynNotchMaxHz
+        3.f,    // dynNotchQ
+        0,      // rateEstimate
+        0.15f,  // rateModelTau
+        0.f,    // rateModelGain
+        20.f,   // rateProcessSd
+        50.f,   // rateNoiseSd
+        0.f,    // headingKp
+        45.f,   // headingMaxError
+        0.3f,   // autotuneRelay
+        200,    // autotuneHysteresis
+        { 1.f, 1.f, 1.f, 1.f }, // gainScale
+};
+
+const Params::Param Params::table[] = {
+        { "kp", TYPE_FLOAT, offsetof(Config, kp), 0.f, 10.f },
+        // wide enough for the integral gains autotune finds
+        { "ki", TYPE_FLOAT, offsetof(Config, ki), 0.f, 500.f },
+        { "kd", TYPE_FLOAT, offsetof(Config, kd), 0.f, 10.f },
+        { "kff", TYPE_FLOAT, offsetof(Config, kff), 0.f, 10.f },
+        { "setpoint_weight", TYPE_FLOAT, offsetof(Config, setpointWeight), 0.f, 1.f },
+        { "d_filter_hz", TYPE_FLOAT, offsetof(Config, dFilterHz), 0.f, 100.f },
+        { "pid_measured_period", TYPE_INT32, offsetof(Config, pidMeasuredPeriod), 0, 1 },
+        { "input_low", TYPE_INT32, offsetof(Config, inputLow), 800, 2200 },
+        { "input_high", TYPE_INT32, offsetof(Config, inputHigh), 800, 2200 },
+        { "input_deadband", TYPE_INT32, offsetof(Config, inputDeadband), 0, 200 },
+        { "dc_deadband", TYPE_INT32, offsetof(Config, dcDeadband), 0, 1000 },
+        { "yaw_rate", TYPE_INT32, offsetof(Config, yawRate), 0, 2000 },
+        { "aileron_expo", TYPE_FLOAT, offsetof(Config, aileronExpo), 0.f, 1.f },
+        { "aileron_super_rate", TYPE_FLOAT, offsetof(Config, aileronSuperRate), 0.f, Curve::MAX_SUPER_RATE },
+        { "elevator_expo", TYPE_FLOAT, offsetof(Config, elevatorExpo), 0.f, 1.f },
+        { "elevator_super_rate", TYPE_FLOAT, offsetof(Config, elevatorSuperRate), 0.f, Curve::MAX_SUPER_RATE },
+        { "mix_left_forward", TYPE_FLOAT, offsetof(Config, mixLeftForward), -Mixer::MAX_WEIGHT, Mixer::MAX_WEIGHT },
+        { "mix_left_turn", TYPE_FLOAT, offsetof(Config, mixLeftTurn), -Mixer::MAX_WEIGHT, Mixer::MAX_WEIGHT },
+        { "mix_right_forward", TYPE_FLOAT, offsetof(Config, mixRightForward), -Mixer::MAX_WEIGHT, Mixer::MAX_WEIGHT },
+        { "mix_right_turn", TYPE_FLOAT, offsetof(Config, mixRightTurn), -Mixer::MAX_WEIGHT, Mixer::MAX_WEIGHT },
+        { "left_invert", TYPE_INT32, offsetof(Config, leftInvert), 0, 1 },
+        { "right_invert", TYPE_INT32, offsetof(Config, rightInvert), 0, 1 },
+        { "gyro_lpf_hz", TYPE_FLOAT, offsetof(Config, gyroLowPassHz), 0.f, 100.f },
+        { "gyro_notch_hz", TYPE_FLOAT, offsetof(Config, gyroNotchHz), 0.f, 100.f },
+        { "gyro_notch_q", TYPE_FLOAT, offsetof(Config, gyroNotchQ), 0.5f, 10.f },
+        { "dyn_notch_count", TYPE_INT32, offsetof(Config, dynNotchCount), 0, NotchTracker::MAX_NOTCHES },
+        { "dyn_notch_min_hz", TYPE_FLOAT, offsetof(Config, dynNotchMinHz), 1.f, 100.f },
+        { "dyn_notch_max_hz", TYPE_FLOAT, offsetof(Config, dynNotchMaxHz), 1.f, 100.f },
+        { "dyn_notch_q", TYPE_FLOAT, offsetof(Config, dynNotchQ), 0.5f, 10.f },
+        { "rate_estimate", TYPE_INT32, offsetof(Config, rateEstimate), 0, 1 },
+        { "rate_model_tau", TYPE_FLOAT, offsetof(Config, rateModelTau), 0.f, 2.f },
+        { "rate_model_gain", TYPE_FLOAT, offsetof(Config, rateModelGain), -100.f, 100.f },
+        { "rate_process_sd", TYPE_FLOAT, offsetof(Config, rateProcessSd), 0.f, 10000.f },
+        { "rate_noise_sd", TYPE_FLOAT, offsetof(Config, rateNoiseSd), 1.f, 10000.f },
+        { "heading_kp", TYPE_FLOAT, offsetof(Config, headingKp), 0.f, 50.f },
+        { "heading_max_error", TYPE_FLOAT, offsetof(Config, headingMaxError), 1.f, 180.f },
+        { "autotune_relay", TYPE_FLOAT, offsetof(Config, autotuneRelay), 0.05f, 1.f },
+        { "autotune_hysteresis", TYPE_INT32, offsetof(Config, autotuneHysteresis), 0, 2000 },
+        { "gain_scale_25", TYPE_FLOAT, offsetof(Config, gainScale[0]), 0.1f, 5.f },
+        { "gain_scale_50", TYPE_FLOAT, offsetof(Config, gainScale[1]), 0.1f, 5.f },
+        { "gain_scale_75", TYPE_FLOAT, offsetof(Config, gainScale[2]), 0.1f, 5.f },
+        { "gain_scale_100", TYPE_FLOAT, offsetof(Config, gainScale[3]), 0.1f, 5.f },
+};
+
+const size_t Params::NUM_PARAMS = sizeof(table) / sizeof(table[0]);
+
+Params *Params::instance = NULL;
+
+Params::Params(const Config &initial) :
+                buffers { initial, initial },
+                activeIndex(0),
+                pending(false) {
+    instance = this;
+}
+
+/**
+ * Swaps in the pending config, if any. Must only be called from the control
+ * thread, between control steps.
+ *
+ * @return true if the active config changed
+ */
+bool Params::update() {
+    if (!pending) {
+        return false;
+    }
+    COMPILER_BARRIER();
+    activeIndex ^= 1;
+    COMPILER_BARRIER();
+    pending = false;
+    return true;
+}
+
+/**
+ * Returns the inactive buffer, initialized to the active config. Waits for the
+ * control thread to pick up any previous edit first. Must only be called from
+ * one thread at a time, with a commitEdit() to follow.
+ */
+Config &Params::beginEdit() {
+    while (pending) {
+        hw::sleepMs(1);
+    }
+    Config &staging = buffers[activeIndex ^ 1];
+    staging = active();
+    return staging;
+}
+
+/**
+ * Marks the inactive buffer for swapping in at the next control step, if it
+ * holds a valid config.
+ *
+ * @return false if the edited config was rejected
+ */
+bool Params::commitEdit() {
+    if (!validate(buffers[activeIndex ^ 1])) {
+        return false;
+    }
+    COMPILER_BARRIER();
+    pending = true;
+    return true;
+}
+
+const Params::Param *Params::find(const char *name) const {
+    for (size_t i = 0; i < NUM_PARAMS; i++) {
+        if (strcmp(table[i].name, name) == 0) {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+float Params::get(const Param &param) const {
+    const uint8_t * const field = reinterpret_cast<const uint8_t *>(&active()) + param.offset;
+    if (param.type == TYPE_FLOAT) {
+        return *reinterpret_cast<const float *>(field);
+    }
+    return *reinterpret_cast<const int32_t *>(field);
+}
+
+/**
+ * Sets one parameter. Must only be called from one thread at a time.
+ *
+ * @param param table entry of the parameter to set
+ * @param value new value, truncated for integer parameters
+ * @return false if the value is out of range or makes the config invalid
+ */
+bool Params::set(const Param &param, float value) {
+    if (!(value >= param.min && value <= param.max)) {
+        return false;
+    }
+
+    uint8_t * const field = reinterpret_cast<uint8_t *>(&beginEdit()) + param.offset;
+    if (param.type == TYPE_FLOAT) {
+        *reinterpret_cast<float *>(field) = value;
+    } else {
+        *reinterpret_cast<int32_t *>(field) = int32_t(value);
+    }
+    return commitEdit();
+}
+
+/**
+ * Replaces the whole config. Must only be called from one thread at a time.
+ *
+ * @param config new config
+ * @return false if the config is invalid
+ */
+bool Params::load(const Config &config) {
+    beginEdit() = config;
+    return commitEdit();
+}
+
+/**
+ * Checks constraints between parameters that the per-parameter ranges can't.
+ */
+bool Params::validate(const Config &config) {
+    for (size_t i = 0; i < NUM_PARAMS; i++) {
+        const Param &param = table[i];
+        const uint8_t * const field = reinterpret_cast<const uint8_t *>(&config) + param.offset;
+        const float value = param.type == TYPE_FLOAT ?
+                *reinterpret_cast<const float *>(field) : *reinterpret_cast<const int32_t *>(field);
+        if (!(value >= param.min && value <= param.max)) {
+            return false;
+        }
+    }
+    // input range must remain nonempty after cutting the deadband out
+    return config.inputHigh - config.inputLow - 2 * config.inputDeadband > 0
+            && config.dynNotchMinHz < config.dynNotchMaxHz;
+}
+
+void Params::print(BaseChannel *chp, const Param &param, float value) {
+    if (param.type == TYPE_INT32) {
+        chprintf(chp, "%s = %d\r\n", param.name, int32_t(value));
+        return;
+    }
+    chprintf(chp, "%s = ", param.name);
+    printFixed(chp, value, 6);
+    chprintf(chp, "\r\n");
+}
+
+void Params::shellCommand(BaseChannel *chp, int argc, char *argv[]) {
+    Params * const params = instance;
+    if (argc == 1 && strcmp(argv[0], "list") == 0) {
+        for (size_t i = 0; i < NUM_PARAMS; i++) {
+            print(chp, table[i], params->get(table[i]));
+        }
+        return;
+    }
+
+    if (argc >= 2) {
+        const Param * const param = params->find(argv[1]);
+        if (param == NULL) {
+            chprintf(chp, "error: unknown parameter %s\r\n", argv[1]);
+            return;
+        }
+
+        if (argc == 2 && strcmp(argv[0], "get") == 0) {
+            print(chp, *param, params->get(*param));
+            return;
+        }
+
+        if (argc == 3 && strcmp(argv[0], "set") == 0) {
+            char *end;
+            const float value = strtof(argv[2], &end);
+            if (*end != '\0' || !params->set(*param, value)) {
+                chprintf(chp, "error: invalid value for %s\r\n", param->name);
+                return;
+            }
+            print(chp, *param, value);
+            return;
+        }
+    }
+
+    chprintf(chp, "Usage: param list | get <name> | set <name> <value>\r\n");
+}
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "PpmDecoder.h"
+
+PpmDecoder::PpmDecoder() :
+        channels { },
+        current(0) {
+}
+
+/**
+ * Adds one captured pulse. Called from the capture interrupt.
+ *
+ * @param negativeWidth low time before the pulse, in us
+ * @param positiveWidth high time of the pulse, in us
+ * @return true if this completed a frame, whose widths are then available
+ *      from getChannels() until the next pulse
+ */
+bool PpmDecoder::pulse(hw::IcuCount negativeWidth, hw::IcuCount positiveWidth) {
+    // start of pulse train (long low time)
+    if (negativeWidth > SYNC_WIDTH) {
+        current = 0;
+        if (validWidth(positiveWidth)) {
+            channels[current++] = positiveWidth;
+        }
+        return false;
+    }
+
+    if (!validWidth(negativeWidth) || !validWidth(positiveWidth) || current == 0
+            || current + 2 > NUM_CHANNELS) {
+        current = 0;
+        return false;
+    }
+    channels[current++] = negativeWidth;
+    channels[current++] = positiveWidth;
+    if (current < NUM_CHANNELS) {
+        return false;
+    }
+    current = 0;
+    return true;
+}
@@ -0,0 +1,124 @@
+/*
+ *  Copyright (C) 2013 Xo Wang
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL XO
+ *  WANG BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ *  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ *  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ *  Except as contained in this notice, the name of Xo Wang shall not be
+ *  used in advertising or otherwise to promote the sale, use or other dealings
+ *  in this Software without prior written authorization from Xo Wang.
+ */
+
+
+#include "RateEstimator.h"
+#include "IntMath.h"
+
+#include <math.h>
+
+RateEstimator::RateEstimator() :
+        decay(0.f),
+        drive(0.f),
+        processVariance(0.f),
+        noiseVariance(1.f),
+        rate(0.f),
+        variance(0.f),
+        differential(0),
+        started(false),
+        saturated(false),
+        faulted(false),
+        rejections(0) {
+}
+
+/**
+ * Sets the drive model and noise levels. Keeps the current estimate.
+ *
+ * @param model yaw response and noise, with rates in gyro units
+ * @param dt time between updates, in s
+ */
+void RateEstimator::configure(const Model &model, float dt) {
+    decay = model.tau > 0.f ? expf(-dt / model.tau) : 0.f;
+    drive = model.gain * (1.f - decay);
+    processVariance = model.processSd * model.processSd;
+    noiseVariance = model.noiseSd * model.noiseSd;
+}
+
+/**
+ * Forgets the estimate, so that the next reading starts it over. Clears the
+ * fault.
+ */
+void RateEstimator::reset() {
+    rate = 0.f;
+    variance = 0.f;
+    differential = 0;
+    started = false;
+    saturated = false;
+    faulted = false;
+    rejections = 0;
+}
+
+/**
+ * Advances the estimate by one step and corrects it with a gyro reading.
+ * Clipping shows in the raw reading; bias correction and filtering can pull a
+ * clipped reading back under the limit, or even flip its sign.
+ *
+ * @param measured bias-corrected and filtered gyro rate
+ * @param raw gyro reading that measured came from
+ * @return estimated rate, in gyro units
+ */
+float RateEstimator::update(int32_t measured, int16_t raw) {
+    if (!started) {
+        rate = measured;
+        variance = noiseVariance;
+        started = true;
+        return rate;
+    }
+
+    rate = decay * rate + drive * differential;
+    variance = decay * decay * variance + processVariance;
+
+    saturated = nabs(raw) <= -SENSOR_LIMIT;
+    if (saturated) {
+        return rate;
+    }
+
+    const float innovation = measured - rate;
+    const float total = variance + noiseVariance;
+    if (innovation * innovation > GATE * GATE * total) {
+        if (++rejections >= FAULT_STEPS) {
+            faulted = true;
+            rejections = 0;
+            rate = measured;
+            variance = noiseVariance;
+        }
+        return rate;
+    }
+
+    rejections = 0;
+    const float gain = variance / total;
+    rate += gain * innovation;
+    variance -= gain * variance;
+    return rate;
+}
+
+/**
+ * Sets the drive for the next step.
+ *
+ * @param differential left minus right drive, as seen by the wheels
+ */
+void RateEstimator::command(int32_t differential) {
+    this->differential = differential;
+}
@@ -26,11 +26,11 @@
 #include "VNH5050A.h"
 
 VNH5050A::VNH5050A(
-        PWMDriver *pwmp,
-        pwmchannel_t channel,
-        GPIO_TypeDef *port1,
+        hw::Pwm *pwmp,
+        hw::PwmChannel channel,
+        hw::Port *port1,
         uint16_t pad1,
-        GPIO_TypeDef *port2,
+        hw::Port *port2,
         uint16_t pad2) :
         pwmp(pwmp), channel(channel), port1(port1), pad1(pad1), port2(port2), pad2(pad2) {
     setSpeed(0);
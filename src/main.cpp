@@ -30,6 +30,21 @@
 #include "A4960.h"
 #include "VNH5050A.h"
 #include "L3GD20.h"
+#include "Blackbox.h"
+#include "EventLog.h"
+#include "Log.h"
+#include "Params.h"
+#include "ConfigStore.h"
+#include "Peripherals.h"
+#include "Bench.h"
+#include "DspCheck.h"
+#include "NotchTracker.h"
+#include "Autotune.h"
+
+#include "shell.h"
+#include "chprintf.h"
+
+#include <string.h>
 
 // heartbeat thread
 static WORKING_AREA(waHeartbeat, 128);
@@ -37,16 +52,16 @@ NORETURN static void threadHeartbeat(void *arg) {
     (void) arg;
     chRegSetThreadName("heartbeat");
     while (TRUE) {
-        palClearPad(GPIOA, GPIOA_LEDP);
+        hw::clearPad(GPIOA, GPIOA_LEDP);
         chThdSleepMilliseconds(900);
-        palSetPad(GPIOA, GPIOA_LEDP);
+        hw::setPad(GPIOA, GPIOA_LEDP);
         chThdSleepMilliseconds(100);
     }
     chThdExit(0);
 }
 
 // failsafe thread
-static WORKING_AREA(waFailsafe, 128);
+static WORKING_AREA(waFailsafe, 256);
 NORETURN static void threadFailsafe(void *arg) {
     (void) arg;
     chRegSetThreadName("failsafe");
@@ -54,52 +69,135 @@ NORETURN static void threadFailsafe(void *arg) {
     chThdExit(0);
 }
 
+// gyro spectrum analysis thread, holds a windowed block on its stack
+static WORKING_AREA(waSpectrum, 768);
+NORETURN static void threadSpectrum(void *arg) {
+    chRegSetThreadName("spectrum");
+    static_cast<HFCS *>(arg)->spectrumLoop();
+    chThdExit(0);
+}
+
+// held while writing to the console, so that log text never lands in the
+// middle of command output such as a binary blackbox dump
+static hw::Mutex consoleMutex;
+
+template<shellcmd_t command>
+static void consoleCommand(BaseChannel *chp, int argc, char *argv[]) {
+    hw::mutexLock(&consoleMutex);
+    command(chp, argc, argv);
+    hw::mutexUnlock(&consoleMutex);
+}
+
+// log formatting thread
+static WORKING_AREA(waLog, 512);
+NORETURN static void threadLog(void *arg) {
+    chRegSetThreadName("log");
+    while (TRUE) {
+        hw::mutexLock(&consoleMutex);
+        Log::drain(static_cast<BaseChannel *>(arg));
+        hw::mutexUnlock(&consoleMutex);
+        chThdSleepMilliseconds(20);
+    }
+    chThdExit(0);
+}
+
+// persistent config commands
+static void cmdConfig(BaseChannel *chp, int argc, char *argv[]) {
+    ConfigStore * const store = ConfigStore::instance;
+    Params * const params = Params::instance;
+    if (argc == 1 && strcmp(argv[0], "info") == 0) {
+        chprintf(chp, "page %u: %u/%u bytes used\r\n", store->getSequence(), store->getUsed(), store->getSize());
+    } else if (argc == 1 && strcmp(argv[0], "save") == 0) {
+        // flash writes stall the CPU
+        if (HFCS::instance->isArmed()) {
+            chprintf(chp, "error: disarm before saving\r\n");
+            return;
+        }
+        const Config config = params->active();
+        if (!store->write(ConfigStore::KEY_CONFIG, Params::VERSION, &config, sizeof(config))) {
+            chprintf(chp, "error: flash write failed\r\n");
+        }
+    } else if (argc == 1 && strcmp(argv[0], "load") == 0) {
+        Config config;
+        if (!store->read(ConfigStore::KEY_CONFIG, Params::VERSION, &config, sizeof(config))
+                || !params->load(config)) {
+            chprintf(chp, "error: no valid saved config\r\n");
+        }
+    } else if (argc == 1 && strcmp(argv[0], "defaults") == 0) {
+        params->load(Params::defaults);
+    } else {
+        chprintf(chp, "Usage: config info | save | load | defaults\r\n");
+    }
+}
+
+// debug shell thread
+static WORKING_AREA(waShell, 2048);
+
+// stack use of the static threads, from how much of the fill pattern is left
+struct StackArea {
+    const char *name;
+    const void *area;
+    size_t size;
+};
+
+static const StackArea stackAreas[] = {
+        { "heartbeat", waHeartbeat, sizeof(waHeartbeat) },
+        { "failsafe", waFailsafe, sizeof(waFailsafe) },
+        { "spectrum", waSpectrum, sizeof(waSpectrum) },
+        { "log", waLog, sizeof(waLog) },
+        { "shell", waShell, sizeof(waShell) },
+};
+
+static void cmdStack(BaseChannel *chp, int argc, char *argv[]) {
+    (void) argv;
+    if (argc != 0) {
+        chprintf(chp, "Usage: stack\r\n");
+        return;
+    }
+    for (size_t i = 0; i < sizeof(stackAreas) / sizeof(stackAreas[0]); i++) {
+        // the stack grows down towards the thread structure at the start
+        const uint8_t * const start = static_cast<const uint8_t *>(stackAreas[i].area) + sizeof(Thread);
+        const uint8_t * const end = static_cast<const uint8_t *>(stackAreas[i].area) + stackAreas[i].size;
+        const uint8_t *p = start;
+        while (p < end && *p == CH_STACK_FILL_VALUE) {
+            p++;
+        }
+        chprintf(chp, "%s: %u of %u bytes never used\r\n", stackAreas[i].name, unsigned(p - start),
+                unsigned(end - start));
+    }
+}
+
+static const ShellCommand shellCommands[] = {
+        { "bb", consoleCommand<Blackbox::shellCommand> },
+        { "log", consoleCommand<EventLog::shellCommand> },
+        { "param", consoleCommand<Params::shellCommand> },
+        { "config", consoleCommand<cmdConfig> },
+        { "bench", consoleCommand<Bench::shellCommand> },
+        { "dspcheck", consoleCommand<DspCheck::shellCommand> },
+        { "spectrum", consoleCommand<NotchTracker::shellCommand> },
+        { "autotune", consoleCommand<Autotune::shellCommand> },
+        { "stack", consoleCommand<cmdStack> },
+        { nullptr, nullptr } };
+static const ShellConfig shellConfig = { (BaseChannel *) &DBG_SERIAL, shellCommands };
+
 int main(void) {
     halInit();
     chSysInit();
+    EventLog::init();
 
     chThdSleepMilliseconds(200);
 
-    // serial setup
-    const SerialConfig dbgSerialConfig = { 115200, 0, USART_CR2_STOP1_BITS, USART_CR3_CTSE | USART_CR3_RTSE };
-    sdStart(&DBG_SERIAL, &dbgSerialConfig);
-
-    // VNH5050A PWM setup
-    const PWMConfig dcPWMConfig = { STM32_TIMCLK1, DC_PWM_PERIOD, nullptr, {
-            { PWM_OUTPUT_ACTIVE_HIGH, nullptr },
-            { PWM_OUTPUT_DISABLED, nullptr },
-            { PWM_OUTPUT_DISABLED, nullptr },
-            { PWM_OUTPUT_ACTIVE_HIGH, nullptr } }, 0, };
-    pwmStart(&DC_PWM, &dcPWMConfig);
+    Peripherals::start();
+    hw::mutexInit(&consoleMutex);
+    EventLog::printSummary((BaseChannel *) &DBG_SERIAL);
 
     // DC motor setup
     VNH5050A dcAB(&DC_PWM, DC_PWM_AB_CHAN, GPIOC, GPIOC_MTR_A, GPIOA, GPIOA_MTR_B);
     VNH5050A dcXY(&DC_PWM, DC_PWM_XY_CHAN, GPIOA, GPIOA_MTR_X, GPIOA, GPIOA_MTR_Y);
 
-    // A4960 PWM setup
-    const PWMConfig mPWMConfig = { STM32_TIMCLK1, M1_PWM_PERIOD, nullptr, {
-            { PWM_OUTPUT_DISABLED, nullptr },
-            { PWM_OUTPUT_DISABLED, nullptr },
-            { PWM_OUTPUT_DISABLED, nullptr },
-            { PWM_OUTPUT_ACTIVE_HIGH, nullptr } }, 0, };
-    pwmStart(&M1_PWM, &mPWMConfig);
-
-    // SPI setup
-    // speed = pclk/8 = 5.25MHz
-    const SPIConfig m1SPIConfig = { NULL, GPIOC, GPIOC_M1_NSS, SPI_CR1_DFF | SPI_CR1_BR_1 };
-    spiStart(&M1_SPI, &m1SPIConfig);
-
     // weapon motor setup
     A4960 m1(&M1_SPI, &M1_PWM, M1_PWM_CHAN);
 
-    // input capture & high-res timer
-    const ICUConfig icuConfig = { ICU_INPUT_ACTIVE_LOW, 1000000, HFCS::icuWidthCb, HFCS::icuPeriodCb };
-    icuStart(&PPM_ICU, &icuConfig);
-
-    // gyro I2C setup
-    const I2CConfig i2cConfig = { OPMODE_I2C, 400000, FAST_DUTY_CYCLE_2 };
-    i2cStart(&GYRO_I2C, &i2cConfig);
-
     // gyro setup
     L3GD20 gyro(&GYRO_I2C);
     gyro.setSlaveAddrLSB(1);
@@ -108,17 +206,36 @@ int main(void) {
     gyro.setOutputDataRate(2); // 380 Hz
     gyro.setBandwidth(2); // 100 Hz cut-off
 
+    // flight recorder in memory set aside by the board
+    size_t blackboxSize;
+    uint8_t * const blackboxMemory = Peripherals::blackboxMemory(&blackboxSize);
+    Blackbox blackbox(blackboxMemory, blackboxSize);
+
+    // load parameters from flash, falling back to defaults
+    ConfigStore configStore(Peripherals::configPage(0), Peripherals::configPage(1));
+    configStore.mount();
+    Config config;
+    if (!configStore.read(ConfigStore::KEY_CONFIG, Params::VERSION, &config, sizeof(config))
+            || !Params::validate(config)) {
+        config = Params::defaults;
+    }
+    Params params(config);
+
     // initialize control loop
-    HFCS hfcs(m1, dcAB, dcXY, &PPM_ICU, gyro);
+    HFCS hfcs(m1, dcAB, dcXY, &PPM_ICU, gyro, blackbox, params, configStore);
     hfcs.init();
 
     // start slave threads
     chThdCreateStatic(waHeartbeat, sizeof(waHeartbeat), IDLEPRIO, tfunc_t(threadHeartbeat), nullptr);
     chThdCreateStatic(waFailsafe, sizeof(waFailsafe), LOWPRIO, tfunc_t(threadFailsafe), &hfcs);
+    chThdCreateStatic(waSpectrum, sizeof(waSpectrum), LOWPRIO, tfunc_t(threadSpectrum), &hfcs);
+    chThdCreateStatic(waLog, sizeof(waLog), LOWPRIO, tfunc_t(threadLog), &DBG_SERIAL);
+    shellInit();
+    shellCreateStatic(&shellConfig, waShell, sizeof(waShell), LOWPRIO);
 
     // done with setup
-    palClearPad(GPIOA, GPIOA_LEDQ);
-    palClearPad(GPIOA, GPIOA_LEDR);
+    hw::clearPad(GPIOA, GPIOA_LEDQ);
+    hw::clearPad(GPIOA, GPIOA_LEDR);
 
     // start the fast loop
     hfcs.fastLoop();